@@ -16,6 +16,7 @@
 
 #include "ProtocolBridge.h"
 #include "IqrfLogging.h"
+#include "TimestampFormatter.h"
 
 const std::string ProtocolBridge::PRF_NAME("ProtocolBridge");
 
@@ -996,14 +997,10 @@ std::string ProtocolBridgeJson::encodeResponse(const std::string& errStr)
 	}
 
 	//TODO time from response or transaction?
-	time_t tt = system_clock::to_time_t(system_clock::now());
-	std::tm* timeinfo = localtime(&tt);
-	timeinfo = localtime(&tt);
-	std::tm timeStr = *timeinfo;
-	char buf[80];
-	strftime(buf, sizeof(buf), "%Y-%m-%d.%X", &timeStr);
-
-	v.SetString(buf, alloc);
+	char buf[TimestampFormatter::SECONDS_SIZE];
+	size_t len = TimestampFormatter::formatSeconds(buf, system_clock::to_time_t(system_clock::now()), '.');
+
+	v.SetString(buf, (rapidjson::SizeType)len, alloc);
 	m_doc.AddMember("Time", v, alloc);
 
 	m_statusJ = errStr;
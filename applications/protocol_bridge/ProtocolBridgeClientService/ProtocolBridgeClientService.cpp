@@ -81,7 +81,7 @@ void ProtocolBridgeClientService::setDaemon(IDaemon* daemon)
 void ProtocolBridgeClientService::setSerializer(ISerializer* serializer)
 {
 	m_serializer = serializer;
-	m_messaging->registerMessageHandler([this](const ustring& msg) {
+	m_messaging->registerMessageHandler([this](MessageSpan& msg) {
 		this->handleMsgFromMessaging(msg);
 	});
 }
@@ -143,14 +143,14 @@ void ProtocolBridgeClientService::handleTaskFromScheduler(const std::string& tas
 	TRC_LEAVE("");
 }
 
-void ProtocolBridgeClientService::handleMsgFromMessaging(const ustring& msg)
+void ProtocolBridgeClientService::handleMsgFromMessaging(MessageSpan& msg)
 {
 	TRC_ENTER("");
 	TRC_DBG("==================================" << std::endl <<
 		"Received from Messaging: " << std::endl << FORM_HEX(msg.data(), msg.size()));
 
 	//get input message
-	std::string msgs((const char*)msg.data(), msg.size());
+	std::string msgs(msg.chars(), msg.size());
 	//TODO
 	TRC_LEAVE("");
 }
@@ -107,7 +107,7 @@ public:
 	void stop() override;
 
 private:
-	void handleMsgFromMessaging(const ustring& msg);
+	void handleMsgFromMessaging(MessageSpan& msg);
 	void handleTaskFromScheduler(const std::string& task);
 	
 	// data inside FRC STAT response for each Protocol Bridge
@@ -80,7 +80,7 @@ void ClientServicePm::setDaemon(IDaemon* daemon)
 void ClientServicePm::setSerializer(ISerializer* serializer)
 {
   m_serializer = serializer;
-  m_messaging->registerMessageHandler([this](const ustring& msg) {
+  m_messaging->registerMessageHandler([this](MessageSpan& msg) {
     this->handleMsgFromMessaging(msg);
   });
 }
@@ -133,13 +133,13 @@ void ClientServicePm::handleTaskFromScheduler(const std::string& task)
   }
 }
 
-void ClientServicePm::handleMsgFromMessaging(const ustring& msg)
+void ClientServicePm::handleMsgFromMessaging(MessageSpan& msg)
 {
   TRC_DBG("==================================" << std::endl <<
     "Received from Messaging: " << std::endl << FORM_HEX(msg.data(), msg.size()));
 
   //get input message
-  std::string msgs((const char*)msg.data(), msg.size());
+  std::string msgs(msg.chars(), msg.size());
   //TODO
 }
 
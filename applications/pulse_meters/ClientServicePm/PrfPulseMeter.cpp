@@ -16,6 +16,7 @@
 
 #include "PrfPulseMeter.h"
 #include "IqrfLogging.h"
+#include "TimestampFormatter.h"
 
 const std::string PrfPulseMeter::PRF_NAME("Pulsemeter");
 
@@ -312,14 +313,10 @@ std::string PrfPulseMeterJson::encodeResponse(const std::string& errStr)
   }
 
   //TODO time from response or transaction?
-  time_t tt = system_clock::to_time_t(system_clock::now());
-  std::tm* timeinfo = localtime(&tt);
-  timeinfo = localtime(&tt);
-  std::tm timeStr = *timeinfo;
-  char buf[80];
-  strftime(buf, sizeof(buf), "%Y-%m-%d.%X", &timeStr);
-
-  v.SetString(buf, alloc);
+  char buf[TimestampFormatter::SECONDS_SIZE];
+  size_t len = TimestampFormatter::formatSeconds(buf, system_clock::to_time_t(system_clock::now()), '.');
+
+  v.SetString(buf, (rapidjson::SizeType)len, alloc);
   m_doc.AddMember("Time", v, alloc);
 
   m_statusJ = errStr;
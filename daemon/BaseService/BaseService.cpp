@@ -23,6 +23,122 @@
 
 INIT_COMPONENT(IService, BaseService)
 
+/// \class BaseService::PendingDpaTransaction
+/// \brief DPA transaction submitted asynchronously
+/// \details
+/// Owns DpaTask and passes itself to completion queue when finished.
+/// If the service stops before the daemon finishes it, it is aborted and passed to completion queue by the service.
+/// The aborted transaction ignores the daemon then and it is released by both the completion queue and the daemon.
+class BaseService::PendingDpaTransaction : public DpaTransactionTask
+{
+public:
+  PendingDpaTransaction(std::unique_ptr<DpaTask> dpaTask, TaskQueue<PendingDpaTransaction*>& completionQueue,
+    PendingBatch* batch = nullptr, size_t index = 0)
+    :DpaTransactionTask(*dpaTask)
+    , m_dpaTask(std::move(dpaTask))
+    , m_completionQueue(completionQueue)
+    , m_batch(batch)
+    , m_index(index)
+  {
+    m_refs = 1;
+  }
+
+  void processConfirmationMessage(const DpaMessage& confirmation) override
+  {
+    std::lock_guard<std::mutex> lck(m_mutex);
+    if (!m_aborted)
+      DpaTransactionTask::processConfirmationMessage(confirmation);
+  }
+
+  void processResponseMessage(const DpaMessage& response) override
+  {
+    std::lock_guard<std::mutex> lck(m_mutex);
+    if (!m_aborted)
+      DpaTransactionTask::processResponseMessage(response);
+  }
+
+  void processFinish(DpaTransfer::DpaTransferStatus status) override
+  {
+    bool aborted = false;
+    {
+      std::lock_guard<std::mutex> lck(m_mutex);
+      aborted = m_aborted;
+      if (!aborted) {
+        DpaTransactionTask::processFinish(status);
+        m_finished = true;
+      }
+    }
+    if (aborted) {
+      release();
+      return;
+    }
+    //must be the last access as it is deleted in completion queue
+    m_completionQueue.pushToQueue(this);
+  }
+
+  /// \brief abort if not finished by the daemon yet
+  /// \return true if aborted, it has to be passed to completion queue then
+  bool abort()
+  {
+    std::lock_guard<std::mutex> lck(m_mutex);
+    if (m_finished)
+      return false;
+    m_aborted = true;
+    ++m_refs;
+    return true;
+  }
+
+  /// \brief get error of finished or aborted transaction
+  const std::string& getError()
+  {
+    static const std::string ERROR_ABORTED("ERROR_ABORTED");
+    if (m_aborted)
+      return ERROR_ABORTED;
+    waitFinish();
+    return getErrorStr();
+  }
+
+  /// \brief release by the owner, deleted by the last one
+  void release()
+  {
+    if (--m_refs == 0)
+      delete this;
+  }
+
+  DpaTask& getDpaTask() { return *m_dpaTask; }
+  PendingBatch* getBatch() { return m_batch; }
+  size_t getIndex() const { return m_index; }
+
+private:
+  std::unique_ptr<DpaTask> m_dpaTask;
+  TaskQueue<PendingDpaTransaction*>& m_completionQueue;
+  PendingBatch* m_batch;
+  size_t m_index;
+
+  std::mutex m_mutex;
+  bool m_finished = false;
+  std::atomic_bool m_aborted{ false };
+  std::atomic_int m_refs;
+};
+
+/// \class BaseService::PendingBatch
+/// \brief Batch of DPA requests received in one message
+/// \details
+/// Collects item responses, the batch response is sent when the last item is finished.
+/// It is accessed only from completion queue after submit.
+class BaseService::PendingBatch
+{
+public:
+  PendingBatch(ISerializer* serializer, size_t size)
+    :m_serializer(serializer)
+    , m_responses(size)
+  {}
+
+  ISerializer* m_serializer;
+  std::vector<std::string> m_responses;
+  size_t m_pending = 0;
+};
+
 BaseService::BaseService(const std::string & name)
   :m_name(name)
   , m_messaging(nullptr)
@@ -47,7 +163,7 @@ void BaseService::setSerializer(ISerializer* serializer)
 void BaseService::setMessaging(IMessaging* messaging)
 {
   m_messaging = messaging;
-  m_messaging->registerMessageHandler([&](const ustring& msg) {
+  m_messaging->registerMessageHandler([&](MessageSpan& msg) {
     handleMsgFromMessaging(msg);
   });
 }
@@ -56,6 +172,10 @@ void BaseService::update(const rapidjson::Value& cfg)
 {
   TRC_ENTER("");
   m_asyncDpaMessage = jutils::getPossibleMemberAs<bool>("AsyncDpaMessage", cfg, m_asyncDpaMessage);
+  m_asyncSerializerName = jutils::getPossibleMemberAs<std::string>("AsyncSerializer", cfg, m_asyncSerializerName);
+  m_dpaRetries = jutils::getPossibleMemberAs<int>("DpaRetries", cfg, m_dpaRetries);
+  m_maxInFlight = jutils::getPossibleMemberAs<int>("MaxInFlight", cfg, m_maxInFlight);
+  m_stopTimeoutMillis = jutils::getPossibleMemberAs<int>("StopTimeoutMillis", cfg, m_stopTimeoutMillis);
   TRC_LEAVE("");
 }
 
@@ -63,12 +183,33 @@ void BaseService::start()
 {
   TRC_ENTER("");
 
+  m_completionQueue = ant_new TaskQueue<PendingDpaTransaction*>([&](PendingDpaTransaction* pending) {
+    handleDpaCompletion(pending);
+  });
+
+  {
+    std::unique_lock<std::mutex> lck(m_inFlightMutex);
+    m_running = true;
+  }
+
   m_daemon->getScheduler()->registerMessageHandler(m_name, [&](const std::string& msg) {
-    ustring msgu((unsigned char*)msg.data(), msg.size());
-    handleMsgFromMessaging(msgu);
+    MessageSpan span(msg);
+    handleMsgFromMessaging(span);
   });
 
   if (m_asyncDpaMessage) {
+    //asynchronous messages are encoded by configured serializer, e.g. text of SimpleSerializer for its clients
+    m_asyncSerializer = m_serializerVect.empty() ? nullptr : m_serializerVect[0];
+    for (auto ser : m_serializerVect) {
+      if (ser->getName() == m_asyncSerializerName) {
+        m_asyncSerializer = ser;
+        break;
+      }
+    }
+    if (!m_asyncSerializerName.empty() && (!m_asyncSerializer || m_asyncSerializer->getName() != m_asyncSerializerName)) {
+      TRC_WAR("Async serializer not found, the first one is used: " << PAR(m_asyncSerializerName));
+    }
+
     TRC_INF("Set AsyncDpaMessageHandler :" << PAR(m_name));
     m_daemon->registerAsyncMessageHandler(m_name, [&](const DpaMessage& dpaMessage) {
       handleAsyncDpaMessage(dpaMessage);
@@ -86,81 +227,273 @@ void BaseService::stop()
 
   m_daemon->getScheduler()->unregisterMessageHandler(m_name);
 
+  //drain submitted transactions
+  {
+    std::unique_lock<std::mutex> lck(m_inFlightMutex);
+    m_running = false;
+    TRC_DBG("Waiting for: " << PAR(m_inFlight));
+    if (!m_inFlightCondition.wait_for(lck, std::chrono::milliseconds(m_stopTimeoutMillis), [&] { return m_inFlight == 0; })) {
+      //the rest is answered as aborted, the daemon finishes them later
+      TRC_WAR("Submitted transactions not finished => aborted: " << PAR(m_inFlight) << NAME_PAR(transactions, m_submitted.size()));
+      for (auto pending : m_submitted) {
+        if (pending->abort()) {
+          m_completionQueue->pushToQueue(pending);
+        }
+      }
+      m_inFlightCondition.wait(lck, [&] { return m_inFlight == 0; });
+    }
+  }
+  delete m_completionQueue;
+  m_completionQueue = nullptr;
+
   TRC_INF("BaseService :" << PAR(m_name) << " stopped");
   TRC_LEAVE("");
 }
 
-void BaseService::handleMsgFromMessaging(const ustring& msg)
+void BaseService::handleMsgFromMessaging(MessageSpan& msg)
 {
   TRC_INF(std::endl << "<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<" << std::endl <<
     "Message to process: " << std::endl << FORM_HEX(msg.data(), msg.size()));
 
-  //to encode output message
-  std::ostringstream os;
-
-  //get input message
-  std::string msgs((const char*)msg.data(), msg.size());
-  std::istringstream is(msgs);
-
-  std::unique_ptr<DpaTask> dpaTask;
-  std::string command;
+  //output message is encoded directly to the buffer of messaging
+  OutputBuffer output = m_messaging->createOutput();
 
   //parse
   bool handled = false;
-  std::string ctype;
-  std::string lastError = "Unknown ctype";
+  ParsedRequest rejected;
+  ISerializer* rejectedBy = nullptr;
   for (auto ser : m_serializerVect) {
-    ctype = ser->parseCategory(msgs);
+    std::vector<ParsedRequest> items;
+    if (ser->parseBatch(msg, items)) {
+      //response is sent from completion queue
+      submitBatch(ser, items);
+      return;
+    }
+
+    //the message is not copied, it may be parsed in place
+    ParsedRequest parsed = ser->parse(msg);
+    const std::string& ctype = parsed.m_category;
     if (ctype == CAT_DPA_STR) {
-      dpaTask = ser->parseRequest(msgs);
-      if (dpaTask) {
-        DpaTransactionTask trans(*dpaTask);
-        m_daemon->executeDpaTransaction(trans);
-        int result = trans.waitFinish();
-        os << dpaTask->encodeResponse(trans.getErrorStr());
-        //TODO
-        //just stupid hack for test async - remove it
-        ///////
-        //handleAsyncDpaMessage(dpaTask->getResponse());
-        //handleAsyncDpaMessage(dpaTask->getRequest());
-        ///////
-        handled = true;
+      if (parsed.m_dpaTask) {
+        //response is sent from completion queue
+        submitDpaTask(std::move(parsed.m_dpaTask));
+        return;
       }
-      lastError = ser->getLastError();
+      rejected = std::move(parsed);
+      rejectedBy = ser;
       break;
     }
     else if (ctype == CAT_CONF_STR) {
-      command = ser->parseConfig(msgs);
+      const std::string& command = parsed.m_command;
       if (!command.empty()) {
         std::string response = m_daemon->doCommand(command);
-        lastError = ser->getLastError();
-        os << ser->encodeConfig(msgs, response);
+        ser->encodeConfig(parsed.m_request.empty() ? msg.str() : parsed.m_request, response, output);
         handled = true;
+        break;
       }
-      lastError = ser->getLastError();
+      rejected = std::move(parsed);
+      rejectedBy = ser;
       break;
     }
+    else if (!parsed.m_error.empty() && !rejectedBy) {
+      //keep the reason of the first serializer, e.g. invalid member of JSON request
+      rejected = std::move(parsed);
+      rejectedBy = ser;
+    }
   }
 
   if (!handled) {
-    os << "PARSE ERROR: " << PAR(ctype) << PAR(lastError);
+    //the error is encoded by the serializer which rejected the request
+    if (rejected.m_error.empty()) {
+      rejected.m_error = "Unknown ctype";
+    }
+    TRC_WAR("Request rejected: " << NAME_PAR(ctype, rejected.m_category) << NAME_PAR(error, rejected.m_error));
+    if (!rejectedBy && !m_serializerVect.empty()) {
+      rejectedBy = m_serializerVect[0];
+    }
+    if (rejectedBy) {
+      rejectedBy->encodeError(rejected, output);
+    }
+    else {
+      output.append("PARSE ERROR: " + rejected.m_error);
+    }
+  }
+
+  TRC_INF("Response to send: " << std::endl << FORM_HEX(output.data(), output.size()) << std::endl <<
+    ">>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>" << std::endl);
+
+  m_messaging->sendMessage(output);
+}
+
+int BaseService::getRetries(DpaTask& dpaTask) const
+{
+  //retries required by the request override the service ones
+  int retries = m_dpaRetries;
+  DpaRequestOptions* options = dynamic_cast<DpaRequestOptions*>(&dpaTask);
+  if (options && options->getRetries() >= 0) {
+    retries = options->getRetries();
+  }
+  return retries;
+}
+
+const char* BaseService::acquireInFlight()
+{
+  //messaging threads are not blocked, the request is rejected if too many requests are in flight
+  std::unique_lock<std::mutex> lck(m_inFlightMutex);
+  if (!m_running) {
+    return "ERROR_ABORTED";
+  }
+  if (m_maxInFlight > 0 && m_inFlight >= m_maxInFlight) {
+    return "ERROR_BUSY";
+  }
+  ++m_inFlight;
+  return nullptr;
+}
+
+void BaseService::releaseInFlight()
+{
+  {
+    std::unique_lock<std::mutex> lck(m_inFlightMutex);
+    --m_inFlight;
+  }
+  m_inFlightCondition.notify_all();
+}
+
+void BaseService::submitDpaTask(std::unique_ptr<DpaTask> dpaTask)
+{
+  const char* errStr = acquireInFlight();
+  if (errStr) {
+    TRC_WAR("Request rejected: " << NAME_PAR(msgid, dpaTask->getClid()) << PAR(errStr));
+    sendResponse(*dpaTask, errStr);
+    return;
   }
 
-  TRC_INF("Response to send: " << std::endl << FORM_HEX(msg.data(), msg.size()) << std::endl <<
+  TRC_DBG("Submitting: " << NAME_PAR(msgid, dpaTask->getClid()) << PAR(m_inFlight));
+  int retries = getRetries(*dpaTask);
+  PendingDpaTransaction* pending = ant_new PendingDpaTransaction(std::move(dpaTask), *m_completionQueue);
+  {
+    std::unique_lock<std::mutex> lck(m_inFlightMutex);
+    m_submitted.insert(pending);
+  }
+  m_daemon->executeDpaTransaction(*pending, retries);
+}
+
+void BaseService::submitBatch(ISerializer* serializer, std::vector<ParsedRequest>& items)
+{
+  //the whole batch takes one in flight slot
+  const char* errStr = acquireInFlight();
+  if (errStr) {
+    TRC_WAR("Batch rejected: " << NAME_PAR(size, items.size()) << PAR(errStr));
+    std::vector<std::string> responses(items.size());
+    for (size_t i = 0; i < items.size(); i++) {
+      responses[i] = items[i].m_dpaTask ? items[i].m_dpaTask->encodeResponse(errStr) : serializer->encodeBatchError(items[i]);
+    }
+    OutputBuffer output = m_messaging->createOutput();
+    serializer->encodeBatch(responses, output);
+    m_messaging->sendMessage(output);
+    return;
+  }
+
+  PendingBatch* batch = ant_new PendingBatch(serializer, items.size());
+  std::vector<std::pair<DpaTransaction*, int>> transactions;
+  for (size_t i = 0; i < items.size(); i++) {
+    if (items[i].m_dpaTask) {
+      int retries = getRetries(*items[i].m_dpaTask);
+      PendingDpaTransaction* pending = ant_new PendingDpaTransaction(std::move(items[i].m_dpaTask), *m_completionQueue, batch, i);
+      transactions.push_back(std::make_pair(pending, retries));
+    }
+    else {
+      batch->m_responses[i] = serializer->encodeBatchError(items[i]);
+    }
+  }
+  batch->m_pending = transactions.size();
+  {
+    std::unique_lock<std::mutex> lck(m_inFlightMutex);
+    for (const auto& trn : transactions) {
+      m_submitted.insert(static_cast<PendingDpaTransaction*>(trn.first));
+    }
+  }
+
+  TRC_DBG("Submitting batch: " << NAME_PAR(size, items.size()) << NAME_PAR(transactions, transactions.size()) << PAR(m_inFlight));
+  if (transactions.empty()) {
+    sendBatch(batch);
+  }
+  else {
+    m_daemon->executeDpaTransactions(transactions);
+  }
+}
+
+void BaseService::sendBatch(PendingBatch* batch)
+{
+  OutputBuffer output = m_messaging->createOutput();
+  batch->m_serializer->encodeBatch(batch->m_responses, output);
+  delete batch;
+
+  TRC_INF("Batch response to send: " << std::endl <<
+    FORM_HEX(output.data(), output.size()) << std::endl <<
     ">>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>" << std::endl);
 
-  ustring msgu((unsigned char*)os.str().data(), os.str().size());
-  m_messaging->sendMessage(msgu);
+  m_messaging->sendMessage(output);
+  releaseInFlight();
+}
+
+//called from completion queue thread
+void BaseService::handleDpaCompletion(PendingDpaTransaction* pending)
+{
+  const std::string& errStr = pending->getError();
+  {
+    std::unique_lock<std::mutex> lck(m_inFlightMutex);
+    m_submitted.erase(pending);
+  }
+
+  PendingBatch* batch = pending->getBatch();
+  if (batch) {
+    //items are joined by the serializer when the batch is finished
+    batch->m_responses[pending->getIndex()] = pending->getDpaTask().encodeResponse(errStr);
+    pending->release();
+    if (--batch->m_pending == 0) {
+      sendBatch(batch);
+    }
+    return;
+  }
+
+  sendResponse(pending->getDpaTask(), errStr);
+  pending->release();
+  releaseInFlight();
+}
+
+void BaseService::sendResponse(DpaTask& dpaTask, const std::string& errStr)
+{
+  //response is encoded directly to the buffer of messaging if the task supports it
+  OutputBuffer output = m_messaging->createOutput();
+  DpaResponseOutput* responseOutput = dynamic_cast<DpaResponseOutput*>(&dpaTask);
+  if (responseOutput) {
+    responseOutput->encodeResponseTo(errStr, output);
+  }
+  else {
+    output.append(dpaTask.encodeResponse(errStr));
+  }
+
+  TRC_INF("Response to send: " << NAME_PAR(msgid, dpaTask.getClid()) << std::endl <<
+    FORM_HEX(output.data(), output.size()) << std::endl <<
+    ">>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>" << std::endl);
+
+  m_messaging->sendMessage(output);
 }
 
 void BaseService::handleAsyncDpaMessage(const DpaMessage& dpaMessage)
 {
   TRC_ENTER("");
-  std::string sr = m_serializerVect[0]->encodeAsyncAsDpaRaw(dpaMessage);
+  if (!m_asyncSerializer) {
+    TRC_WAR("No serializer to encode asynchronous message");
+    TRC_LEAVE("");
+    return;
+  }
+  OutputBuffer output = m_messaging->createOutput();
+  m_asyncSerializer->encodeAsyncAsDpaRaw(dpaMessage, output);
   TRC_INF(std::endl << "<<<<< ASYNCHRONOUS <<<<<<<<<<<<<<<" << std::endl <<
-    "Asynchronous message to send: " << std::endl << FORM_HEX(sr.data(), sr.size()) << std::endl <<
+    "Asynchronous message to send: " << std::endl << FORM_HEX(output.data(), output.size()) << std::endl <<
     ">>>>> ASYNCHRONOUS >>>>>>>>>>>>>>>" << std::endl);
-  ustring msgu((unsigned char*)sr.data(), sr.size());
-  m_messaging->sendMessage(msgu);
+  m_messaging->sendMessage(output);
   TRC_LEAVE("");
 }
@@ -21,8 +21,13 @@
 #include "ISerializer.h"
 #include "IMessaging.h"
 #include "IScheduler.h"
+#include "TaskQueue.h"
 #include <string>
 #include <vector>
+#include <set>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
 
 class IDaemon;
 
@@ -39,10 +44,21 @@ typedef std::basic_string<unsigned char> ustring;
 /// received via IMessaging. It selects appropriate ISerializer instance according incoming messages types.
 /// It gets via IDaemon IScheduler to access scheduler methods.
 ///
+/// DPA requests are submitted asynchronously and responses are sent as soon as the transactions are finished,
+/// so they may be sent in different order than requests arrived. Clients correlate them by msgid.
+/// If MaxInFlight requests are already submitted, next request is answered immediately with status ERROR_BUSY.
+/// When the service stops, requests not finished within StopTimeoutMillis are answered with status ERROR_ABORTED.
+/// A batch of DPA requests (e.g. JSON array) is executed back to back and answered by one response
+/// holding item responses in order of requests. The batch takes one in flight slot.
+///
 /// Configurable via its update() method accepting JSON properties:
 /// ```json
 /// "Properties": {
-///   "AsyncDpaMessage": true  #process asynchronous DPA message
+///   "AsyncDpaMessage": true,   #process asynchronous DPA message
+///   "AsyncSerializer": "",     #name of serializer encoding asynchronous DPA messages, the first one if empty
+///   "DpaRetries": -1,          #retries of failed DPA transactions, negative value means daemon default
+///   "MaxInFlight": 16,         #max number of submitted DPA requests, 0 means unlimited
+///   "StopTimeoutMillis": 5000  #max wait for submitted DPA requests when stopped
 /// }
 /// ```
 class BaseService : public IService
@@ -66,12 +82,35 @@ public:
   void stop() override;
 
 private:
-  void handleMsgFromMessaging(const ustring& msg);
+  void handleMsgFromMessaging(MessageSpan& msg);
   void handleAsyncDpaMessage(const DpaMessage& dpaMessage);
 
+  class PendingDpaTransaction;
+  class PendingBatch;
+  int getRetries(DpaTask& dpaTask) const;
+  const char* acquireInFlight();
+  void releaseInFlight();
+  void submitDpaTask(std::unique_ptr<DpaTask> dpaTask);
+  void sendResponse(DpaTask& dpaTask, const std::string& errStr);
+  void submitBatch(ISerializer* serializer, std::vector<ParsedRequest>& items);
+  void sendBatch(PendingBatch* batch);
+  void handleDpaCompletion(PendingDpaTransaction* pending);
+
   std::string m_name;
   IMessaging* m_messaging;
   IDaemon* m_daemon;
   std::vector<ISerializer*> m_serializerVect;
   bool m_asyncDpaMessage = false;
+  std::string m_asyncSerializerName;
+  ISerializer* m_asyncSerializer = nullptr;
+  int m_dpaRetries = -1;
+
+  TaskQueue<PendingDpaTransaction*>* m_completionQueue = nullptr;
+  int m_maxInFlight = 16;
+  int m_inFlight = 0;
+  int m_stopTimeoutMillis = 5000;
+  bool m_running = false;
+  std::set<PendingDpaTransaction*> m_submitted;
+  std::mutex m_inFlightMutex;
+  std::condition_variable m_inFlightCondition;
 };
@@ -0,0 +1,230 @@
+/**
+ * Copyright 2016-2017 MICRORISC s.r.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LaunchUtils.h"
+#include "BinarySerializer.h"
+#include "IqrfLogging.h"
+#include <chrono>
+#include <stdexcept>
+
+INIT_COMPONENT(ISerializer, BinarySerializer)
+
+namespace {
+  uint32_t getUint32(const std::string& from, size_t pos)
+  {
+    return (uint32_t)(uint8_t)from[pos] | ((uint32_t)(uint8_t)from[pos + 1] << 8) |
+      ((uint32_t)(uint8_t)from[pos + 2] << 16) | ((uint32_t)(uint8_t)from[pos + 3] << 24);
+  }
+
+  void putUint32(OutputBuffer& to, uint32_t val)
+  {
+    to.push_back((char)(val & 0xFF));
+    to.push_back((char)((val >> 8) & 0xFF));
+    to.push_back((char)((val >> 16) & 0xFF));
+    to.push_back((char)((val >> 24) & 0xFF));
+  }
+
+  uint32_t delayMillis(std::chrono::time_point<std::chrono::system_clock> from,
+    std::chrono::time_point<std::chrono::system_clock> to)
+  {
+    if (to < from) {
+      return 0;
+    }
+    return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(to - from).count();
+  }
+}
+
+//-------------------------------
+PrfRawBinary::PrfRawBinary(const std::string& request)
+{
+  if (!isBinary(request) || request.size() < REQUEST_HEADER_SIZE + sizeof(TDpaIFaceHeader)) {
+    THROW_EX(std::logic_error, "Unexpected header: " << NAME_PAR(size, request.size()));
+  }
+  if ((uint8_t)request[1] != VERSION) {
+    THROW_EX(std::logic_error, "Unsupported version: " << NAME_PAR(version, (int)(uint8_t)request[1]));
+  }
+
+  size_t len = request.size() - REQUEST_HEADER_SIZE;
+  if (len > MAX_DPA_BUFFER) {
+    THROW_EX(std::logic_error, "DPA request too long: " << PAR(len));
+  }
+
+  m_flags = (uint8_t)request[2] & ~(FLAG_RESPONSE | FLAG_ASYNC);
+  m_correlationId = getUint32(request, 4);
+  setClid(std::to_string(m_correlationId));
+
+  int timeout = (int)getUint32(request, 8);
+  if (timeout > 0) {
+    setTimeout(timeout);
+  }
+
+  m_request.DataToBuffer((const unsigned char*)request.data() + REQUEST_HEADER_SIZE, (uint32_t)len);
+}
+
+std::string PrfRawBinary::encodeResponse(const std::string& errStr)
+{
+  OutputBuffer output;
+  encodeResponseTo(errStr, output);
+  return output.str();
+}
+
+void PrfRawBinary::encodeResponseTo(const std::string& errStr, OutputBuffer& output)
+{
+  Status status = Status::Error;
+  if (errStr == "STATUS_NO_ERROR") {
+    status = Status::Ok;
+  }
+  else if (errStr == "ERROR_TIMEOUT") {
+    status = Status::Timeout;
+  }
+  else if (errStr == "ERROR_ABORTED") {
+    status = Status::Aborted;
+  }
+
+  int len = m_response.GetLength();
+  if (len < 0) {
+    len = 0;
+  }
+
+  output.reserve(output.size() + RESPONSE_HEADER_SIZE + len);
+  encodeHeader(output, m_flags | FLAG_RESPONSE, status, m_correlationId,
+    delayMillis(getRequestTs(), getConfirmationTs()), delayMillis(getRequestTs(), getResponseTs()));
+  output.append((const char*)m_response.DpaPacketData(), len);
+}
+
+void PrfRawBinary::encodeAsync(const DpaMessage& dpaMessage, OutputBuffer& output)
+{
+  int len = dpaMessage.GetLength();
+  if (len < 0) {
+    len = 0;
+  }
+
+  output.reserve(output.size() + RESPONSE_HEADER_SIZE + len);
+  encodeHeader(output, FLAG_RESPONSE | FLAG_ASYNC, Status::Ok, 0, 0, 0);
+  output.append((const char*)dpaMessage.DpaPacketData(), len);
+}
+
+bool PrfRawBinary::isBinary(const std::string& request)
+{
+  return !request.empty() && (uint8_t)request[0] == MAGIC;
+}
+
+void PrfRawBinary::encodeHeader(OutputBuffer& to, uint8_t flags, Status status, uint32_t correlationId,
+  uint32_t confirmationDelay, uint32_t responseDelay)
+{
+  to.push_back((char)MAGIC);
+  to.push_back((char)VERSION);
+  to.push_back((char)flags);
+  to.push_back((char)status);
+  putUint32(to, correlationId);
+  putUint32(to, confirmationDelay);
+  putUint32(to, responseDelay);
+}
+
+///////////////////////////////////////////
+BinarySerializer::BinarySerializer()
+  :m_name("Binary")
+{
+}
+
+BinarySerializer::BinarySerializer(const std::string& name)
+  :m_name(name)
+{
+}
+
+std::string BinarySerializer::parseCategory(const std::string& request)
+{
+  if (PrfRawBinary::isBinary(request)) {
+    return CAT_DPA_STR;
+  }
+  m_lastError = "Not binary message";
+  return "";
+}
+
+std::unique_ptr<DpaTask> BinarySerializer::parseRequest(const std::string& request)
+{
+  m_lastError = "OK";
+  return parseRequest(request, m_lastError);
+}
+
+std::unique_ptr<DpaTask> BinarySerializer::parseRequest(const std::string& request, std::string& error)
+{
+  std::unique_ptr<DpaTask> obj;
+  try {
+    obj.reset(ant_new PrfRawBinary(request));
+  }
+  catch (std::exception &e) {
+    error = e.what();
+  }
+  return obj;
+}
+
+std::string BinarySerializer::parseConfig(const std::string& request)
+{
+  m_lastError = "Configuration is not supported";
+  return "";
+}
+
+std::string BinarySerializer::encodeConfig(const std::string& request, const std::string& response)
+{
+  return "";
+}
+
+std::string BinarySerializer::getLastError() const
+{
+  return m_lastError;
+}
+
+std::string BinarySerializer::encodeAsyncAsDpaRaw(const DpaMessage& dpaMessage) const
+{
+  OutputBuffer output;
+  PrfRawBinary::encodeAsync(dpaMessage, output);
+  return output.str();
+}
+
+void BinarySerializer::encodeAsyncAsDpaRaw(const DpaMessage& dpaMessage, OutputBuffer& output) const
+{
+  PrfRawBinary::encodeAsync(dpaMessage, output);
+}
+
+ParsedRequest BinarySerializer::parse(const std::string& request)
+{
+  ParsedRequest parsed;
+  if (PrfRawBinary::isBinary(request)) {
+    parsed.m_category = CAT_DPA_STR;
+    parsed.m_dpaTask = parseRequest(request, parsed.m_error);
+  }
+  else {
+    parsed.m_error = "Not binary message";
+  }
+  return parsed;
+}
+
+ParsedRequest BinarySerializer::parse(MessageSpan& request)
+{
+  //just binary message is copied
+  if (request.empty() || request[0] != PrfRawBinary::MAGIC) {
+    ParsedRequest parsed;
+    parsed.m_error = "Not binary message";
+    return parsed;
+  }
+  return parse(request.str());
+}
+
+bool BinarySerializer::parseBatch(MessageSpan& request, std::vector<ParsedRequest>& items)
+{
+  return false;
+}
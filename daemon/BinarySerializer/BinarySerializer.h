@@ -0,0 +1,137 @@
+/**
+ * Copyright 2016-2017 MICRORISC s.r.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "ISerializer.h"
+#include "DpaRaw.h"
+#include "PlatformDep.h"
+#include <string>
+#include <cstdint>
+
+/// \class PrfRawBinary
+/// \brief Parse/encode binary message holding raw DPA message
+/// \details
+/// Binary messages are intended for machine clients to avoid text encoding at all.
+/// All multibyte fields are little endian.
+///
+/// Request: fixed header followed by raw DPA request
+/// ```
+/// magic 0xD5 (1B), version 1 (1B), flags (1B), reserved (1B), correlation id (4B),
+/// timeout in ms, 0 means default (4B), DPA request (6B and more)
+/// ```
+///
+/// Response: fixed header followed by raw DPA response, empty if there is no response
+/// ```
+/// magic 0xD5 (1B), version 1 (1B), flags (1B), status (1B), correlation id (4B),
+/// confirmation delay in ms (4B), response delay in ms (4B), DPA response
+/// ```
+/// Request flags are echoed in response, bits FLAG_RESPONSE and FLAG_ASYNC are reserved for the response.
+/// Asynchronous messages are sent with FLAG_ASYNC and correlation id 0, the DPA message follows header.
+class PrfRawBinary : public DpaRaw, public DpaResponseOutput
+{
+public:
+  static const uint8_t MAGIC = 0xD5;
+  static const uint8_t VERSION = 1;
+  static const size_t REQUEST_HEADER_SIZE = 12;
+  static const size_t RESPONSE_HEADER_SIZE = 16;
+
+  /// flag set in response
+  static const uint8_t FLAG_RESPONSE = 0x80;
+  /// flag set in asynchronous message
+  static const uint8_t FLAG_ASYNC = 0x40;
+
+  /// \brief status of DPA transaction
+  enum class Status : uint8_t {
+    Ok = 0,
+    Timeout = 1,
+    Aborted = 2,
+    Error = 0xFF
+  };
+
+  /// \brief parametric constructor
+  /// \param [in] request binary message to be parsed
+  /// \throws std::logic_error in case of malformed message
+  explicit PrfRawBinary(const std::string& request);
+  virtual ~PrfRawBinary() {}
+
+  /// \brief DpaTask overriden method
+  /// \param [in] errStr result of DpaTask handling in IQRF mesh to be stored in message
+  /// \return encoded message
+  std::string encodeResponse(const std::string& errStr) override;
+
+  /// \brief DpaResponseOutput overriden method
+  /// \param [in] errStr result of DpaTask handling in IQRF mesh to be stored in message
+  /// \param [out] output buffer the encoded message is appended to
+  void encodeResponseTo(const std::string& errStr, OutputBuffer& output) override;
+
+  /// \brief encode asynchronous DPA message
+  /// \param [in] dpaMessage message to be encoded
+  /// \param [out] output buffer the encoded message is appended to
+  static void encodeAsync(const DpaMessage& dpaMessage, OutputBuffer& output);
+
+  /// \brief check binary message header
+  /// \param [in] request message to be checked
+  /// \return true if the message is binary DPA request
+  static bool isBinary(const std::string& request);
+
+private:
+  static void encodeHeader(OutputBuffer& to, uint8_t flags, Status status, uint32_t correlationId,
+    uint32_t confirmationDelay, uint32_t responseDelay);
+
+  uint8_t m_flags = 0;
+  uint32_t m_correlationId = 0;
+};
+
+/// \class BinarySerializer
+/// \brief Creates DpaRaw objects from binary messages
+/// \details
+/// Fast lane for machine clients. Only raw DPA requests are supported, configuration requests are not.
+/// It shall be listed after JsonSerializer in BaseService configuration, SimpleSerializer would accept
+/// binary message as its own.
+class BinarySerializer : public ISerializer
+{
+public:
+  BinarySerializer();
+
+  /// parametric constructor
+  /// \param [in] name instance name
+  BinarySerializer(const std::string& name);
+  virtual ~BinarySerializer() {}
+
+  /// ISerializer overriden methods
+  const std::string& getName() const override { return m_name; }
+  std::string parseCategory(const std::string& request) override;
+  std::unique_ptr<DpaTask> parseRequest(const std::string& request) override;
+  std::string parseConfig(const std::string& request) override;
+  std::string encodeConfig(const std::string& request, const std::string& response) override;
+  std::string getLastError() const override;
+  std::string encodeAsyncAsDpaRaw(const DpaMessage& dpaMessage) const override;
+  void encodeAsyncAsDpaRaw(const DpaMessage& dpaMessage, OutputBuffer& output) const override;
+  ParsedRequest parse(const std::string& request) override;
+  ParsedRequest parse(MessageSpan& request) override;
+  bool parseBatch(MessageSpan& request, std::vector<ParsedRequest>& items) override;
+
+private:
+  /// \brief Create DpaTask from binary message
+  /// \param [in] request binary message
+  /// \param [out] error description of error
+  /// \return created task, empty in case of error
+  std::unique_ptr<DpaTask> parseRequest(const std::string& request, std::string& error);
+
+  std::string m_lastError;
+  std::string m_name;
+};
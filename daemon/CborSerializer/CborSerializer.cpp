@@ -0,0 +1,452 @@
+/**
+ * Copyright 2016-2017 MICRORISC s.r.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LaunchUtils.h"
+#include "CborSerializer.h"
+#include "IqrfLogging.h"
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+INIT_COMPONENT(ISerializer, CborSerializer)
+
+using namespace rapidjson;
+
+namespace {
+  /// CBOR major types
+  enum MajorType : uint8_t {
+    UNSIGNED = 0,
+    NEGATIVE = 1,
+    BYTES = 2,
+    TEXT = 3,
+    ARRAY = 4,
+    MAP = 5,
+    TAG = 6,
+    SIMPLE = 7
+  };
+
+  /// additional information of indefinite length
+  const uint8_t INDEFINITE = 31;
+  /// terminator of indefinite length item
+  const uint8_t BREAK = 0xFF;
+
+  /// maximal nesting of incoming messages
+  const int MAX_DEPTH = 16;
+
+  /// \class CborWriter
+  /// \brief Writes document as CBOR
+  class CborWriter
+  {
+  public:
+    explicit CborWriter(OutputBuffer& to)
+      :m_to(to)
+    {}
+
+    /// \brief Write value
+    /// \param [in] val value to be written
+    /// \param [in] binaryMembers bits of members of object val written as byte strings by order of the members
+    /// \param [in] binary string val is written as byte string
+    void write(const Value& val, uint64_t binaryMembers = 0, bool binary = false)
+    {
+      switch (val.GetType()) {
+      case kNullType:
+        m_to.push_back((char)0xF6);
+        break;
+      case kFalseType:
+        m_to.push_back((char)0xF4);
+        break;
+      case kTrueType:
+        m_to.push_back((char)0xF5);
+        break;
+      case kNumberType:
+        writeNumber(val);
+        break;
+      case kStringType:
+        writeHead(binary ? BYTES : TEXT, val.GetStringLength());
+        m_to.append(val.GetString(), val.GetStringLength());
+        break;
+      case kArrayType:
+        writeHead(ARRAY, val.Size());
+        for (auto itr = val.Begin(); itr != val.End(); ++itr)
+          write(*itr);
+        break;
+      case kObjectType:
+      {
+        writeHead(MAP, val.MemberCount());
+        uint64_t bit = 1;
+        for (auto itr = val.MemberBegin(); itr != val.MemberEnd(); ++itr, bit <<= 1) {
+          writeText(itr->name.GetString(), itr->name.GetStringLength());
+          write(itr->value, 0, (binaryMembers & bit) != 0);
+        }
+      }
+      break;
+      }
+    }
+
+    void writeHead(MajorType type, uint64_t val)
+    {
+      uint8_t major = (uint8_t)(type << 5);
+      if (val < 24) {
+        m_to.push_back((char)(major | val));
+      }
+      else if (val <= 0xFF) {
+        m_to.push_back((char)(major | 24));
+        putBigEndian(val, 1);
+      }
+      else if (val <= 0xFFFF) {
+        m_to.push_back((char)(major | 25));
+        putBigEndian(val, 2);
+      }
+      else if (val <= 0xFFFFFFFF) {
+        m_to.push_back((char)(major | 26));
+        putBigEndian(val, 4);
+      }
+      else {
+        m_to.push_back((char)(major | 27));
+        putBigEndian(val, 8);
+      }
+    }
+
+  private:
+    void putBigEndian(uint64_t val, int len)
+    {
+      for (int i = len - 1; i >= 0; i--)
+        m_to.push_back((char)((val >> (8 * i)) & 0xFF));
+    }
+
+    void writeNumber(const Value& val)
+    {
+      if (val.IsUint64()) {
+        writeHead(UNSIGNED, val.GetUint64());
+      }
+      else if (val.IsInt64()) {
+        writeHead(NEGATIVE, (uint64_t)(-1 - val.GetInt64()));
+      }
+      else {
+        double d = val.GetDouble();
+        float f = (float)d;
+        if ((double)f == d) {
+          uint32_t bits;
+          memcpy(&bits, &f, sizeof(bits));
+          m_to.push_back((char)0xFA);
+          putBigEndian(bits, 4);
+        }
+        else {
+          uint64_t bits;
+          memcpy(&bits, &d, sizeof(bits));
+          m_to.push_back((char)0xFB);
+          putBigEndian(bits, 8);
+        }
+      }
+    }
+
+    void writeText(const char* str, SizeType len)
+    {
+      writeHead(TEXT, len);
+      m_to.append(str, len);
+    }
+
+    OutputBuffer& m_to;
+  };
+
+  /// \class CborReader
+  /// \brief Reads CBOR to document
+  class CborReader
+  {
+  public:
+    CborReader(const uint8_t* from, size_t size, Document::AllocatorType& alloc)
+      :m_from(from)
+      , m_size(size)
+      , m_alloc(alloc)
+    {}
+
+    void read(Value& val)
+    {
+      readItem(val, 0);
+      if (m_pos != m_size) {
+        THROW_EX(std::logic_error, "Cbor parse error: trailing data " << NAME_PAR(eoffset, m_pos));
+      }
+    }
+
+  private:
+    uint8_t getByte()
+    {
+      if (m_pos >= m_size) {
+        THROW_EX(std::logic_error, "Cbor parse error: unexpected end " << NAME_PAR(eoffset, m_pos));
+      }
+      return m_from[m_pos++];
+    }
+
+    uint64_t getBigEndian(int len)
+    {
+      uint64_t val = 0;
+      for (int i = 0; i < len; i++)
+        val = (val << 8) | getByte();
+      return val;
+    }
+
+    uint64_t getArgument(uint8_t info)
+    {
+      if (info < 24)
+        return info;
+      switch (info) {
+      case 24: return getBigEndian(1);
+      case 25: return getBigEndian(2);
+      case 26: return getBigEndian(4);
+      case 27: return getBigEndian(8);
+      default:
+        THROW_EX(std::logic_error, "Cbor parse error: unexpected additional info " << NAME_PAR(eoffset, m_pos - 1));
+      }
+    }
+
+    bool isBreak()
+    {
+      if (m_pos < m_size && m_from[m_pos] == BREAK) {
+        m_pos++;
+        return true;
+      }
+      return false;
+    }
+
+    /// gets definite or concatenates indefinite length string
+    void readString(std::string& str, MajorType type, uint8_t info)
+    {
+      if (info == INDEFINITE) {
+        while (!isBreak()) {
+          uint8_t initial = getByte();
+          if ((MajorType)(initial >> 5) != type || (initial & 0x1F) == INDEFINITE) {
+            THROW_EX(std::logic_error, "Cbor parse error: unexpected chunk " << NAME_PAR(eoffset, m_pos - 1));
+          }
+          readString(str, type, initial & 0x1F);
+        }
+        return;
+      }
+      uint64_t len = getArgument(info);
+      if (len > m_size - m_pos) {
+        THROW_EX(std::logic_error, "Cbor parse error: unexpected end " << NAME_PAR(eoffset, m_pos));
+      }
+      str.append((const char*)m_from + m_pos, (size_t)len);
+      m_pos += (size_t)len;
+    }
+
+    void readItem(Value& val, int depth)
+    {
+      if (depth > MAX_DEPTH) {
+        THROW_EX(std::logic_error, "Cbor parse error: too deep nesting " << NAME_PAR(eoffset, m_pos));
+      }
+
+      uint8_t initial = getByte();
+      MajorType type = (MajorType)(initial >> 5);
+      uint8_t info = initial & 0x1F;
+
+      switch (type) {
+      case UNSIGNED:
+        val.SetUint64(getArgument(info));
+        break;
+
+      case NEGATIVE:
+      {
+        uint64_t arg = getArgument(info);
+        if (arg <= (uint64_t)INT64_MAX)
+          val.SetInt64(-1 - (int64_t)arg);
+        else
+          val.SetDouble(-1.0 - (double)arg);
+      }
+      break;
+
+      case BYTES:
+      case TEXT:
+        //byte strings are passed to parsers of binary members as raw bytes
+        m_string.clear();
+        readString(m_string, type, info);
+        val.SetString(m_string.data(), (SizeType)m_string.size(), m_alloc);
+        break;
+
+      case ARRAY:
+      {
+        val.SetArray();
+        bool indefinite = info == INDEFINITE;
+        uint64_t count = indefinite ? 0 : getArgument(info);
+        for (uint64_t i = 0; indefinite ? !isBreak() : i < count; i++) {
+          Value item;
+          readItem(item, depth + 1);
+          val.PushBack(item, m_alloc);
+        }
+      }
+      break;
+
+      case MAP:
+      {
+        val.SetObject();
+        bool indefinite = info == INDEFINITE;
+        uint64_t count = indefinite ? 0 : getArgument(info);
+        for (uint64_t i = 0; indefinite ? !isBreak() : i < count; i++) {
+          if (m_pos < m_size && (MajorType)(m_from[m_pos] >> 5) != TEXT) {
+            THROW_EX(std::logic_error, "Cbor parse error: map key is not text " << NAME_PAR(eoffset, m_pos));
+          }
+          Value name;
+          readItem(name, depth + 1);
+          Value item;
+          readItem(item, depth + 1);
+          val.AddMember(name, item, m_alloc);
+        }
+      }
+      break;
+
+      case TAG:
+        //semantic tags are ignored
+        getArgument(info);
+        readItem(val, depth + 1);
+        break;
+
+      case SIMPLE:
+        readSimple(val, info);
+        break;
+      }
+    }
+
+    void readSimple(Value& val, uint8_t info)
+    {
+      switch (info) {
+      case 20: val.SetBool(false); break;
+      case 21: val.SetBool(true); break;
+      case 22: //null
+      case 23: //undefined
+        val.SetNull();
+        break;
+      case 25:
+        val.SetDouble(halfToDouble((uint16_t)getBigEndian(2)));
+        break;
+      case 26:
+      {
+        uint32_t bits = (uint32_t)getBigEndian(4);
+        float f;
+        memcpy(&f, &bits, sizeof(f));
+        val.SetDouble(f);
+      }
+      break;
+      case 27:
+      {
+        uint64_t bits = getBigEndian(8);
+        double d;
+        memcpy(&d, &bits, sizeof(d));
+        val.SetDouble(d);
+      }
+      break;
+      default:
+        THROW_EX(std::logic_error, "Cbor parse error: unexpected simple value " << NAME_PAR(eoffset, m_pos - 1));
+      }
+    }
+
+    static double halfToDouble(uint16_t half)
+    {
+      int exp = (half >> 10) & 0x1F;
+      int mant = half & 0x3FF;
+      double val;
+      if (exp == 0)
+        val = std::ldexp(mant, -24);
+      else if (exp != 31)
+        val = std::ldexp(mant + 1024, exp - 25);
+      else
+        val = mant == 0 ? INFINITY : NAN;
+      return (half & 0x8000) ? -val : val;
+    }
+
+    const uint8_t* m_from;
+    size_t m_size;
+    size_t m_pos = 0;
+    Document::AllocatorType& m_alloc;
+    std::string m_string;
+  };
+
+  /// \brief Write document as CBOR
+  /// \param [in] val document to be written
+  /// \param [in] binaryMembers bits of members of the document holding raw bytes by order of the members
+  /// \param [out] output buffer the CBOR is appended to
+  void writeCbor(const rapidjson::Value& val, uint64_t binaryMembers, OutputBuffer& output)
+  {
+    CborWriter writer(output);
+    writer.write(val, binaryMembers);
+  }
+}
+
+CborSerializer::CborSerializer()
+  :JsonSerializer("Cbor", true)
+{
+}
+
+CborSerializer::CborSerializer(const std::string& name)
+  :JsonSerializer(name, true)
+{
+}
+
+std::string CborSerializer::encodeBatch(const std::vector<std::string>& responses)
+{
+  OutputBuffer output;
+  encodeBatch(responses, output);
+  return output.str();
+}
+
+void CborSerializer::encodeBatch(const std::vector<std::string>& responses, OutputBuffer& output)
+{
+  //items are already complete CBOR items
+  CborWriter writer(output);
+  writer.writeHead(ARRAY, responses.size());
+  for (const auto& rsp : responses) {
+    output.append(rsp);
+  }
+}
+
+bool CborSerializer::parseDocument(MessageSpan& request, rapidjson::Document& doc, std::string& error, RequestError& info) const
+{
+  //avoid interpretation of other formats, request is CBOR map or array
+  MajorType type = request.empty() ? UNSIGNED : (MajorType)(request[0] >> 5);
+  if (type != MAP && type != ARRAY) {
+    error = "Cbor parse error: map or array expected";
+    return false;
+  }
+
+  try {
+    //strings are copied to the document, so the message is left intact for other serializers
+    CborReader reader(request.data(), request.size(), doc.GetAllocator());
+    reader.read(doc);
+  }
+  catch (std::exception &e) {
+    error = e.what();
+    return false;
+  }
+
+  //items of batch are validated one by one
+  return type == ARRAY || m_requestSchema->validate(doc, error, info);
+}
+
+void CborSerializer::writeDocument(const rapidjson::Value& val, OutputBuffer& output) const
+{
+  writeCbor(val, 0, output);
+}
+
+bool CborSerializer::isBatch(const MessageSpan& request) const
+{
+  return !request.empty() && (MajorType)(request[0] >> 5) == ARRAY;
+}
+
+void CborSerializer::initOutput(PrfCommonJson& common) const
+{
+  common.m_rawBinary = true;
+  common.m_documentWriter = writeCbor;
+}
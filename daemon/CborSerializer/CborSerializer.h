@@ -0,0 +1,55 @@
+/**
+ * Copyright 2016-2017 MICRORISC s.r.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "JsonSerializer.h"
+#include <string>
+
+/// \class CborSerializer
+/// \brief Object factory to create DpaTask objects from incoming CBOR messages
+/// \details
+/// CBOR (RFC 7049) messages carry the same request and response model as JsonSerializer and the same
+/// DpaTask classes registered via registerClass() are used. Binary data of DPA messages are encoded as
+/// CBOR byte strings instead of dotted hexadecimal text, so messages are several times smaller and cheaper
+/// to be encoded and decoded. It is intended for bandwidth constrained links.
+///
+/// Binary members described by JsonField tables with JSON_FIELD_BINARY, e.g. request, rdata or user_data,
+/// are byte strings in both directions and their raw bytes are passed to and from DPA messages without
+/// hexadecimal text. Other strings are text strings.
+/// Maps and arrays of definite and indefinite length are accepted, output uses definite length.
+/// A batch is CBOR array of requests answered by CBOR array of responses.
+class CborSerializer : public JsonSerializer
+{
+public:
+  CborSerializer();
+
+  /// parametric constructor
+  /// \param [in] name instance name
+  CborSerializer(const std::string& name);
+  virtual ~CborSerializer() {}
+
+  ///  ISerializer overriden methods
+  std::string encodeBatch(const std::vector<std::string>& responses) override;
+  void encodeBatch(const std::vector<std::string>& responses, OutputBuffer& output) override;
+
+protected:
+  /// JsonSerializer overriden methods
+  bool parseDocument(MessageSpan& request, rapidjson::Document& doc, std::string& error, RequestError& info) const override;
+  void writeDocument(const rapidjson::Value& val, OutputBuffer& output) const override;
+  bool isBatch(const MessageSpan& request) const override;
+  void initOutput(PrfCommonJson& common) const override;
+};
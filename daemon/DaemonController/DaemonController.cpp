@@ -21,6 +21,10 @@
 #include "IqrfLogging.h"
 #include "LaunchUtils.h"
 #include "DaemonController.h"
+#include "NodeRegistry.h"
+#include "DpaRetryTransaction.h"
+#include "DpaRecorder.h"
+#include "IqrfReplayChannel.h"
 #include "IqrfCdcChannel.h"
 #include "IqrfSpiChannel.h"
 #include "DpaHandler.h"
@@ -49,50 +53,143 @@ DaemonController& DaemonController::getController()
 
 void DaemonController::executeDpaTransaction(DpaTransaction& dpaTransaction)
 {
-  m_dpaTransactionQueue->pushToQueue(&dpaTransaction);
+  executeDpaTransaction(dpaTransaction, -1);
+}
+
+void DaemonController::executeDpaTransaction(DpaTransaction& dpaTransaction, int retries)
+{
+  DpaTransactionItem item;
+  item.m_transaction = &dpaTransaction;
+  item.m_retries = retries;
+  m_dpaTransactionQueue->pushToQueue(item);
+}
+
+void DaemonController::executeDpaTransactions(const std::vector<std::pair<DpaTransaction*, int>>& dpaTransactions)
+{
+  std::vector<DpaTransactionItem> items;
+  items.reserve(dpaTransactions.size());
+  for (const auto& trn : dpaTransactions) {
+    DpaTransactionItem item;
+    item.m_transaction = trn.first;
+    item.m_retries = trn.second;
+    items.push_back(item);
+  }
+  m_dpaTransactionQueue->pushToQueue(items);
 }
 
 //called from task queue thread passed by lambda in task queue ctor
-void DaemonController::executeDpaTransactionFunc(DpaTransaction* dpaTransaction)
+void DaemonController::executeDpaTransactionFunc(const DpaTransactionItem& item)
+{
+  if (!m_dpaInitDone) {
+    // hold requests until IQRF interface initialization is finished
+    std::unique_lock<std::mutex> lck(m_dpaInitMutex);
+    m_dpaInitConditionVariable.wait(lck, [&] { return m_dpaInitDone.load(); });
+  }
+
+  // requested mode switch is done at this boundary
+  std::unique_lock<std::mutex> modeLck(m_modeMtx, std::defer_lock);
+  lockMode(modeLck);
+
+  DpaTransaction* dpaTransaction = item.m_transaction;
+  if (m_dpaTransactionAbort) {
+    // daemon stops, owners are waiting for finish
+    dpaTransaction->processFinish(DpaTransfer::DpaTransferStatus::kAborted);
+    return;
+  }
+
+  if (Mode::Service != m_mode && !validateDpaTransaction(dpaTransaction)) {
+    // rejected locally according node registry
+  }
+  else {
+    // the request may be released by its owner when finished
+    DpaMessage request = dpaTransaction->getMessage();
+
+    // retry policy is applied before the transaction is finished
+    int retries = item.m_retries < 0 ? m_dpaRetries : item.m_retries;
+    DpaRetryTransaction retryTransaction(*dpaTransaction, retries, m_dpaRetryableErrors);
+    executeDpaTransactionMode(retryTransaction);
+
+    while (retryTransaction.isRetryRequired()) {
+      watchDogPet();
+      if (m_dpaRetryBackoffMillis > 0) {
+        // mode switch is not delayed by backoff, the mode is checked again by the retry
+        modeLck.unlock();
+        std::this_thread::sleep_for(std::chrono::milliseconds(m_dpaRetryBackoffMillis * retryTransaction.getAttempt()));
+        lockMode(modeLck);
+      }
+      executeDpaTransactionMode(retryTransaction);
+    }
+
+    if (nullptr != m_nodeRegistry) {
+      m_nodeRegistry->processResult(request, retryTransaction.getLastError());
+    }
+  }
+
+  modeLck.unlock();
+
+  //Pet WatchDog
+  watchDogPet();
+
+}
+
+//called from task queue thread
+void DaemonController::lockMode(std::unique_lock<std::mutex>& modeLck)
 {
-  bool locked = m_modeMtx.try_lock();
+  {
+    // pending mode switch goes first
+    std::unique_lock<std::mutex> lck(m_modeRequestMutex);
+    m_modeRequestConditionVariable.wait(lck, [&] { return !m_runModeThread || !m_modeRequested; });
+  }
+  modeLck.lock();
+}
 
+//called from task queue thread with mode locked
+void DaemonController::executeDpaTransactionMode(DpaTransaction& dpaTransaction)
+{
   switch (m_mode) {
 
     //TODO lock mutex before change mode
   case Mode::Operational:
   {
-    if (m_dpaHandler) {
+    if (checkIqrfIf()) {
+      DpaRecorderTransaction recordedTransaction(m_dpaRecorder, dpaTransaction);
       try {
-        m_dpaHandler->ExecuteDpaTransaction(*dpaTransaction);
+        m_dpaHandler->ExecuteDpaTransaction(recordedTransaction);
+        m_consecutiveErrors = 0;
       }
       catch (std::exception& e) {
         CATCH_EX("Error in ExecuteDpaTransaction: ", std::exception, e);
-        dpaTransaction->processFinish(DpaTransfer::kError);
+        ++m_consecutiveErrors;
+        recordedTransaction.processFinish(DpaTransfer::kError);
       }
     }
     else {
       TRC_ERR("Dpa interface is not working");
-      dpaTransaction->processFinish(DpaTransfer::kError);
+      dpaTransaction.processFinish(DpaTransfer::kError);
     }
   }
   break;
 
   case Mode::Forwarding:
   {
-    if (m_dpaHandler && m_dpaMessageForwarding) {
-      auto dpaTransactionSniffer = m_dpaMessageForwarding->getDpaTransactionForward(dpaTransaction);
+    IDpaMessageForwarding* dpaMessageForwarding = m_dpaMessageForwarding;
+    if (dpaMessageForwarding && checkIqrfIf()) {
+      DpaRecorderTransaction recordedTransaction(m_dpaRecorder, dpaTransaction);
+      auto dpaTransactionSniffer = dpaMessageForwarding->getDpaTransactionForward(&recordedTransaction);
       try {
         m_dpaHandler->ExecuteDpaTransaction(*dpaTransactionSniffer);
+        m_consecutiveErrors = 0;
       }
       catch (std::exception& e) {
         CATCH_EX("Error in ExecuteDpaTransaction: ", std::exception, e);
-        dpaTransaction->processFinish(DpaTransfer::kError);
+        ++m_consecutiveErrors;
+        // finished through the wrappers as the handler would do
+        dpaTransactionSniffer->processFinish(DpaTransfer::kError);
       }
     }
     else {
       TRC_ERR("Dpa interface is not working");
-      dpaTransaction->processFinish(DpaTransfer::kError);
+      dpaTransaction.processFinish(DpaTransfer::kError);
     }
   }
   break;
@@ -100,19 +197,120 @@ void DaemonController::executeDpaTransactionFunc(DpaTransaction* dpaTransaction)
   case Mode::Service:
   {
     TRC_DBG("Dpa interface is in exclusiveMode");
-    dpaTransaction->processFinish(DpaTransfer::kError);
+    dpaTransaction.processFinish(DpaTransfer::kError);
   }
   break;
 
   default:;
   }
+}
 
-  if (locked)
-    m_modeMtx.unlock();
+//called from task queue thread with mode locked
+bool DaemonController::checkIqrfIf()
+{
+  if (m_recoveryErrorThreshold <= 0 || m_iqrfInterfaceName.empty()) {
+    return nullptr != m_dpaHandler;
+  }
 
-  //Pet WatchDog
-  watchDogPet();
+  if (nullptr != m_dpaHandler && m_consecutiveErrors < m_recoveryErrorThreshold) {
+    // channel state is checked only if something went wrong to not load the interface
+    if (0 == m_consecutiveErrors || IChannel::State::Ready == m_iqrfInterface->getState()) {
+      return true;
+    }
+  }
+
+  // fail fast until next recovery is allowed
+  if (m_recoveryFailed && std::chrono::system_clock::now() - m_recoveryFailureTime <
+    std::chrono::milliseconds(m_recoveryTimeoutMillis)) {
+    return false;
+  }
+
+  return recoverIqrfIf();
+}
+
+//called from task queue thread, pending transactions are held in the queue meanwhile
+bool DaemonController::recoverIqrfIf()
+{
+  TRC_ENTER(PAR(m_consecutiveErrors));
+  TRC_WAR("Recovering IQRF interface: " << PAR(m_iqrfInterfaceName));
+
+  auto startTime = std::chrono::system_clock::now();
+  bool recovered = false;
+
+  stopDpa();
+  delete m_iqrfInterface;
+  m_iqrfInterface = nullptr;
+
+  auto fnd = m_componentMap.find("IqrfInterface");
+  while (fnd != m_componentMap.end()) {
+    watchDogPet();
 
+    try {
+      m_iqrfInterface = createIqrfInterface(fnd->second.m_doc);
+      if (waitIqrfIfReady(m_recoveryPeriodMillis)) {
+        createDpaHandler();
+        recovered = true;
+        break;
+      }
+      delete m_iqrfInterface;
+      m_iqrfInterface = nullptr;
+    }
+    catch (std::exception &e) {
+      CATCH_EX("Recovery of IqrfInterface failure: ", std::exception, e);
+      stopDpa();
+      delete m_iqrfInterface;
+      m_iqrfInterface = nullptr;
+    }
+
+    if (std::chrono::system_clock::now() - startTime > std::chrono::milliseconds(m_recoveryTimeoutMillis))
+      break;
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(m_recoveryPeriodMillis));
+  }
+
+  auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now() - startTime).count();
+  m_consecutiveErrors = 0;
+  m_recoveryFailed = !recovered;
+  if (recovered) {
+    TRC_INF("IQRF interface recovered: " << PAR(duration));
+    // coordinator could be replaced or reset meanwhile
+    if (nullptr != m_nodeRegistry)
+      m_nodeRegistry->refresh();
+  }
+  else {
+    m_recoveryFailureTime = std::chrono::system_clock::now();
+    TRC_ERR("IQRF interface recovery failed => requests fail until next attempt: " << PAR(duration));
+  }
+
+  TRC_LEAVE(PAR(recovered));
+  return recovered;
+}
+
+bool DaemonController::validateDpaTransaction(DpaTransaction* dpaTransaction)
+{
+  if (nullptr == m_nodeRegistry)
+    return true;
+
+  const DpaMessage& request = dpaTransaction->getMessage();
+  int rcode = m_nodeRegistry->validate(request);
+  if (STATUS_NO_ERROR == rcode)
+    return true;
+
+  TRC_WAR("Request rejected by node registry: " << PAR(rcode) << FORM_HEX(request.DpaPacketData(), request.GetLength()));
+
+  // respond locally as the node would do to save RF timeout
+  DpaMessage response;
+  response.DpaPacket().DpaResponsePacket_t.NADR = request.DpaPacket().DpaRequestPacket_t.NADR;
+  response.DpaPacket().DpaResponsePacket_t.PNUM = request.DpaPacket().DpaRequestPacket_t.PNUM;
+  response.DpaPacket().DpaResponsePacket_t.PCMD = request.DpaPacket().DpaRequestPacket_t.PCMD | 0x80;
+  response.DpaPacket().DpaResponsePacket_t.HWPID = request.DpaPacket().DpaRequestPacket_t.HWPID;
+  response.DpaPacket().DpaResponsePacket_t.ResponseCode = (uint8_t)rcode;
+  response.DpaPacket().DpaResponsePacket_t.DpaValue = 0;
+  response.SetLength(sizeof(TDpaIFaceHeader) + 2);
+
+  dpaTransaction->processResponseMessage(response);
+  dpaTransaction->processFinish(DpaTransfer::kProcessed);
+  return false;
 }
 
 void DaemonController::registerAsyncMessageHandler(const std::string& serviceId, AsyncMessageHandlerFunc fun)
@@ -131,6 +329,9 @@ void DaemonController::unregisterAsyncMessageHandler(const std::string& serviceI
 
 void DaemonController::asyncDpaMessageHandler(const DpaMessage& dpaMessage)
 {
+  if (nullptr != m_dpaRecorder)
+    m_dpaRecorder->record(DpaRecorder::RecordType::Async, dpaMessage);
+
   std::lock_guard<std::mutex> lck(m_asyncMessageHandlersMutex);
   for (auto & hndl : m_asyncMessageHandlers)
     hndl.second(dpaMessage);
@@ -146,6 +347,10 @@ DaemonController::DaemonController()
   , m_version(DAEMON_VERSION)
   , m_versionBuild(BUILD_TIMESTAMP)
 {
+  m_iqrfInterfaceConfigured = false;
+  m_dpaInitDone = false;
+  m_dpaTransactionAbort = false;
+  m_modeRequested = false;
 }
 
 void DaemonController::loadConfiguration(const std::string& cfgFileName)
@@ -237,21 +442,70 @@ void DaemonController::watchDogPet()
   m_lastRefreshTime = std::chrono::system_clock::now();
 }
 
+void DaemonController::requestMode(Mode mode)
+{
+  {
+    std::unique_lock<std::mutex> lck(m_modeRequestMutex);
+    m_requestedMode = mode;
+    m_modeRequestTime = std::chrono::steady_clock::now();
+    m_modeRequested = true;
+  }
+  m_modeRequestConditionVariable.notify_all();
+}
+
+//thread function
+void DaemonController::modeThread()
+{
+  std::unique_lock<std::mutex> lck(m_modeRequestMutex);
+
+  while (m_runModeThread) {
+    m_modeRequestConditionVariable.wait(lck, [&] { return !m_runModeThread || m_modeRequested; });
+    if (!m_runModeThread)
+      break;
+
+    Mode mode = m_requestedMode;
+    auto requestTime = m_modeRequestTime;
+
+    lck.unlock();
+    {
+      // requested while IQRF interface is initialized
+      std::unique_lock<std::mutex> initLck(m_dpaInitMutex);
+      m_dpaInitConditionVariable.wait(initLck, [&] { return m_dpaInitDone.load(); });
+    }
+    // waits for the current transaction
+    setMode(mode);
+    long latency = (long)std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - requestTime).count();
+    TRC_INF("Mode switched: " << NAME_PAR(mode, (int)mode) << NAME_PAR(latencyMillis, latency));
+    lck.lock();
+
+    // a different mode may be requested meanwhile
+    if (m_requestedMode == mode) {
+      m_modeRequested = false;
+      // release the queue
+      m_modeRequestConditionVariable.notify_all();
+    }
+  }
+}
+
 void DaemonController::setMode(Mode mode)
 {
   TRC_ENTER(NAME_PAR(mode, (int)mode));
 
   std::lock_guard<std::mutex> lck(m_modeMtx);
+  IDpaExclusiveAccess* dpaExclusiveAccess = m_dpaExclusiveAccess;
 
   switch (mode) {
 
   case Mode::Operational:
   {
-    if (nullptr != m_dpaExclusiveAccess) {
+    if (nullptr != dpaExclusiveAccess) {
       if (m_mode == Mode::Service) {
-        m_dpaExclusiveAccess->resetExclusive();
+        dpaExclusiveAccess->resetExclusive();
         m_mode = mode;
         startDpa();
+        if (m_nodeRegistry)
+          m_nodeRegistry->refresh();
       }
     }
     TRC_INF("Set mode " << MODE_OPERATIONAL);
@@ -261,11 +515,13 @@ void DaemonController::setMode(Mode mode)
 
   case Mode::Forwarding:
   {
-    if (nullptr != m_dpaExclusiveAccess) {
+    if (nullptr != dpaExclusiveAccess) {
       if (m_mode == Mode::Service) {
-        m_dpaExclusiveAccess->resetExclusive();
+        dpaExclusiveAccess->resetExclusive();
         m_mode = mode;
         startDpa();
+        if (m_nodeRegistry)
+          m_nodeRegistry->refresh();
       }
       TRC_INF("Set mode " << MODE_FORWARDING);
       m_mode = mode;
@@ -278,10 +534,13 @@ void DaemonController::setMode(Mode mode)
 
   case Mode::Service:
   {
-    if (nullptr != m_dpaExclusiveAccess) {
+    if (nullptr == m_iqrfInterface) {
+      TRC_WAR("Cannot switch mode: IQRF interface is not available");
+    }
+    else if (nullptr != dpaExclusiveAccess) {
       m_mode = mode;
       stopDpa();
-      m_dpaExclusiveAccess->setExclusive(m_iqrfInterface);
+      dpaExclusiveAccess->setExclusive(m_iqrfInterface);
       TRC_INF("Set mode " << MODE_SERVICE);
       m_mode = mode;
     }
@@ -332,26 +591,67 @@ void DaemonController::startTrace()
   }
 }
 
-void DaemonController::startIqrfIf()
+IChannel* DaemonController::createIqrfInterface(const rapidjson::Value& cfg)
+{
+  const std::string replayPrefix("replay:");
+  if (0 == m_iqrfInterfaceName.compare(0, replayPrefix.size(), replayPrefix)) {
+    int timeScalePercent = jutils::getPossibleMemberAs<int>("ReplayTimeScalePercent", cfg, 100);
+    return ant_new IqrfReplayChannel(m_iqrfInterfaceName.substr(replayPrefix.size()), timeScalePercent);
+  }
+
+  size_t found = m_iqrfInterfaceName.find("spi");
+  if (found != std::string::npos) {
+    spi_iqrf_config_struct spiCfg(IqrfSpiChannel::SPI_IQRF_CFG_DEFAULT);
+
+    memset(spiCfg.spiDev, 0, sizeof(spiCfg.spiDev));
+    auto sz = m_iqrfInterfaceName.size();
+    if (sz > sizeof(spiCfg.spiDev)) sz = sizeof(spiCfg.spiDev);
+    std::copy(m_iqrfInterfaceName.c_str(), m_iqrfInterfaceName.c_str() + sz, spiCfg.spiDev);
+
+    spiCfg.enableGpioPin = jutils::getPossibleMemberAs<int>("enableGpioPin", cfg, spiCfg.enableGpioPin);
+    spiCfg.spiCe0GpioPin = jutils::getPossibleMemberAs<int>("spiCe0GpioPin", cfg, spiCfg.spiCe0GpioPin);
+    spiCfg.spiMisoGpioPin = jutils::getPossibleMemberAs<int>("spiMisoGpioPin", cfg, spiCfg.spiMisoGpioPin);
+    spiCfg.spiMosiGpioPin = jutils::getPossibleMemberAs<int>("spiMosiGpioPin", cfg, spiCfg.spiMosiGpioPin);
+    spiCfg.spiClkGpioPin = jutils::getPossibleMemberAs<int>("spiClkGpioPin", cfg, spiCfg.spiClkGpioPin);
+
+    return ant_new IqrfSpiChannel(spiCfg);
+  }
+  else {
+    return ant_new IqrfCdcChannel(m_iqrfInterfaceName);
+  }
+}
+
+bool DaemonController::waitIqrfIfReady(int timeoutMillis)
 {
-  spi_iqrf_config_struct cfg(IqrfSpiChannel::SPI_IQRF_CFG_DEFAULT);
+  // the channel doesn't signal readiness so it is polled in short steps
+  const int step = 10;
+  int att = timeoutMillis / step;
+  IChannel::State st = m_iqrfInterface->getState();
+
+  while (IChannel::State::Ready != st)
+  {
+    watchDogPet();
+
+    if (--att >= 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(step));
+    }
+    else {
+      TRC_ERR("IQRF interface is not ready ...");
+      return false;
+    }
+
+    st = m_iqrfInterface->getState();
+  }
+  return true;
+}
 
+void DaemonController::startIqrfIf()
+{
   auto fnd = m_componentMap.find("IqrfInterface");
   if (fnd != m_componentMap.end() && fnd->second.m_enabled) {
     try {
       jutils::assertIsObject("", fnd->second.m_doc);
       m_iqrfInterfaceName = jutils::getMemberAs<std::string>("IqrfInterface", fnd->second.m_doc);
-      
-      memset(cfg.spiDev, 0, sizeof(cfg.spiDev));
-      auto sz = m_iqrfInterfaceName.size();
-      if (sz > sizeof(cfg.spiDev)) sz = sizeof(cfg.spiDev);
-      std::copy(m_iqrfInterfaceName.c_str(), m_iqrfInterfaceName.c_str() + sz, cfg.spiDev);
-      
-      cfg.enableGpioPin = jutils::getPossibleMemberAs<int>("enableGpioPin", fnd->second.m_doc, cfg.enableGpioPin);
-      cfg.spiCe0GpioPin = jutils::getPossibleMemberAs<int>("spiCe0GpioPin", fnd->second.m_doc, cfg.spiCe0GpioPin);
-      cfg.spiMisoGpioPin = jutils::getPossibleMemberAs<int>("spiMisoGpioPin", fnd->second.m_doc, cfg.spiMisoGpioPin);
-      cfg.spiMosiGpioPin = jutils::getPossibleMemberAs<int>("spiMosiGpioPin", fnd->second.m_doc, cfg.spiMosiGpioPin);
-      cfg.spiClkGpioPin = jutils::getPossibleMemberAs<int>("spiClkGpioPin", fnd->second.m_doc, cfg.spiClkGpioPin);
 
       m_dpaHandlerTimeout = jutils::getPossibleMemberAs<int>("DpaHandlerTimeout", fnd->second.m_doc, m_dpaHandlerTimeout);
 
@@ -364,25 +664,32 @@ void DaemonController::startIqrfIf()
       else
         m_communicationMode = IqrfRfCommunicationMode::kStd;
 
+      m_recoveryErrorThreshold = jutils::getPossibleMemberAs<int>("RecoveryErrorThreshold", fnd->second.m_doc, m_recoveryErrorThreshold);
+      m_recoveryPeriodMillis = jutils::getPossibleMemberAs<int>("RecoveryPeriodMillis", fnd->second.m_doc, m_recoveryPeriodMillis);
+      m_recoveryTimeoutMillis = jutils::getPossibleMemberAs<int>("RecoveryTimeoutMillis", fnd->second.m_doc, m_recoveryTimeoutMillis);
 
-      TRC_INF(PAR(m_iqrfInterfaceName));
+      m_dpaRetries = jutils::getPossibleMemberAs<int>("DpaRetries", fnd->second.m_doc, m_dpaRetries);
+      m_dpaRetryBackoffMillis = jutils::getPossibleMemberAs<int>("DpaRetryBackoffMillis", fnd->second.m_doc, m_dpaRetryBackoffMillis);
+      if (fnd->second.m_doc.HasMember("DpaRetryableErrors")) {
+        std::vector<int> retryableErrors = jutils::getMemberAsVector<int>("DpaRetryableErrors", fnd->second.m_doc);
+        m_dpaRetryableErrors = std::set<int>(retryableErrors.begin(), retryableErrors.end());
+      }
+
+      TRC_INF(PAR(m_iqrfInterfaceName) << PAR(m_dpaRetries) << PAR(m_dpaRetryBackoffMillis) << PAR(m_recoveryErrorThreshold) << PAR(m_recoveryPeriodMillis) << PAR(m_recoveryTimeoutMillis));
 
       int attempts = 1;
       while (attempts < 3) {
         try {
-          size_t found = m_iqrfInterfaceName.find("spi");
-          
-          if (found != std::string::npos)
-            m_iqrfInterface = ant_new IqrfSpiChannel(cfg);
-          else
-            m_iqrfInterface = ant_new IqrfCdcChannel(m_iqrfInterfaceName);
-
+          m_iqrfInterface = createIqrfInterface(fnd->second.m_doc);
           break;
         }
         catch (std::exception &e) {
           CATCH_EX(PAR(attempts) << " to create IqrfInterface failure: ", std::exception, e);
           ++attempts;
-          std::this_thread::sleep_for(std::chrono::milliseconds(3000));
+          // interrupted by exit
+          std::unique_lock<std::mutex> lck(m_stopConditionMutex);
+          if (m_stopConditionVariable.wait_for(lck, std::chrono::milliseconds(3000), [&] { return !m_running; }))
+            break;
         }
       }
 
@@ -394,67 +701,63 @@ void DaemonController::startIqrfIf()
 
   // wait for iqrfInterface ready
   if (nullptr != m_iqrfInterface) {
-    int att = 10;
-    IChannel::State st = m_iqrfInterface->getState();
-
-    while (IChannel::State::Ready != st)
-    {
-      watchDogPet();
-
-      if (--att >= 0) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-      }
-      else {
-        TRC_ERR("IQRF interface is not ready ...");
-        break;
-      }
+    waitIqrfIfReady(1000);
+  }
+}
 
-      st = m_iqrfInterface->getState();
-    }
+void DaemonController::createDpaHandler()
+{
+  m_dpaHandler = ant_new DpaHandler(m_iqrfInterface);
+  if (m_dpaHandlerTimeout > 0) {
+    m_dpaHandler->Timeout(m_dpaHandlerTimeout);
   }
+  else {
+    // 400ms by default
+    m_dpaHandler->Timeout(DpaHandler::DEFAULT_TIMING);
+  }
+
+  m_dpaHandler->SetRfCommunicationMode(m_communicationMode);
 
-  m_dpaTransactionQueue = ant_new TaskQueue<DpaTransaction*>([&](DpaTransaction* trans) {
-    executeDpaTransactionFunc(trans);
+  //Async msg handling
+  m_dpaHandler->RegisterAsyncMessageHandler([&](const DpaMessage& dpaMessage) {
+    asyncDpaMessageHandler(dpaMessage);
   });
 }
 
 void DaemonController::startDpa()
 {
   try {
-    m_dpaHandler = ant_new DpaHandler(m_iqrfInterface);
-    if (m_dpaHandlerTimeout > 0) {
-      m_dpaHandler->Timeout(m_dpaHandlerTimeout);
+    createDpaHandler();
+
+    //TR module
+    NodeRegistry::CoordinatorInfo coordinatorInfo;
+    if (!m_dpaInitDone && nullptr != m_nodeRegistry && m_nodeRegistry->getCoordinatorInfo(coordinatorInfo)) {
+      // cached at cold start, updated by node registry refresh in background
+      updateCoordinatorInfo(coordinatorInfo);
+      TRC_INF("TR parameters taken from node registry: " << NAME_PAR(moduleId, coordinatorInfo.m_moduleId));
     }
     else {
-      // 400ms by default
-      m_dpaHandler->Timeout(DpaHandler::DEFAULT_TIMING);
-    }
-    
-    m_dpaHandler->SetRfCommunicationMode(m_communicationMode);
+      // the coordinator could be reprogrammed or replaced in service mode
+      PrfOs prfOs;
+      prfOs.read();
 
-    //Async msg handling
-    m_dpaHandler->RegisterAsyncMessageHandler([&](const DpaMessage& dpaMessage) {
-      asyncDpaMessageHandler(dpaMessage);
-    });
+      // the queue is held until initialization or mode switch is finished, so it cannot be used
+      DpaTransactionTask trans(prfOs);
+      m_dpaHandler->ExecuteDpaTransaction(trans);
+      int result = trans.waitFinish();
 
-    //TR module
-    PrfOs prfOs;
-    prfOs.read();
-    
-    DpaTransactionTask trans(prfOs);
-    executeDpaTransaction(trans);
-    int result = trans.waitFinish();
+      if (result != 0) {
+        THROW_EX(std::logic_error, "Cannot get TR parameters");
+      }
 
-    if (result != 0) {
-      THROW_EX(std::logic_error, "Cannot get TR parameters");
+      coordinatorInfo.m_moduleId = prfOs.getModuleId();
+      coordinatorInfo.m_osVersion = prfOs.getOsVersion();
+      coordinatorInfo.m_trType = prfOs.getTrType();
+      coordinatorInfo.m_mcuType = prfOs.getMcuType();
+      coordinatorInfo.m_osBuild = prfOs.getOsBuild();
+      updateCoordinatorInfo(coordinatorInfo);
     }
 
-    m_moduleId = prfOs.getModuleId();
-    m_osVersion = prfOs.getOsVersion();
-    m_trType = prfOs.getTrType();
-    m_mcuType = prfOs.getMcuType();
-    m_osBuild = prfOs.getOsBuild();
-
   }
 
 
@@ -463,6 +766,126 @@ void DaemonController::startDpa()
   }
 }
 
+void DaemonController::updateCoordinatorInfo(const NodeRegistry::CoordinatorInfo& coordinatorInfo)
+{
+  std::lock_guard<std::mutex> lck(m_trMtx);
+  if (m_moduleId == coordinatorInfo.m_moduleId && m_osVersion == coordinatorInfo.m_osVersion &&
+    m_trType == coordinatorInfo.m_trType && m_mcuType == coordinatorInfo.m_mcuType &&
+    m_osBuild == coordinatorInfo.m_osBuild) {
+    return;
+  }
+
+  TRC_INF("TR parameters updated: " << NAME_PAR(moduleId, coordinatorInfo.m_moduleId) <<
+    NAME_PAR(osVersion, coordinatorInfo.m_osVersion) << NAME_PAR(osBuild, coordinatorInfo.m_osBuild));
+  m_moduleId = coordinatorInfo.m_moduleId;
+  m_osVersion = coordinatorInfo.m_osVersion;
+  m_trType = coordinatorInfo.m_trType;
+  m_mcuType = coordinatorInfo.m_mcuType;
+  m_osBuild = coordinatorInfo.m_osBuild;
+}
+
+std::string DaemonController::getModuleId()
+{
+  std::lock_guard<std::mutex> lck(m_trMtx);
+  return m_moduleId;
+}
+
+std::string DaemonController::getOsVersion()
+{
+  std::lock_guard<std::mutex> lck(m_trMtx);
+  return m_osVersion;
+}
+
+std::string DaemonController::getTrType()
+{
+  std::lock_guard<std::mutex> lck(m_trMtx);
+  return m_trType;
+}
+
+std::string DaemonController::getMcuType()
+{
+  std::lock_guard<std::mutex> lck(m_trMtx);
+  return m_mcuType;
+}
+
+std::string DaemonController::getOsBuild()
+{
+  std::lock_guard<std::mutex> lck(m_trMtx);
+  return m_osBuild;
+}
+
+void DaemonController::startNodeRegistry()
+{
+  auto fnd = m_componentMap.find("NodeRegistry");
+  if (fnd != m_componentMap.end() && fnd->second.m_enabled) {
+    try {
+      m_nodeRegistry = ant_new NodeRegistry();
+      m_nodeRegistry->updateConfiguration(fnd->second.m_doc, m_configurationDir);
+      m_nodeRegistry->registerCoordinatorInfoHandler([&](const NodeRegistry::CoordinatorInfo& coordinatorInfo) {
+        updateCoordinatorInfo(coordinatorInfo);
+      });
+      m_nodeRegistry->load();
+    }
+    catch (std::exception &e) {
+      CATCH_EX("Cannot create NodeRegistry: ", std::exception, e);
+      delete m_nodeRegistry;
+      m_nodeRegistry = nullptr;
+    }
+  }
+}
+
+//initialization thread function
+void DaemonController::initIqrf()
+{
+  TRC_ENTER("");
+
+  try {
+    startIqrfIf();
+    if (nullptr != m_iqrfInterface) {
+      startDpa();
+    }
+  }
+  catch (std::exception& e) {
+    CATCH_EX("IQRF interface initialization failure: ", std::exception, e);
+  }
+
+  if (nullptr == m_iqrfInterface) {
+    m_iqrfInterfaceConfigured = false;
+  }
+
+  // release held requests
+  {
+    std::unique_lock<std::mutex> lck(m_dpaInitMutex);
+    m_dpaInitDone = true;
+  }
+  m_dpaInitConditionVariable.notify_all();
+  TRC_INF("IQRF interface initialized: " << PAR(m_iqrfInterfaceName) << NAME_PAR(moduleId, getModuleId()));
+
+  //refresh in background when all is running
+  if (nullptr != m_nodeRegistry) {
+    m_nodeRegistry->start(this);
+  }
+
+  TRC_LEAVE("");
+}
+
+void DaemonController::startDpaRecorder()
+{
+  auto fnd = m_componentMap.find("DpaRecorder");
+  if (fnd != m_componentMap.end() && fnd->second.m_enabled) {
+    try {
+      m_dpaRecorder = ant_new DpaRecorder();
+      m_dpaRecorder->updateConfiguration(fnd->second.m_doc);
+      m_dpaRecorder->start();
+    }
+    catch (std::exception &e) {
+      CATCH_EX("Cannot create DpaRecorder: ", std::exception, e);
+      delete m_dpaRecorder;
+      m_dpaRecorder = nullptr;
+    }
+  }
+}
+
 void DaemonController::startScheduler()
 {
   Scheduler* schd = ant_new Scheduler();
@@ -517,8 +940,8 @@ void DaemonController::loadSerializerComponent(const ComponentDescriptor& compon
     CreateSerializer createSerializer = (CreateSerializer)getCreateFunction(componentDescriptor.m_componentName, true);
     std::unique_ptr<ISerializer> serializer = createSerializer(instanceName);
 
-    //get properties - not implemented
-    //serializer->update(properties);
+    //get properties
+    serializer->update(properties);
 
     //register instance
     auto ret = m_serializers.insert(std::make_pair(serializer->getName(), std::move(serializer)));
@@ -713,11 +1136,28 @@ void DaemonController::start()
   TRC_ENTER("");
 
   startTrace();
-  startIqrfIf();
-  startDpa();
+  startNodeRegistry();
+  startDpaRecorder();
+
+  // requests are accepted and queued immediately, but they are held until IQRF interface is initialized
+  m_dpaTransactionQueue = ant_new TaskQueue<DpaTransactionItem>([&](const DpaTransactionItem& item) {
+    executeDpaTransactionFunc(item);
+  });
+
+  // mode commands are accepted during initialization
+  auto fnd = m_componentMap.find("IqrfInterface");
+  m_iqrfInterfaceConfigured = fnd != m_componentMap.end() && fnd->second.m_enabled;
+
+  m_runModeThread = true;
+  m_modeThread = std::thread(&DaemonController::modeThread, this);
+
+  // IQRF interface and coordinator are initialized concurrently with the other components
+  m_dpaInitThread = std::thread(&DaemonController::initIqrf, this);
+
   startScheduler();
   startServices();
 
+  // configured mode needs the service components, it is held by modeThread until IQRF interface is initialized
   if (MODE_OPERATIONAL != m_modeStr) {
     doCommand(m_modeStr);
   }
@@ -787,19 +1227,60 @@ void DaemonController::stop()
   TRC_DBG("Stopping: " << PAR(m_scheduler));
   m_scheduler->stop();
 
-  TRC_DBG("Stopping: " << PAR(m_dpaTransactionQueue->size()));
-  m_dpaTransactionQueue->stopQueue();
+  if (m_dpaInitThread.joinable()) {
+    TRC_DBG("Joining IQRF initialization thread");
+    m_dpaInitThread.join();
+  }
+
+  // queue must not be held anymore to be stopped
+  {
+    std::unique_lock<std::mutex> lck(m_dpaInitMutex);
+    m_dpaInitDone = true;
+  }
+  m_dpaInitConditionVariable.notify_all();
+
+  //must be stopped before queue as it may wait for transaction
+  if (nullptr != m_nodeRegistry) {
+    TRC_DBG("Stopping: " << PAR(m_nodeRegistry));
+    m_nodeRegistry->stop();
+  }
+
+  //queued transactions are finished as aborted
+  TRC_DBG("Aborting: " << PAR(m_dpaTransactionQueue->size()));
+  m_dpaTransactionAbort = true;
 
   if (nullptr != m_dpaHandler) {
     TRC_DBG("Killing DpaTransaction if any");
     m_dpaHandler->KillDpaTransaction();
   }
 
+  {
+    std::unique_lock<std::mutex> lck(m_modeRequestMutex);
+    m_runModeThread = false;
+  }
+  m_modeRequestConditionVariable.notify_all();
+  if (m_modeThread.joinable()) {
+    TRC_DBG("Joining mode switch thread");
+    m_modeThread.join();
+  }
+
+  //services wait for their submitted transactions so the queue has to run
   stopServices();
+
+  TRC_DBG("Stopping: " << PAR(m_dpaTransactionQueue->size()));
+  m_dpaTransactionQueue->stopQueue();
   TRC_DBG("daemon: before stopDpa");
   stopDpa();
   stopIqrfIf();
 
+  TRC_DBG("Try to destroy: " << PAR(m_dpaRecorder));
+  delete m_dpaRecorder;
+  m_dpaRecorder = nullptr;
+
+  TRC_DBG("Try to destroy: " << PAR(m_nodeRegistry));
+  delete m_nodeRegistry;
+  m_nodeRegistry = nullptr;
+
   TRC_DBG("Try to destroy: " << PAR(m_scheduler));
   delete m_scheduler;
   TRC_DBG("daemon: after delete m_scheduler");
@@ -821,24 +1302,31 @@ void DaemonController::exit()
 
 std::string DaemonController::doCommand(const std::string& cmd)
 {
+  //answered immediately, not queued behind DPA transactions
+  auto start = std::chrono::steady_clock::now();
+
   std::string res = "ERROR_UNKNOWN";
-  if (m_iqrfInterface != nullptr) {
+  if (m_iqrfInterfaceConfigured) {
     if (cmd == MODE_OPERATIONAL) {
-      setMode(Mode::Operational);
+      requestMode(Mode::Operational);
       res = "OK";
     }
     if (cmd == MODE_SERVICE) {
-      setMode(Mode::Service);
+      requestMode(Mode::Service);
       res = "OK";
     }
     if (cmd == MODE_FORWARDING) {
-      setMode(Mode::Forwarding);
+      requestMode(Mode::Forwarding);
       res = "OK";
     }
   }
   else {
     res = "ERROR_IFACE";
   }
+
+  long latency = (long)std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now() - start).count();
+  TRC_INF("Command done: " << PAR(cmd) << PAR(res) << NAME_PAR(latencyMicros, latency));
   return res;
 }
 
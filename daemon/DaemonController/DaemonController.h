@@ -22,14 +22,21 @@
 #include "IService.h"
 #include "TaskQueue.h"
 #include "IDaemon.h"
+#include "NodeRegistry.h"
 #include "JsonUtils.h"
 #include "IqrfLogging.h"
 #include <map>
+#include <set>
 #include <string>
 #include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 #include <vector>
+#include <chrono>
 
 class IChannel;
+class DpaRecorder;
 class IDpaMessageForwarding;
 class IDpaExclusiveAccess;
 
@@ -117,15 +124,17 @@ public:
 
   // IDaemon override methods
   void executeDpaTransaction(DpaTransaction& dpaTransaction) override;
+  void executeDpaTransaction(DpaTransaction& dpaTransaction, int retries) override;
+  void executeDpaTransactions(const std::vector<std::pair<DpaTransaction*, int>>& dpaTransactions) override;
   void registerAsyncMessageHandler(const std::string& serviceId, AsyncMessageHandlerFunc fun) override;
   void unregisterAsyncMessageHandler(const std::string& serviceId) override;
   IScheduler* getScheduler() override { return m_scheduler; }
   std::string doCommand(const std::string& cmd) override;
-  const std::string& getModuleId() override { return m_moduleId; }
-  const std::string& getOsVersion() override { return m_osVersion; }
-  const std::string& getTrType() override { return m_trType; }
-  const std::string& getMcuType() override { return m_mcuType; }
-  const std::string& getOsBuild() override { return m_osBuild; }
+  std::string getModuleId() override;
+  std::string getOsVersion() override;
+  std::string getTrType() override;
+  std::string getMcuType() override;
+  std::string getOsBuild() override;
   const std::string& getDaemonVersion() override { return m_version; }
   const std::string& getDaemonVersionBuild() override { return m_versionBuild; }
 
@@ -141,10 +150,27 @@ public:
   /// Forwarding normal work but all DPA messages are forwarded to IQRF IDE to me monitored there
   void setMode(Mode mode);
 
+  /// \brief request switch of operational mode
+  /// \param [in] mode operational mode to switch
+  /// \details
+  /// Returns immediately, the mode is switched by dedicated thread at the next transaction boundary.
+  /// The queue does not start next transaction until the switch is done.
+  void requestMode(Mode mode);
+
 private:
   std::mutex m_modeMtx;
   Mode m_mode;
 
+  /// mode switch requests
+  void modeThread();
+  std::thread m_modeThread;
+  std::mutex m_modeRequestMutex;
+  std::condition_variable m_modeRequestConditionVariable;
+  std::atomic_bool m_modeRequested;
+  Mode m_requestedMode;
+  std::chrono::steady_clock::time_point m_modeRequestTime;
+  bool m_runModeThread = false;
+
   std::map<std::string, AsyncMessageHandlerFunc> m_asyncMessageHandlers;
   std::mutex m_asyncMessageHandlersMutex;
   void asyncDpaMessageHandler(const DpaMessage& dpaMessage);
@@ -153,10 +179,17 @@ private:
   virtual ~DaemonController();
 
   void startTrace();
+  void initIqrf();
   void startIqrfIf();
+  IChannel* createIqrfInterface(const rapidjson::Value& cfg);
+  bool waitIqrfIfReady(int timeoutMillis);
   void startDpa();
+  void updateCoordinatorInfo(const NodeRegistry::CoordinatorInfo& coordinatorInfo);
+  void createDpaHandler();
   void startServices();
   void startScheduler();
+  void startNodeRegistry();
+  void startDpaRecorder();
 
   void stopIqrfIf();
   void stopDpa();
@@ -171,19 +204,50 @@ private:
 
   IChannel* m_iqrfInterface;
   DpaHandler* m_dpaHandler;
+  /// IQRF interface is configured and not failed at initialization, read by messaging threads
+  std::atomic_bool m_iqrfInterfaceConfigured;
   
-  void executeDpaTransactionFunc(DpaTransaction* dpaTransaction);
+  /// queued transaction with its processing parameters
+  struct DpaTransactionItem {
+    DpaTransaction* m_transaction = nullptr;
+    int m_retries = -1;
+  };
+
+  void executeDpaTransactionFunc(const DpaTransactionItem& item);
+  void executeDpaTransactionMode(DpaTransaction& dpaTransaction);
+  /// waits for pending mode switch and locks the mode
+  void lockMode(std::unique_lock<std::mutex>& modeLck);
+  bool validateDpaTransaction(DpaTransaction* dpaTransaction);
+
+  /// IQRF interface initialization, the queue is held until done
+  std::thread m_dpaInitThread;
+  std::atomic_bool m_dpaInitDone;
+  std::mutex m_dpaInitMutex;
+  std::condition_variable m_dpaInitConditionVariable;
+
+  /// set when daemon stops, queued transactions are aborted
+  std::atomic_bool m_dpaTransactionAbort;
+
+  /// IQRF interface recovery
+  bool checkIqrfIf();
+  bool recoverIqrfIf();
+  int m_consecutiveErrors = 0;
+  bool m_recoveryFailed = false;
+  std::chrono::system_clock::time_point m_recoveryFailureTime;
 
-  TaskQueue<DpaTransaction*> *m_dpaTransactionQueue;
+  TaskQueue<DpaTransactionItem> *m_dpaTransactionQueue;
 
   std::map<std::string, std::unique_ptr<ISerializer>> m_serializers;
   std::map<std::string, std::unique_ptr<IService>> m_services;
   std::map<std::string, std::unique_ptr<IMessaging>> m_messagings;
 
-  IDpaMessageForwarding* m_dpaMessageForwarding = nullptr;
-  IDpaExclusiveAccess* m_dpaExclusiveAccess = nullptr;
+  //set by startServices() concurrently with IQRF initialization and DPA transactions
+  std::atomic<IDpaMessageForwarding*> m_dpaMessageForwarding{ nullptr };
+  std::atomic<IDpaExclusiveAccess*> m_dpaExclusiveAccess{ nullptr };
 
   IScheduler* m_scheduler = nullptr;
+  NodeRegistry* m_nodeRegistry = nullptr;
+  DpaRecorder* m_dpaRecorder = nullptr;
 
   /// watchDog
   void watchDogPet();
@@ -204,6 +268,12 @@ private:
   std::string m_iqrfInterfaceName;
   int m_dpaHandlerTimeout = 400;
   IqrfRfCommunicationMode m_communicationMode = IqrfRfCommunicationMode::kStd;
+  int m_dpaRetries = 0;
+  int m_dpaRetryBackoffMillis = 100;
+  std::set<int> m_dpaRetryableErrors = { -1, -2 };
+  int m_recoveryErrorThreshold = 3;
+  int m_recoveryPeriodMillis = 100;
+  int m_recoveryTimeoutMillis = 5000;
 
   std::string m_configurationDir;
   std::string m_modeStr;
@@ -214,7 +284,8 @@ private:
   void loadMessagingComponent(const ComponentDescriptor& componentDescriptor);
   void loadServiceComponent(const ComponentDescriptor& componentDescriptor);
 
-  /// TR module
+  /// TR module, updated by node registry refresh
+  std::mutex m_trMtx;
   std::string m_moduleId;
   std::string m_osVersion;
   std::string m_trType;
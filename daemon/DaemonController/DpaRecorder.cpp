@@ -0,0 +1,215 @@
+/**
+ * Copyright 2016-2017 MICRORISC s.r.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "DpaRecorder.h"
+#include "IqrfLogging.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+  const char RECORDER_MAGIC[4] = { 'I', 'Q', 'D', 'R' };
+  const uint8_t RECORDER_VERSION = 1;
+  const int HEADER_SIZE = sizeof(RECORDER_MAGIC) + 1;
+  const int RECORD_HEADER_SIZE = 1 + 8 + 2;
+}
+
+DpaRecorder::DpaRecorder()
+{
+}
+
+DpaRecorder::~DpaRecorder()
+{
+  stop();
+}
+
+void DpaRecorder::updateConfiguration(const rapidjson::Value& cfg)
+{
+  TRC_ENTER("");
+  jutils::assertIsObject("", cfg);
+
+  m_fileName = jutils::getPossibleMemberAs<std::string>("RecordFile", cfg, m_fileName);
+  m_maxFileSize = jutils::getPossibleMemberAs<int>("MaxFileSize", cfg, m_maxFileSize);
+  m_maxFiles = jutils::getPossibleMemberAs<int>("MaxFiles", cfg, m_maxFiles);
+
+  TRC_INF(PAR(m_fileName) << PAR(m_maxFileSize) << PAR(m_maxFiles));
+  TRC_LEAVE("");
+}
+
+void DpaRecorder::start()
+{
+  TRC_ENTER("");
+  std::lock_guard<std::mutex> lck(m_mtx);
+  open(false);
+  TRC_LEAVE("");
+}
+
+void DpaRecorder::stop()
+{
+  TRC_ENTER("");
+  std::lock_guard<std::mutex> lck(m_mtx);
+  if (m_file.is_open()) {
+    m_file.close();
+  }
+  TRC_LEAVE("");
+}
+
+void DpaRecorder::open(bool truncate)
+{
+  // capture is append-only, a new file is started only after rotation
+  m_file.open(m_fileName, std::ios::binary | std::ios::out | (truncate ? std::ios::trunc : std::ios::app));
+  if (!m_file.is_open()) {
+    THROW_EX(std::logic_error, "Cannot open: " << PAR(m_fileName));
+  }
+
+  m_file.seekp(0, std::ios::end);
+  m_fileSize = m_file.tellp();
+  if (m_fileSize <= 0) {
+    m_file.write(RECORDER_MAGIC, sizeof(RECORDER_MAGIC));
+    m_file.put((char)RECORDER_VERSION);
+    m_fileSize = HEADER_SIZE;
+  }
+}
+
+void DpaRecorder::rotate()
+{
+  m_file.close();
+
+  for (int i = m_maxFiles - 1; i > 0; i--) {
+    std::string to = m_fileName + '.' + std::to_string(i);
+    std::string from = i > 1 ? m_fileName + '.' + std::to_string(i - 1) : m_fileName;
+    std::remove(to.c_str());
+    std::rename(from.c_str(), to.c_str());
+  }
+
+  open(true);
+}
+
+void DpaRecorder::record(RecordType type, const DpaMessage& dpaMessage)
+{
+  int len = dpaMessage.GetLength();
+  record(type, dpaMessage.DpaPacketData(), len > 0 ? len : 0);
+}
+
+void DpaRecorder::record(RecordType type, const uint8_t* data, size_t len)
+{
+  int64_t ts = std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count();
+
+  uint8_t hdr[RECORD_HEADER_SIZE];
+  hdr[0] = (uint8_t)type;
+  for (int i = 0; i < 8; i++)
+    hdr[1 + i] = (uint8_t)(ts >> (8 * i));
+  hdr[9] = (uint8_t)(len & 0xFF);
+  hdr[10] = (uint8_t)(len >> 8);
+
+  std::lock_guard<std::mutex> lck(m_mtx);
+  if (!m_file.is_open())
+    return;
+
+  try {
+    if (m_maxFileSize > 0 && m_fileSize >= m_maxFileSize) {
+      rotate();
+    }
+    m_file.write((const char*)hdr, sizeof(hdr));
+    m_file.write((const char*)data, len);
+    m_fileSize += sizeof(hdr) + len;
+
+    // transaction or async message is complete
+    if (type == RecordType::Finish || type == RecordType::Async)
+      m_file.flush();
+  }
+  catch (std::exception &e) {
+    CATCH_EX("Cannot record DPA message: ", std::exception, e);
+  }
+}
+
+void DpaRecorder::readRecords(const std::string& fileName, std::vector<Record>& records)
+{
+  std::ifstream ifs(fileName, std::ios::binary);
+  if (!ifs.is_open()) {
+    THROW_EX(std::logic_error, "Cannot open: " << PAR(fileName));
+  }
+
+  char magic[sizeof(RECORDER_MAGIC)];
+  ifs.read(magic, sizeof(magic));
+  uint8_t version = (uint8_t)ifs.get();
+  if (!ifs || 0 != memcmp(magic, RECORDER_MAGIC, sizeof(magic)) || version != RECORDER_VERSION) {
+    THROW_EX(std::logic_error, "Unexpected format: " << PAR(fileName));
+  }
+
+  uint8_t hdr[RECORD_HEADER_SIZE];
+  while (ifs.read((char*)hdr, sizeof(hdr))) {
+    Record record;
+    record.m_type = (RecordType)hdr[0];
+    record.m_timestamp = 0;
+    for (int i = 0; i < 8; i++)
+      record.m_timestamp |= (int64_t)hdr[1 + i] << (8 * i);
+    size_t len = hdr[9] | (hdr[10] << 8);
+    record.m_data.resize(len);
+    if (len > 0 && !ifs.read((char*)&record.m_data[0], len)) {
+      TRC_WAR("Truncated record at the end: " << PAR(fileName));
+      break;
+    }
+    records.push_back(std::move(record));
+  }
+}
+
+//////////////////////////////////////
+DpaRecorderTransaction::DpaRecorderTransaction(DpaRecorder* recorder, DpaTransaction& forwarded)
+  :m_recorder(recorder)
+  ,m_forwarded(forwarded)
+{
+  if (m_recorder)
+    m_recorder->record(DpaRecorder::RecordType::Request, m_forwarded.getMessage());
+}
+
+DpaRecorderTransaction::~DpaRecorderTransaction()
+{
+}
+
+const DpaMessage& DpaRecorderTransaction::getMessage() const
+{
+  return m_forwarded.getMessage();
+}
+
+int DpaRecorderTransaction::getTimeout() const
+{
+  return m_forwarded.getTimeout();
+}
+
+void DpaRecorderTransaction::processConfirmationMessage(const DpaMessage& confirmation)
+{
+  if (m_recorder)
+    m_recorder->record(DpaRecorder::RecordType::Confirmation, confirmation);
+  m_forwarded.processConfirmationMessage(confirmation);
+}
+
+void DpaRecorderTransaction::processResponseMessage(const DpaMessage& response)
+{
+  if (m_recorder)
+    m_recorder->record(DpaRecorder::RecordType::Response, response);
+  m_forwarded.processResponseMessage(response);
+}
+
+void DpaRecorderTransaction::processFinish(DpaTransfer::DpaTransferStatus status)
+{
+  if (m_recorder) {
+    uint8_t st = (uint8_t)status;
+    m_recorder->record(DpaRecorder::RecordType::Finish, &st, 1);
+  }
+  m_forwarded.processFinish(status);
+}
@@ -0,0 +1,126 @@
+/**
+ * Copyright 2016-2017 MICRORISC s.r.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "DpaTransaction.h"
+#include "JsonUtils.h"
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+typedef std::basic_string<unsigned char> ustring;
+
+/// \class DpaRecorder
+/// \brief Records DPA traffic for offline analysis
+/// \details
+/// Captures every DPA request, confirmation, response, transaction finish status and asynchronous message
+/// passing DpaHandler boundary with microsecond timestamp. Records are appended to a compact binary file
+/// rotated when it reaches configured size. The capture can be played back by IqrfReplayChannel.
+///
+/// File starts with header "IQDR" and version byte followed by records:
+/// type (1B), timestamp in microseconds since epoch (8B LE), data length (2B LE), data
+///
+/// It accepts configuration JSON file:
+/// ```json
+/// {
+///   "RecordFile": "/var/log/iqrf-daemon-dpa.rec",  #capture file
+///   "MaxFileSize": 10485760,                        #file is rotated when reaches the size
+///   "MaxFiles": 3                                   #number of kept files including the current one
+/// }
+/// ```
+class DpaRecorder
+{
+public:
+  /// \brief type of recorded frame
+  enum class RecordType : uint8_t {
+    Request = 0,
+    Confirmation = 1,
+    Response = 2,
+    Async = 3,
+    Finish = 4
+  };
+
+  /// \brief record as read from capture file
+  struct Record {
+    RecordType m_type;
+    int64_t m_timestamp;
+    ustring m_data;
+  };
+
+  DpaRecorder();
+  virtual ~DpaRecorder();
+
+  /// \brief update configuration
+  /// \param [in] cfg configuration
+  void updateConfiguration(const rapidjson::Value& cfg);
+
+  /// \brief open capture file
+  void start();
+
+  /// \brief close capture file
+  void stop();
+
+  /// \brief record DPA message
+  /// \param [in] type record type
+  /// \param [in] dpaMessage message to be recorded
+  void record(RecordType type, const DpaMessage& dpaMessage);
+
+  /// \brief record binary data
+  /// \param [in] type record type
+  /// \param [in] data data to be recorded
+  /// \param [in] len length of data
+  void record(RecordType type, const uint8_t* data, size_t len);
+
+  /// \brief read capture file
+  /// \param [in] fileName capture file
+  /// \param [out] records read records
+  /// \throws std::logic_error if the file cannot be read
+  static void readRecords(const std::string& fileName, std::vector<Record>& records);
+
+private:
+  void open(bool truncate);
+  void rotate();
+
+  std::string m_fileName = "iqrf-daemon-dpa.rec";
+  int m_maxFileSize = 10 * 1024 * 1024;
+  int m_maxFiles = 3;
+
+  std::mutex m_mtx;
+  std::ofstream m_file;
+  int64_t m_fileSize = 0;
+};
+
+/// \class DpaRecorderTransaction
+/// \brief Transaction wrapper passing processed messages to DpaRecorder
+/// \details
+/// The request is recorded in constructor. Nothing is recorded if the recorder is nullptr.
+class DpaRecorderTransaction : public DpaTransaction
+{
+public:
+  DpaRecorderTransaction(DpaRecorder* recorder, DpaTransaction& forwarded);
+  virtual ~DpaRecorderTransaction();
+  const DpaMessage& getMessage() const override;
+  int getTimeout() const override;
+  void processConfirmationMessage(const DpaMessage& confirmation) override;
+  void processResponseMessage(const DpaMessage& response) override;
+  void processFinish(DpaTransfer::DpaTransferStatus status) override;
+private:
+  DpaRecorder* m_recorder;
+  DpaTransaction& m_forwarded;
+};
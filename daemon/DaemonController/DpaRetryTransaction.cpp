@@ -0,0 +1,82 @@
+/**
+ * Copyright 2016-2017 MICRORISC s.r.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "DpaRetryTransaction.h"
+#include "IqrfLogging.h"
+
+DpaRetryTransaction::DpaRetryTransaction(DpaTransaction& forwarded, int retries, const std::set<int>& retryableErrors)
+  :m_forwarded(forwarded)
+  ,m_retries(retries)
+  ,m_retryableErrors(retryableErrors)
+{
+}
+
+DpaRetryTransaction::~DpaRetryTransaction()
+{
+}
+
+const DpaMessage& DpaRetryTransaction::getMessage() const
+{
+  return m_forwarded.getMessage();
+}
+
+int DpaRetryTransaction::getTimeout() const
+{
+  return m_forwarded.getTimeout();
+}
+
+void DpaRetryTransaction::processConfirmationMessage(const DpaMessage& confirmation)
+{
+  m_forwarded.processConfirmationMessage(confirmation);
+}
+
+void DpaRetryTransaction::processResponseMessage(const DpaMessage& response)
+{
+  // held until it is clear the transaction is not repeated
+  m_response = response;
+  m_hasResponse = true;
+}
+
+void DpaRetryTransaction::processFinish(DpaTransfer::DpaTransferStatus status)
+{
+  switch (status) {
+  case DpaTransfer::kProcessed:
+    m_lastError = m_hasResponse ? m_response.DpaPacket().DpaResponsePacket_t.ResponseCode : 0;
+    break;
+  case DpaTransfer::kTimeout:
+    m_lastError = ERROR_TIMEOUT;
+    break;
+  case DpaTransfer::kError:
+    m_lastError = ERROR_TRANSFER;
+    break;
+  default:
+    // aborted or unexpected state is never repeated
+    m_lastError = 0;
+  }
+
+  m_retryRequired = m_lastError != 0 && m_attempt < m_retries && m_retryableErrors.count(m_lastError) > 0;
+  if (m_retryRequired) {
+    TRC_WAR("DPA transaction failed => retry: " << PAR(m_lastError) << PAR(m_attempt) << PAR(m_retries));
+    ++m_attempt;
+    m_hasResponse = false;
+    return;
+  }
+
+  if (m_hasResponse) {
+    m_forwarded.processResponseMessage(m_response);
+  }
+  m_forwarded.processFinish(status);
+}
@@ -0,0 +1,73 @@
+/**
+ * Copyright 2016-2017 MICRORISC s.r.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "DpaTransaction.h"
+#include <set>
+
+/// \class DpaRetryTransaction
+/// \brief Transaction wrapper implementing retry policy
+/// \details
+/// Forwards processing to wrapped transaction. The response is held until the transaction is finished.
+/// If it is finished with a retryable error and there are retries left, the wrapped transaction is not finished
+/// and isRetryRequired() returns true to signal the executor to repeat it.
+///
+/// Errors are identified as:
+/// - -1 timeout
+/// - -2 transfer error
+/// - positive DPA response code
+class DpaRetryTransaction : public DpaTransaction
+{
+public:
+  static const int ERROR_TIMEOUT = -1;
+  static const int ERROR_TRANSFER = -2;
+
+  /// \brief parametric constructor
+  /// \param [in] forwarded wrapped transaction
+  /// \param [in] retries maximal number of retries
+  /// \param [in] retryableErrors errors to be retried
+  DpaRetryTransaction(DpaTransaction& forwarded, int retries, const std::set<int>& retryableErrors);
+  virtual ~DpaRetryTransaction();
+
+  const DpaMessage& getMessage() const override;
+  int getTimeout() const override;
+  void processConfirmationMessage(const DpaMessage& confirmation) override;
+  void processResponseMessage(const DpaMessage& response) override;
+  void processFinish(DpaTransfer::DpaTransferStatus status) override;
+
+  /// \brief check if the transaction has to be repeated
+  /// \return true if repeat is required
+  bool isRetryRequired() const { return m_retryRequired; }
+
+  /// \brief get number of already performed retries
+  /// \return number of retries
+  int getAttempt() const { return m_attempt; }
+
+  /// \brief get error of the last attempt
+  /// \return error
+  int getLastError() const { return m_lastError; }
+
+private:
+  DpaTransaction& m_forwarded;
+  int m_retries;
+  const std::set<int>& m_retryableErrors;
+  int m_attempt = 0;
+  int m_lastError = 0;
+  bool m_retryRequired = false;
+  bool m_hasResponse = false;
+  DpaMessage m_response;
+};
@@ -0,0 +1,145 @@
+/**
+ * Copyright 2016-2017 MICRORISC s.r.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "IqrfReplayChannel.h"
+#include "IqrfLogging.h"
+
+typedef DpaRecorder::RecordType RecordType;
+
+IqrfReplayChannel::IqrfReplayChannel(const std::string& fileName, int timeScalePercent)
+  :m_timeScalePercent(timeScalePercent)
+{
+  TRC_ENTER(PAR(fileName) << PAR(timeScalePercent));
+
+  DpaRecorder::readRecords(fileName, m_records);
+  TRC_INF("Capture loaded: " << PAR(fileName) << NAME_PAR(records, m_records.size()));
+
+  // asynchronous messages keep their capture timeline
+  if (!m_records.empty()) {
+    TimePoint now = std::chrono::steady_clock::now();
+    int64_t first = m_records.front().m_timestamp;
+    for (const auto& rec : m_records) {
+      if (rec.m_type == RecordType::Async)
+        m_scheduled.insert(std::make_pair(now + scaled(rec.m_timestamp - first), rec.m_data));
+    }
+  }
+
+  m_thread = std::thread(&IqrfReplayChannel::playThread, this);
+  TRC_LEAVE("");
+}
+
+IqrfReplayChannel::~IqrfReplayChannel()
+{
+  {
+    std::unique_lock<std::mutex> lck(m_mtx);
+    m_runThread = false;
+  }
+  m_conditionVariable.notify_all();
+  if (m_thread.joinable())
+    m_thread.join();
+}
+
+std::chrono::microseconds IqrfReplayChannel::scaled(int64_t recordedMicros) const
+{
+  return std::chrono::microseconds(recordedMicros * m_timeScalePercent / 100);
+}
+
+void IqrfReplayChannel::sendTo(const std::basic_string<unsigned char>& message)
+{
+  TimePoint now = std::chrono::steady_clock::now();
+  std::unique_lock<std::mutex> lck(m_mtx);
+
+  // the next matching request, the search wraps to replay the capture repeatedly
+  size_t sz = m_records.size();
+  size_t found = sz;
+  for (size_t i = 0; i < sz; i++) {
+    size_t idx = (m_position + i) % sz;
+    const auto& rec = m_records[idx];
+    if (rec.m_type == RecordType::Request && rec.m_data == message) {
+      found = idx;
+      break;
+    }
+  }
+
+  if (found == sz) {
+    TRC_WAR("Request not found in capture => no response: " << FORM_HEX(message.data(), message.size()));
+    return;
+  }
+
+  int64_t requestTs = m_records[found].m_timestamp;
+  for (size_t idx = found + 1; idx < sz; idx++) {
+    const auto& rec = m_records[idx];
+    if (rec.m_type == RecordType::Request || rec.m_type == RecordType::Finish)
+      break;
+    if (rec.m_type == RecordType::Confirmation || rec.m_type == RecordType::Response)
+      m_scheduled.insert(std::make_pair(now + scaled(rec.m_timestamp - requestTs), rec.m_data));
+  }
+  m_position = found + 1;
+
+  m_conditionVariable.notify_all();
+}
+
+void IqrfReplayChannel::registerReceiveFromHandler(ReceiveFromFunc receiveFromFunc)
+{
+  std::unique_lock<std::mutex> lck(m_mtx);
+  m_receiveFromFunc = receiveFromFunc;
+}
+
+void IqrfReplayChannel::unregisterReceiveFromHandler()
+{
+  std::unique_lock<std::mutex> lck(m_mtx);
+  m_receiveFromFunc = ReceiveFromFunc();
+}
+
+IChannel::State IqrfReplayChannel::getState()
+{
+  return State::Ready;
+}
+
+//thread function
+void IqrfReplayChannel::playThread()
+{
+  std::unique_lock<std::mutex> lck(m_mtx);
+
+  while (m_runThread) {
+    if (m_scheduled.empty()) {
+      m_conditionVariable.wait(lck);
+      continue;
+    }
+
+    auto first = m_scheduled.begin();
+    if (std::chrono::steady_clock::now() < first->first) {
+      m_conditionVariable.wait_until(lck, first->first);
+      continue;
+    }
+
+    ustring message = first->second;
+    ReceiveFromFunc receiveFromFunc = m_receiveFromFunc;
+    m_scheduled.erase(first);
+
+    // handler may send next request
+    lck.unlock();
+    if (receiveFromFunc) {
+      try {
+        receiveFromFunc(message);
+      }
+      catch (std::exception &e) {
+        CATCH_EX("Receive handler failure: ", std::exception, e);
+      }
+    }
+    lck.lock();
+  }
+}
@@ -0,0 +1,73 @@
+/**
+ * Copyright 2016-2017 MICRORISC s.r.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "IChannel.h"
+#include "DpaRecorder.h"
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+/// \class IqrfReplayChannel
+/// \brief IQRF interface playing back DPA traffic captured by DpaRecorder
+/// \details
+/// Emulates coordinator according the capture. When a request is sent the next matching recorded request is found
+/// and its recorded confirmation and response are received with original delays multiplied by time scale.
+/// Asynchronous messages are received on the capture timeline since the channel is created.
+/// Requests not found in the capture are not answered and finish by timeout.
+///
+/// It is selected by IqrfInterface configuration:
+/// ```json
+/// {
+///   "IqrfInterface": "replay:/var/log/iqrf-daemon-dpa.rec",  #capture file to be played back
+///   "ReplayTimeScalePercent": 100                             #100 original timing, 50 twice faster
+/// }
+/// ```
+class IqrfReplayChannel : public IChannel
+{
+public:
+  /// \brief parametric constructor
+  /// \param [in] fileName capture file
+  /// \param [in] timeScalePercent recorded delays scale, 100 means original timing, 0 means no delays
+  IqrfReplayChannel(const std::string& fileName, int timeScalePercent);
+  virtual ~IqrfReplayChannel();
+
+  void sendTo(const std::basic_string<unsigned char>& message) override;
+  void registerReceiveFromHandler(ReceiveFromFunc receiveFromFunc) override;
+  void unregisterReceiveFromHandler() override;
+  State getState() override;
+
+private:
+  typedef std::chrono::steady_clock::time_point TimePoint;
+
+  void schedule(TimePoint timePoint, const ustring& message);
+  std::chrono::microseconds scaled(int64_t recordedMicros) const;
+  void playThread();
+
+  std::vector<DpaRecorder::Record> m_records;
+  size_t m_position = 0;
+  int m_timeScalePercent = 100;
+
+  std::mutex m_mtx;
+  std::condition_variable m_conditionVariable;
+  ReceiveFromFunc m_receiveFromFunc;
+  std::multimap<TimePoint, ustring> m_scheduled;
+  bool m_runThread = true;
+  std::thread m_thread;
+};
@@ -0,0 +1,585 @@
+/**
+ * Copyright 2016-2017 MICRORISC s.r.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "NodeRegistry.h"
+#include "DpaRaw.h"
+#include "PrfOs.h"
+#include "DpaTransactionTask.h"
+#include "IqrfLogging.h"
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+  const char REGISTRY_MAGIC[4] = { 'I', 'Q', 'N', 'R' };
+  const uint8_t REGISTRY_VERSION = 1;
+  const uint16_t MAX_NODE_ADDRESS = 0xEF;
+  const uint8_t NODE_DISCOVERED = 0x01;
+  const uint8_t NODE_ENUMERATED = 0x02;
+  // DpaVersion(2) UserPerNr(1) EmbeddedPers(4) HWPID(2) HWPIDver(2) Flags(1)
+  const int ENUM_EMBEDDED_PERS_OFFSET = 3;
+  const int ENUM_HWPID_OFFSET = 7;
+  const int ENUM_HWPID_VER_OFFSET = 9;
+  const int ENUM_USER_PERS_OFFSET = 12;
+
+  /// Raw request issued by registry refresh
+  class RegistryRequest : public DpaRaw
+  {
+  public:
+    RegistryRequest(uint16_t nadr, uint8_t pnum, uint8_t pcmd)
+      :DpaRaw()
+    {
+      m_request.DpaPacket().DpaRequestPacket_t.NADR = nadr;
+      m_request.DpaPacket().DpaRequestPacket_t.PNUM = pnum;
+      m_request.DpaPacket().DpaRequestPacket_t.PCMD = pcmd;
+      m_request.DpaPacket().DpaRequestPacket_t.HWPID = HWPID_DoNotCheck;
+      m_request.SetLength(sizeof(TDpaIFaceHeader));
+    }
+
+    const uint8_t* getResponseData() const {
+      return getResponse().DpaPacket().DpaResponsePacket_t.DpaMessage.Response.PData;
+    }
+
+    int getResponseDataLen() const {
+      return getResponse().GetLength() - (int)sizeof(TDpaIFaceHeader) - 2;
+    }
+  };
+
+  void writeU16(std::ostream& os, uint16_t val) {
+    os.put((char)(val & 0xFF));
+    os.put((char)(val >> 8));
+  }
+
+  uint16_t readU16(std::istream& is) {
+    uint16_t lo = (uint8_t)is.get();
+    uint16_t hi = (uint8_t)is.get();
+    return lo | (hi << 8);
+  }
+
+  void writeStr(std::ostream& os, const std::string& str) {
+    uint8_t len = str.size() > 0xFF ? 0xFF : (uint8_t)str.size();
+    os.put((char)len);
+    os.write(str.data(), len);
+  }
+
+  std::string readStr(std::istream& is) {
+    uint8_t len = (uint8_t)is.get();
+    std::string str(len, '\0');
+    is.read(&str[0], len);
+    return str;
+  }
+}
+
+NodeRegistry::NodeRegistry()
+{
+  m_runThread = false;
+}
+
+NodeRegistry::~NodeRegistry()
+{
+  stop();
+}
+
+void NodeRegistry::updateConfiguration(const rapidjson::Value& cfg, const std::string& configurationDir)
+{
+  TRC_ENTER("");
+  jutils::assertIsObject("", cfg);
+
+  m_fileName = jutils::getPossibleMemberAs<std::string>("RegistryFile", cfg, m_fileName);
+  m_validate = jutils::getPossibleMemberAs<bool>("ValidateRequests", cfg, m_validate);
+  m_refreshPeriodMinutes = jutils::getPossibleMemberAs<int>("RefreshPeriodMinutes", cfg, m_refreshPeriodMinutes);
+
+  if (!m_fileName.empty() && m_fileName[0] != '/' && m_fileName.find(':') == std::string::npos) {
+    m_fileName = configurationDir + '/' + m_fileName;
+  }
+
+  TRC_INF(PAR(m_fileName) << PAR(m_validate) << PAR(m_refreshPeriodMinutes));
+  TRC_LEAVE("");
+}
+
+bool NodeRegistry::load()
+{
+  TRC_ENTER(PAR(m_fileName));
+
+  std::ifstream ifs(m_fileName, std::ios::binary);
+  if (!ifs.is_open()) {
+    TRC_INF("Node registry not persisted yet: " << PAR(m_fileName));
+    TRC_LEAVE("");
+    return false;
+  }
+
+  char magic[sizeof(REGISTRY_MAGIC)];
+  ifs.read(magic, sizeof(magic));
+  uint8_t version = (uint8_t)ifs.get();
+  if (!ifs || 0 != memcmp(magic, REGISTRY_MAGIC, sizeof(magic)) || version != REGISTRY_VERSION) {
+    TRC_WAR("Node registry has unexpected format => ignored: " << PAR(m_fileName) << PAR((int)version));
+    TRC_LEAVE("");
+    return false;
+  }
+
+  CoordinatorInfo coordinatorInfo;
+  coordinatorInfo.m_moduleId = readStr(ifs);
+  coordinatorInfo.m_osVersion = readStr(ifs);
+  coordinatorInfo.m_trType = readStr(ifs);
+  coordinatorInfo.m_mcuType = readStr(ifs);
+  coordinatorInfo.m_osBuild = readStr(ifs);
+
+  std::map<uint16_t, NodeInfo> nodes;
+  uint16_t count = readU16(ifs);
+  for (uint16_t i = 0; i < count && ifs; i++) {
+    uint16_t nadr = readU16(ifs);
+    uint8_t flags = (uint8_t)ifs.get();
+    NodeInfo& nodeInfo = nodes[nadr];
+    nodeInfo.m_discovered = (flags & NODE_DISCOVERED) != 0;
+    nodeInfo.m_enumerated = (flags & NODE_ENUMERATED) != 0;
+    nodeInfo.m_dpaVersion = readU16(ifs);
+    nodeInfo.m_hwpid = readU16(ifs);
+    nodeInfo.m_hwpidVer = readU16(ifs);
+    for (size_t b = 0; b < nodeInfo.m_peripherals.size(); b += 8) {
+      uint8_t byte = (uint8_t)ifs.get();
+      for (int bit = 0; bit < 8; bit++)
+        nodeInfo.m_peripherals[b + bit] = (byte & (1 << bit)) != 0;
+    }
+  }
+
+  if (!ifs) {
+    TRC_WAR("Node registry is truncated => ignored: " << PAR(m_fileName));
+    TRC_LEAVE("");
+    return false;
+  }
+
+  {
+    std::lock_guard<std::mutex> lck(m_dataMtx);
+    m_coordinatorInfo = coordinatorInfo;
+    m_nodes.swap(nodes);
+    m_valid = true;
+  }
+
+  TRC_INF("Node registry loaded: " << NAME_PAR(nodes, count));
+  TRC_LEAVE("");
+  return true;
+}
+
+void NodeRegistry::save()
+{
+  TRC_ENTER(PAR(m_fileName));
+
+  std::string tmpName = m_fileName + ".tmp";
+  {
+    std::ofstream ofs(tmpName, std::ios::binary | std::ios::trunc);
+    if (!ofs.is_open()) {
+      TRC_WAR("Cannot write node registry: " << PAR(tmpName));
+      TRC_LEAVE("");
+      return;
+    }
+
+    std::lock_guard<std::mutex> lck(m_dataMtx);
+
+    ofs.write(REGISTRY_MAGIC, sizeof(REGISTRY_MAGIC));
+    ofs.put((char)REGISTRY_VERSION);
+    writeStr(ofs, m_coordinatorInfo.m_moduleId);
+    writeStr(ofs, m_coordinatorInfo.m_osVersion);
+    writeStr(ofs, m_coordinatorInfo.m_trType);
+    writeStr(ofs, m_coordinatorInfo.m_mcuType);
+    writeStr(ofs, m_coordinatorInfo.m_osBuild);
+
+    writeU16(ofs, (uint16_t)m_nodes.size());
+    for (const auto& node : m_nodes) {
+      const NodeInfo& nodeInfo = node.second;
+      writeU16(ofs, node.first);
+      uint8_t flags = (nodeInfo.m_discovered ? NODE_DISCOVERED : 0) | (nodeInfo.m_enumerated ? NODE_ENUMERATED : 0);
+      ofs.put((char)flags);
+      writeU16(ofs, nodeInfo.m_dpaVersion);
+      writeU16(ofs, nodeInfo.m_hwpid);
+      writeU16(ofs, nodeInfo.m_hwpidVer);
+      for (size_t b = 0; b < nodeInfo.m_peripherals.size(); b += 8) {
+        uint8_t byte = 0;
+        for (int bit = 0; bit < 8; bit++)
+          byte |= nodeInfo.m_peripherals[b + bit] ? (1 << bit) : 0;
+        ofs.put((char)byte);
+      }
+    }
+
+    if (!ofs) {
+      TRC_WAR("Cannot write node registry: " << PAR(tmpName));
+      TRC_LEAVE("");
+      return;
+    }
+  }
+
+  // rename replaces atomically on Linux, Windows requires the target to be removed first
+  int res = std::rename(tmpName.c_str(), m_fileName.c_str());
+  if (0 != res) {
+    std::remove(m_fileName.c_str());
+    res = std::rename(tmpName.c_str(), m_fileName.c_str());
+  }
+  if (0 != res) {
+    TRC_WAR("Cannot rename node registry: " << PAR(tmpName) << PAR(m_fileName));
+  }
+
+  TRC_LEAVE("");
+}
+
+void NodeRegistry::registerCoordinatorInfoHandler(CoordinatorInfoFunc fun)
+{
+  m_coordinatorInfoFunc = fun;
+}
+
+void NodeRegistry::start(IDaemon* daemon)
+{
+  TRC_ENTER("");
+  m_daemon = daemon;
+  m_refreshRequired = true;
+  m_runThread = true;
+  if (!m_thread.joinable())
+    m_thread = std::thread(&NodeRegistry::refreshThread, this);
+  TRC_LEAVE("");
+}
+
+void NodeRegistry::stop()
+{
+  TRC_ENTER("");
+  {
+    std::unique_lock<std::mutex> lck(m_conditionVariableMutex);
+    m_runThread = false;
+    m_conditionVariable.notify_all();
+  }
+  if (m_thread.joinable()) {
+    TRC_DBG("Joining node registry thread");
+    m_thread.join();
+    TRC_DBG("node registry thread joined");
+  }
+  TRC_LEAVE("");
+}
+
+void NodeRegistry::refresh()
+{
+  std::unique_lock<std::mutex> lck(m_conditionVariableMutex);
+  m_refreshRequired = true;
+  m_conditionVariable.notify_all();
+}
+
+bool NodeRegistry::getCoordinatorInfo(CoordinatorInfo& coordinatorInfo) const
+{
+  std::lock_guard<std::mutex> lck(m_dataMtx);
+  if (!m_valid || m_coordinatorInfo.m_moduleId.empty())
+    return false;
+  coordinatorInfo = m_coordinatorInfo;
+  return true;
+}
+
+int NodeRegistry::validate(const DpaMessage& request) const
+{
+  if (!m_validate || request.GetLength() < (int)sizeof(TDpaIFaceHeader))
+    return STATUS_NO_ERROR;
+
+  const auto& packet = request.DpaPacket().DpaRequestPacket_t;
+  uint16_t nadr = packet.NADR;
+
+  // coordinator, temporary, local and broadcast addresses are not registered
+  if (nadr == COORDINATOR_ADDRESS || nadr > MAX_NODE_ADDRESS)
+    return STATUS_NO_ERROR;
+
+  std::lock_guard<std::mutex> lck(m_dataMtx);
+  if (!m_valid)
+    return STATUS_NO_ERROR;
+
+  auto found = m_nodes.find(nadr);
+  if (found == m_nodes.end()) {
+    // could be bonded meanwhile, it is known after refresh
+    return m_bondingChanges == m_bondingChangesRefreshed ? ERROR_NADR : STATUS_NO_ERROR;
+  }
+
+  // metadata could be stale, the node decides until it confirms them
+  const NodeInfo& nodeInfo = found->second;
+  if (!nodeInfo.m_enumerated || !nodeInfo.m_confirmed)
+    return STATUS_NO_ERROR;
+
+  return checkNode(nodeInfo, packet.PNUM, packet.HWPID);
+}
+
+int NodeRegistry::checkNode(const NodeInfo& nodeInfo, uint8_t pnum, uint16_t hwpid)
+{
+  if (pnum < nodeInfo.m_peripherals.size() && !nodeInfo.m_peripherals[pnum])
+    return ERROR_PNUM;
+
+  if (hwpid != HWPID_DoNotCheck && hwpid != nodeInfo.m_hwpid)
+    return ERROR_HWPID;
+
+  return STATUS_NO_ERROR;
+}
+
+void NodeRegistry::processResult(const DpaMessage& request, int result)
+{
+  // transfer errors don't say anything about the node
+  if (result < 0 || request.GetLength() < (int)sizeof(TDpaIFaceHeader))
+    return;
+
+  const auto& packet = request.DpaPacket().DpaRequestPacket_t;
+  if (packet.NADR != COORDINATOR_ADDRESS && packet.NADR <= MAX_NODE_ADDRESS) {
+    bool stale = false;
+    {
+      std::lock_guard<std::mutex> lck(m_dataMtx);
+      auto found = m_nodes.find(packet.NADR);
+      if (found == m_nodes.end() || !found->second.m_enumerated)
+        return;
+
+      NodeInfo& nodeInfo = found->second;
+      int expected = checkNode(nodeInfo, packet.PNUM, packet.HWPID);
+      if (result == expected) {
+        if (STATUS_NO_ERROR != expected)
+          nodeInfo.m_confirmed = true;
+      }
+      else if (STATUS_NO_ERROR != expected || ERROR_PNUM == result || ERROR_HWPID == result) {
+        nodeInfo.m_confirmed = false;
+        m_staleNodes.insert(packet.NADR);
+        stale = true;
+      }
+    }
+    if (stale) {
+      TRC_WAR("Node responds differently than registered => enumeration: " << NAME_PAR(nadr, packet.NADR) <<
+        PAR(result));
+      refresh();
+    }
+    return;
+  }
+
+  if (STATUS_NO_ERROR != result || (packet.NADR != COORDINATOR_ADDRESS && packet.NADR != LOCAL_ADDRESS) || packet.PNUM != PNUM_COORDINATOR)
+    return;
+
+  switch (packet.PCMD) {
+  case CMD_COORDINATOR_CLEAR_ALL_BONDS:
+  case CMD_COORDINATOR_BOND_NODE:
+  case CMD_COORDINATOR_REMOVE_BOND:
+  case CMD_COORDINATOR_REBOND_NODE:
+  case CMD_COORDINATOR_DISCOVERY:
+  case CMD_COORDINATOR_RESTORE:
+  case CMD_COORDINATOR_AUTHORIZE_BOND:
+  {
+    {
+      std::lock_guard<std::mutex> lck(m_dataMtx);
+      ++m_bondingChanges;
+    }
+    TRC_INF("Coordinator bonding changed => refresh: " << NAME_PAR(pcmd, (int)packet.PCMD));
+    refresh();
+  }
+  break;
+
+  default:;
+  }
+}
+
+//thread function
+void NodeRegistry::refreshThread()
+{
+  TRC_ENTER("");
+
+  while (m_runThread) {
+    {
+      std::unique_lock<std::mutex> lck(m_conditionVariableMutex);
+      auto pred = [&] { return !m_runThread || m_refreshRequired; };
+      if (m_refreshPeriodMinutes > 0)
+        m_conditionVariable.wait_for(lck, std::chrono::minutes(m_refreshPeriodMinutes), pred);
+      else
+        m_conditionVariable.wait(lck, pred);
+      m_refreshRequired = false;
+    }
+
+    if (!m_runThread)
+      break;
+
+    try {
+      if (doRefresh())
+        save();
+    }
+    catch (std::exception& e) {
+      CATCH_EX("Node registry refresh failure: ", std::exception, e);
+    }
+  }
+
+  TRC_LEAVE("");
+}
+
+bool NodeRegistry::doRefresh()
+{
+  TRC_ENTER("");
+
+  CoordinatorInfo coordinatorInfo;
+  std::bitset<256> bonded;
+  std::bitset<256> discovered;
+
+  unsigned bondingChanges = 0;
+  {
+    std::lock_guard<std::mutex> lck(m_dataMtx);
+    bondingChanges = m_bondingChanges;
+  }
+
+  if (!readCoordinatorInfo(coordinatorInfo) ||
+    !readBitmap(CMD_COORDINATOR_BONDED_DEVICES, bonded) ||
+    !readBitmap(CMD_COORDINATOR_DISCOVERED_DEVICES, discovered)) {
+    TRC_WAR("Cannot read coordinator => refresh postponed");
+    TRC_LEAVE("");
+    return false;
+  }
+
+  if (m_coordinatorInfoFunc)
+    m_coordinatorInfoFunc(coordinatorInfo);
+
+  std::map<uint16_t, NodeInfo> nodes;
+  std::set<uint16_t> staleNodes;
+  bool changed = false;
+  {
+    std::lock_guard<std::mutex> lck(m_dataMtx);
+    staleNodes.swap(m_staleNodes);
+    if (!m_valid || m_coordinatorInfo.m_moduleId != coordinatorInfo.m_moduleId) {
+      TRC_WAR("Coordinator changed => node registry reset: " << NAME_PAR(old, m_coordinatorInfo.m_moduleId) <<
+        NAME_PAR(new, coordinatorInfo.m_moduleId));
+      changed = true;
+    }
+    else {
+      nodes = m_nodes;
+      changed = m_coordinatorInfo.m_osVersion != coordinatorInfo.m_osVersion ||
+        m_coordinatorInfo.m_osBuild != coordinatorInfo.m_osBuild;
+    }
+  }
+
+  // confirmation expires, the node could be reprogrammed since
+  for (auto& node : nodes) {
+    node.second.m_confirmed = false;
+    if (staleNodes.count(node.first) > 0)
+      node.second.m_enumerated = false;
+  }
+
+  for (auto it = nodes.begin(); it != nodes.end(); ) {
+    if (!bonded[it->first]) {
+      TRC_INF("Node unbonded: " << NAME_PAR(nadr, it->first));
+      it = nodes.erase(it);
+      changed = true;
+    }
+    else {
+      ++it;
+    }
+  }
+
+  // publish bonding state first, enumeration of new nodes may take long
+  auto publish = [&]() {
+    std::lock_guard<std::mutex> lck(m_dataMtx);
+    m_coordinatorInfo = coordinatorInfo;
+    m_nodes = nodes;
+    m_bondingChangesRefreshed = bondingChanges;
+    m_valid = true;
+  };
+
+  for (uint16_t nadr = 1; nadr <= MAX_NODE_ADDRESS; nadr++) {
+    if (!bonded[nadr])
+      continue;
+    NodeInfo& nodeInfo = nodes[nadr];
+    if (nodeInfo.m_discovered != discovered[nadr]) {
+      nodeInfo.m_discovered = discovered[nadr];
+      changed = true;
+    }
+  }
+  publish();
+
+  for (auto& node : nodes) {
+    if (!m_runThread)
+      break;
+    if (node.second.m_enumerated)
+      continue;
+    if (enumerateNode(node.first, node.second))
+      changed = true;
+    else
+      TRC_WAR("Cannot enumerate node => next refresh: " << NAME_PAR(nadr, node.first));
+  }
+  publish();
+
+  TRC_INF("Node registry refreshed: " << NAME_PAR(nodes, nodes.size()) << PAR(changed));
+  TRC_LEAVE("");
+  return changed;
+}
+
+bool NodeRegistry::readBitmap(uint8_t pcmd, std::bitset<256>& bitmap)
+{
+  RegistryRequest request(COORDINATOR_ADDRESS, PNUM_COORDINATOR, pcmd);
+  DpaTransactionTask trans(request);
+  m_daemon->executeDpaTransaction(trans);
+  if (0 != trans.waitFinish()) {
+    TRC_WAR("Cannot read coordinator bitmap: " << PAR((int)pcmd) << trans.getErrorStr());
+    return false;
+  }
+
+  const uint8_t* data = request.getResponseData();
+  int len = request.getResponseDataLen();
+  for (int i = 0; i < len && i < 32; i++) {
+    for (int bit = 0; bit < 8; bit++)
+      bitmap[i * 8 + bit] = (data[i] & (1 << bit)) != 0;
+  }
+  return true;
+}
+
+bool NodeRegistry::enumerateNode(uint16_t nadr, NodeInfo& nodeInfo)
+{
+  RegistryRequest request(nadr, PNUM_ENUMERATION, CMD_GET_PER_INFO);
+  DpaTransactionTask trans(request);
+  m_daemon->executeDpaTransaction(trans);
+  if (0 != trans.waitFinish())
+    return false;
+
+  const uint8_t* data = request.getResponseData();
+  int len = request.getResponseDataLen();
+  if (len < ENUM_USER_PERS_OFFSET)
+    return false;
+
+  nodeInfo.m_dpaVersion = data[0] | (data[1] << 8);
+  nodeInfo.m_hwpid = data[ENUM_HWPID_OFFSET] | (data[ENUM_HWPID_OFFSET + 1] << 8);
+  nodeInfo.m_hwpidVer = data[ENUM_HWPID_VER_OFFSET] | (data[ENUM_HWPID_VER_OFFSET + 1] << 8);
+
+  nodeInfo.m_peripherals.reset();
+  for (int i = 0; i < 4; i++) {
+    for (int bit = 0; bit < 8; bit++)
+      nodeInfo.m_peripherals[i * 8 + bit] = (data[ENUM_EMBEDDED_PERS_OFFSET + i] & (1 << bit)) != 0;
+  }
+  for (int i = ENUM_USER_PERS_OFFSET; i < len; i++) {
+    for (int bit = 0; bit < 8; bit++) {
+      size_t pnum = PNUM_USER + (i - ENUM_USER_PERS_OFFSET) * 8 + bit;
+      if (pnum < nodeInfo.m_peripherals.size())
+        nodeInfo.m_peripherals[pnum] = (data[i] & (1 << bit)) != 0;
+    }
+  }
+
+  nodeInfo.m_enumerated = true;
+  TRC_INF("Node enumerated: " << PAR(nadr) << NAME_PAR_HEX(hwpid, nodeInfo.m_hwpid) <<
+    NAME_PAR_HEX(dpaVersion, nodeInfo.m_dpaVersion));
+  return true;
+}
+
+bool NodeRegistry::readCoordinatorInfo(CoordinatorInfo& coordinatorInfo)
+{
+  PrfOs prfOs;
+  prfOs.read();
+
+  DpaTransactionTask trans(prfOs);
+  m_daemon->executeDpaTransaction(trans);
+  if (0 != trans.waitFinish())
+    return false;
+
+  coordinatorInfo.m_moduleId = prfOs.getModuleId();
+  coordinatorInfo.m_osVersion = prfOs.getOsVersion();
+  coordinatorInfo.m_trType = prfOs.getTrType();
+  coordinatorInfo.m_mcuType = prfOs.getMcuType();
+  coordinatorInfo.m_osBuild = prfOs.getOsBuild();
+  return true;
+}
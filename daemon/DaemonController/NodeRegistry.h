@@ -0,0 +1,165 @@
+/**
+ * Copyright 2016-2017 MICRORISC s.r.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "IDaemon.h"
+#include "JsonUtils.h"
+#include <bitset>
+#include <map>
+#include <set>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <functional>
+
+/// \class NodeRegistry
+/// \brief Persistent registry of IQRF network nodes
+/// \details
+/// Keeps metadata of nodes bonded to the coordinator (HWPID, DPA version, supported peripherals)
+/// together with the coordinator TR parameters. The registry is loaded from a compact binary file at startup,
+/// so the metadata are available immediately, and it is refreshed incrementally in its own thread via regular
+/// DPA transactions: coordinator bonded/discovered bitmaps are read and only new nodes are enumerated.
+///
+/// The registry is used to reject requests to unbonded nodes or with unsupported PNUM/HWPID locally
+/// instead of waiting for RF timeout. Successful coordinator commands changing the bonding invoke refresh
+/// and requests to unknown nodes are passed until the refresh is done.
+/// As a node may be reprogrammed meanwhile, unsupported PNUM/HWPID is rejected locally only when the node itself
+/// rejected a request since the last refresh. If the node responds differently than its metadata predict,
+/// it is enumerated again.
+///
+/// It accepts configuration JSON file:
+/// ```json
+/// {
+///   "RegistryFile": "NodeRegistry.dat",     #registry file, relative path is taken from ConfigurationDir
+///   "ValidateRequests": true,               #reject invalid requests locally
+///   "RefreshPeriodMinutes": 60              #period of refresh from coordinator, 0 means at start only
+/// }
+/// ```
+class NodeRegistry
+{
+public:
+  /// \brief Node metadata
+  struct NodeInfo {
+    bool m_discovered = false;
+    bool m_enumerated = false;
+    uint16_t m_dpaVersion = 0;
+    uint16_t m_hwpid = 0;
+    uint16_t m_hwpidVer = 0;
+    /// supported peripherals indexed by PNUM
+    std::bitset<128> m_peripherals;
+    /// metadata confirmed by rejection from the node since the last refresh, not persisted
+    bool m_confirmed = false;
+  };
+
+  /// \brief Coordinator TR parameters as read by PrfOs
+  struct CoordinatorInfo {
+    std::string m_moduleId;
+    std::string m_osVersion;
+    std::string m_trType;
+    std::string m_mcuType;
+    std::string m_osBuild;
+  };
+
+  /// coordinator parameters read by refresh
+  typedef std::function<void(const CoordinatorInfo&)> CoordinatorInfoFunc;
+
+  NodeRegistry();
+  virtual ~NodeRegistry();
+
+  /// \brief update configuration
+  /// \param [in] cfg configuration
+  /// \param [in] configurationDir directory where relative registry file path is resolved
+  void updateConfiguration(const rapidjson::Value& cfg, const std::string& configurationDir);
+
+  /// \brief load persisted registry
+  /// \return true if loaded successfully
+  bool load();
+
+  /// \brief register handler of coordinator parameters
+  /// \param [in] fun handler invoked by each refresh with the parameters read from coordinator
+  /// \details
+  /// It has to be registered before start()
+  void registerCoordinatorInfoHandler(CoordinatorInfoFunc fun);
+
+  /// \brief start refresh thread
+  /// \param [in] daemon used to execute DPA transactions
+  void start(IDaemon* daemon);
+
+  /// \brief stop refresh thread
+  /// \details
+  /// Must be called while transaction queue is still running
+  void stop();
+
+  /// \brief invoke refresh from coordinator
+  void refresh();
+
+  /// \brief get cached coordinator parameters
+  /// \param [out] coordinatorInfo cached parameters
+  /// \return true if the parameters are available
+  bool getCoordinatorInfo(CoordinatorInfo& coordinatorInfo) const;
+
+  /// \brief validate request against registry
+  /// \param [in] request DPA request
+  /// \return DPA response code to be returned locally or STATUS_NO_ERROR if the request shall be sent
+  /// \details
+  /// Requests are passed if validation is disabled, the registry is not known yet or the node metadata are not confirmed.
+  /// Coordinator, local and broadcast addresses are always passed.
+  int validate(const DpaMessage& request) const;
+
+  /// \brief process result of request sent to IQRF network
+  /// \param [in] request DPA request
+  /// \param [in] result DPA response code or negative transfer error
+  /// \details
+  /// Refresh is invoked if the request changed bonding of the coordinator or if the node responded
+  /// differently than its metadata predict.
+  void processResult(const DpaMessage& request, int result);
+
+private:
+  static int checkNode(const NodeInfo& nodeInfo, uint8_t pnum, uint16_t hwpid);
+  void refreshThread();
+  bool doRefresh();
+  bool readBitmap(uint8_t pcmd, std::bitset<256>& bitmap);
+  bool enumerateNode(uint16_t nadr, NodeInfo& nodeInfo);
+  bool readCoordinatorInfo(CoordinatorInfo& coordinatorInfo);
+  void save();
+
+  IDaemon* m_daemon = nullptr;
+  CoordinatorInfoFunc m_coordinatorInfoFunc;
+
+  std::string m_fileName = "NodeRegistry.dat";
+  bool m_validate = true;
+  int m_refreshPeriodMinutes = 60;
+
+  mutable std::mutex m_dataMtx;
+  bool m_valid = false;
+  CoordinatorInfo m_coordinatorInfo;
+  std::map<uint16_t, NodeInfo> m_nodes;
+  /// bonding changes and those already read by refresh
+  unsigned m_bondingChanges = 0;
+  unsigned m_bondingChangesRefreshed = 0;
+  /// nodes to be enumerated again by next refresh
+  std::set<uint16_t> m_staleNodes;
+
+  std::thread m_thread;
+  std::atomic_bool m_runThread;
+  bool m_refreshRequired = false;
+  std::mutex m_conditionVariableMutex;
+  std::condition_variable m_conditionVariable;
+};
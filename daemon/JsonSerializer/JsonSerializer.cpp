@@ -25,9 +25,15 @@
 #include "rapidjson/stringbuffer.h"
 #include "rapidjson/prettywriter.h"
 #include "JsonUtils.h"
+#include "HexCodec.h"
+#include "TimestampFormatter.h"
+#include "RequestSchemas.h"
 #include <vector>
 #include <utility>
 #include <stdexcept>
+#include <mutex>
+#include <cstdio>
+#include <cstring>
 
  //TODO using istream is slower according http://rapidjson.org/md_doc_stream.html
 
@@ -40,6 +46,7 @@ INIT_COMPONENT(ISerializer, JsonSerializer)
 #define NADR_STR "nadr"
 #define HWPID_STR "hwpid"
 #define TIMEOUT_STR "timeout"
+#define RETRIES_STR "retries"
 #define MSGID_STR "msgid"
 #define REQUEST_STR "request"
 #define REQUEST_TS_STR "request_ts"
@@ -52,20 +59,320 @@ INIT_COMPONENT(ISerializer, JsonSerializer)
 #define RESD_STR "rdata"
 #define DPAVAL_STR "dpaval"
 #define STATUS_STR "status"
+#define FIELDS_STR "fields"
+
+namespace {
+  /// size of memory pool for values of parsed request, bigger requests use heap
+  const size_t PARSE_POOL_SIZE = 4096;
+
+  /// \class PooledDocument
+  /// \brief Document of incoming request
+  /// \details
+  /// Values of the document are allocated from the memory pool reused by the calling thread.
+  /// Just one instance may exist per thread at the same time.
+  class PooledDocument
+  {
+  public:
+    PooledDocument()
+      :m_allocator(s_pool, sizeof(s_pool))
+      , m_doc(&m_allocator)
+    {
+    }
+
+    Document& get() { return m_doc; }
+
+  private:
+    MemoryPoolAllocator<> m_allocator;
+    Document m_doc;
+
+    static thread_local char s_pool[PARSE_POOL_SIZE];
+  };
+
+  thread_local char PooledDocument::s_pool[PARSE_POOL_SIZE];
+
+  /// \class SpanInsituStream
+  /// \brief In situ stream over buffer without terminating zero
+  /// \details
+  /// The same as rapidjson::InsituStringStream just the end is given by the buffer size,
+  /// so a received message is parsed in place without appending of the terminating zero.
+  class SpanInsituStream
+  {
+  public:
+    typedef char Ch;
+
+    SpanInsituStream(Ch* buffer, size_t size)
+      :m_src(buffer)
+      , m_dst(nullptr)
+      , m_head(buffer)
+      , m_end(buffer + size)
+    {
+    }
+
+    Ch Peek() const { return m_src != m_end ? *m_src : '\0'; }
+    Ch Take() { return m_src != m_end ? *m_src++ : '\0'; }
+    size_t Tell() const { return static_cast<size_t>(m_src - m_head); }
+
+    //in situ writes never overtake reading
+    Ch* PutBegin() { return m_dst = m_src; }
+    void Put(Ch c) { *m_dst++ = c; }
+    void Flush() {}
+    size_t PutEnd(Ch* begin) { return static_cast<size_t>(m_dst - begin); }
+
+  private:
+    Ch* m_src;
+    Ch* m_dst;
+    Ch* m_head;
+    Ch* m_end;
+  };
+
+  /// \brief Find the first character of JSON text
+  /// \param [in] request incoming message
+  /// \return offset of the first character but whitespace or message size if there is none
+  size_t firstNonSpace(const MessageSpan& request)
+  {
+    size_t i = 0;
+    while (i < request.size() && (request[i] == ' ' || request[i] == '\t' || request[i] == '\r' || request[i] == '\n')) {
+      i++;
+    }
+    return i;
+  }
+
+  /// \class MsgidHandler
+  /// \brief Handler passing events of validating reader to document
+  /// \details
+  /// Keeps msgid of the request on the way, so a rejected request is answered with its msgid
+  /// even if the document is not completed.
+  class MsgidHandler
+  {
+  public:
+    MsgidHandler(Document& doc, std::string& msgid)
+      :m_doc(doc)
+      , m_msgid(msgid)
+    {
+    }
+
+    bool Null() { return value() && m_doc.Null(); }
+    bool Bool(bool b) { return value() && m_doc.Bool(b); }
+    bool Int(int i) { return value() && m_doc.Int(i); }
+    bool Uint(unsigned i) { return value() && m_doc.Uint(i); }
+    bool Int64(int64_t i) { return value() && m_doc.Int64(i); }
+    bool Uint64(uint64_t i) { return value() && m_doc.Uint64(i); }
+    bool Double(double d) { return value() && m_doc.Double(d); }
+    bool RawNumber(const char* str, SizeType length, bool copy) { return value() && m_doc.RawNumber(str, length, copy); }
+
+    bool String(const char* str, SizeType length, bool copy)
+    {
+      if (m_isMsgid) {
+        m_msgid.assign(str, length);
+      }
+      return value() && m_doc.String(str, length, copy);
+    }
+
+    bool Key(const char* str, SizeType length, bool copy)
+    {
+      m_isMsgid = m_depth == 1 && length == sizeof(MSGID_STR) - 1 && memcmp(str, MSGID_STR, length) == 0;
+      return m_doc.Key(str, length, copy);
+    }
+
+    bool StartObject() { value(); m_depth++; return m_doc.StartObject(); }
+    bool EndObject(SizeType count) { m_depth--; return m_doc.EndObject(count); }
+    bool StartArray() { value(); m_depth++; return m_doc.StartArray(); }
+    bool EndArray(SizeType count) { m_depth--; return m_doc.EndArray(count); }
+
+  private:
+    bool value() { m_isMsgid = false; return true; }
+
+    Document& m_doc;
+    std::string& m_msgid;
+    int m_depth = 0;
+    bool m_isMsgid = false;
+  };
+
+  /// \brief Get msgid of parsed request
+  /// \param [in] val parsed request
+  /// \param [out] info msgid is set if the request has it
+  void getMsgid(const rapidjson::Value& val, RequestError& info)
+  {
+    if (val.IsObject()) {
+      auto found = val.FindMember(MSGID_STR);
+      if (found != val.MemberEnd() && found->value.IsString()) {
+        info.m_msgid.assign(found->value.GetString(), found->value.GetStringLength());
+      }
+    }
+  }
+
+  /// size of pooled block holding one request object including its arena chunk
+  const size_t REQUEST_BLOCK_SIZE = 4096;
+  /// maximal number of idle blocks kept for reuse
+  const size_t REQUEST_BLOCK_CACHE = 64;
+
+  /// \class RequestBlockPool
+  /// \brief Free list of request blocks
+  /// \details
+  /// Request objects are created by a messaging thread and released by another one so the list is shared.
+  /// Idle blocks over the cache limit are returned to heap.
+  class RequestBlockPool
+  {
+  public:
+    static RequestBlockPool& get()
+    {
+      static RequestBlockPool pool;
+      return pool;
+    }
+
+    void* acquire()
+    {
+      {
+        std::lock_guard<std::mutex> lck(m_mtx);
+        if (!m_free.empty()) {
+          void* block = m_free.back();
+          m_free.pop_back();
+          return block;
+        }
+      }
+      return ::operator new(REQUEST_BLOCK_SIZE);
+    }
+
+    void release(void* block)
+    {
+      {
+        std::lock_guard<std::mutex> lck(m_mtx);
+        if (m_free.size() < REQUEST_BLOCK_CACHE) {
+          m_free.push_back(block);
+          return;
+        }
+      }
+      ::operator delete(block);
+    }
+
+    ~RequestBlockPool()
+    {
+      for (void* block : m_free)
+        ::operator delete(block);
+    }
+
+  private:
+    RequestBlockPool()
+    {
+      m_free.reserve(REQUEST_BLOCK_CACHE);
+    }
+
+    std::mutex m_mtx;
+    std::vector<void*> m_free;
+  };
+
+  /// \brief Write JSON to output stream
+  /// \param [in] val JSON to be written
+  /// \param [in] pretty pretty output if true else compact
+  /// \param [out] output rapidjson output stream
+  template<typename Output>
+  void writeJson(const rapidjson::Value& val, bool pretty, Output& output)
+  {
+    if (pretty) {
+      PrettyWriter<Output> writer(output);
+      val.Accept(writer);
+    }
+    else {
+      Writer<Output> writer(output);
+      val.Accept(writer);
+    }
+  }
+
+  /// \brief Write JSON to string
+  /// \param [in] val JSON to be written
+  /// \param [in] pretty pretty output if true else compact
+  /// \return written JSON
+  std::string writeJson(const rapidjson::Value& val, bool pretty)
+  {
+    //buffer keeps its capacity for next responses of the thread
+    static thread_local StringBuffer buffer;
+    buffer.Clear();
+    writeJson(val, pretty, buffer);
+    return std::string(buffer.GetString(), buffer.GetSize());
+  }
+}
 
 //////////////////////////////////////////
+void* PrfCommonJson::operator new(size_t size)
+{
+  if (size <= REQUEST_BLOCK_SIZE)
+    return RequestBlockPool::get().acquire();
+  return ::operator new(size);
+}
+
+void PrfCommonJson::operator delete(void* ptr, size_t size)
+{
+  if (size <= REQUEST_BLOCK_SIZE)
+    RequestBlockPool::get().release(ptr);
+  else
+    ::operator delete(ptr);
+}
+
 PrfCommonJson::PrfCommonJson()
+  :m_arenaAllocator(m_arenaChunk, sizeof(m_arenaChunk), ARENA_CHUNK_SIZE)
+  , m_doc(&m_arenaAllocator)
 {
   m_doc.SetObject();
 }
 
+const JsonField<PrfCommonJson> PrfCommonJson::PRIO1_FIELDS[6] = {
+  { JSON_FIELD_NAME(CTYPE_STR), &PrfCommonJson::m_has_ctype, &PrfCommonJson::m_ctype, nullptr,
+    FIELDS_HEADER, JsonFieldEncoding::Echo, JSON_FIELD_BOTH },
+  { JSON_FIELD_NAME(TYPE_STR), &PrfCommonJson::m_has_type, &PrfCommonJson::m_type, nullptr,
+    FIELDS_HEADER, JsonFieldEncoding::Echo, JSON_FIELD_BOTH },
+  //msgid correlates the response so it is encoded regardless selected fields
+  { JSON_FIELD_NAME(MSGID_STR), &PrfCommonJson::m_has_msgid, &PrfCommonJson::m_msgid, nullptr,
+    0, JsonFieldEncoding::Echo, JSON_FIELD_BOTH },
+  { JSON_FIELD_NAME(TIMEOUT_STR), &PrfCommonJson::m_has_timeout, nullptr, &PrfCommonJson::m_timeoutJ,
+    FIELDS_HEADER, JsonFieldEncoding::Echo, JSON_FIELD_BOTH },
+  { JSON_FIELD_NAME(RETRIES_STR), &PrfCommonJson::m_has_retries, nullptr, &PrfCommonJson::m_retries,
+    FIELDS_HEADER, JsonFieldEncoding::Echo, JSON_FIELD_BOTH },
+  { JSON_FIELD_NAME(NADR_STR), &PrfCommonJson::m_has_nadr, &PrfCommonJson::m_nadr, nullptr,
+    FIELDS_HEADER, JsonFieldEncoding::EchoResponded, JSON_FIELD_BOTH },
+};
+
+const JsonField<PrfCommonJson> PrfCommonJson::PRIO2_FIELDS[2] = {
+  { JSON_FIELD_NAME(CMD_STR), &PrfCommonJson::m_has_cmd, &PrfCommonJson::m_cmdJ, nullptr,
+    FIELDS_HEADER, JsonFieldEncoding::EchoResponded, JSON_FIELD_BOTH },
+  { JSON_FIELD_NAME(HWPID_STR), &PrfCommonJson::m_has_hwpid, &PrfCommonJson::m_hwpid, nullptr,
+    FIELDS_HEADER, JsonFieldEncoding::EchoResponded, JSON_FIELD_BOTH },
+};
+
+const JsonField<PrfCommonJson> PrfCommonJson::FINAL_FIELDS[10] = {
+  { JSON_FIELD_NAME(RCODE_STR), &PrfCommonJson::m_has_rcode, &PrfCommonJson::m_rcodeJ, nullptr,
+    FIELDS_RAW, JsonFieldEncoding::ResponseCode, JSON_FIELD_BOTH },
+  { JSON_FIELD_NAME(DPAVAL_STR), &PrfCommonJson::m_has_dpaval, &PrfCommonJson::m_dpavalJ, nullptr,
+    FIELDS_RAW, JsonFieldEncoding::DpaValue, JSON_FIELD_BOTH },
+  //requested by peripheral types
+  { JSON_FIELD_NAME(RESD_STR), &PrfCommonJson::m_has_rdata, &PrfCommonJson::m_rdataJ, nullptr,
+    FIELDS_DATA, JsonFieldEncoding::ResponseData, JSON_FIELD_ENCODE | JSON_FIELD_BINARY },
+  { JSON_FIELD_NAME(REQUEST_STR), &PrfCommonJson::m_has_request, &PrfCommonJson::m_requestJ, nullptr,
+    FIELDS_RAW, JsonFieldEncoding::RequestPacket, JSON_FIELD_BOTH | JSON_FIELD_BINARY },
+  { JSON_FIELD_NAME(REQUEST_TS_STR), &PrfCommonJson::m_has_request_ts, &PrfCommonJson::m_request_ts, nullptr,
+    FIELDS_TIMESTAMPS, JsonFieldEncoding::RequestTs, JSON_FIELD_BOTH },
+  { JSON_FIELD_NAME(CONFIRMATION_STR), &PrfCommonJson::m_has_confirmation, &PrfCommonJson::m_confirmationJ, nullptr,
+    FIELDS_RAW, JsonFieldEncoding::ConfirmationPacket, JSON_FIELD_BOTH | JSON_FIELD_BINARY },
+  { JSON_FIELD_NAME(CONFIRMATION_TS_STR), &PrfCommonJson::m_has_confirmation_ts, &PrfCommonJson::m_confirmation_ts, nullptr,
+    FIELDS_TIMESTAMPS, JsonFieldEncoding::ConfirmationTs, JSON_FIELD_BOTH },
+  { JSON_FIELD_NAME(RESPONSE_STR), &PrfCommonJson::m_has_response, &PrfCommonJson::m_responseJ, nullptr,
+    FIELDS_RAW, JsonFieldEncoding::ResponsePacket, JSON_FIELD_BOTH | JSON_FIELD_BINARY },
+  { JSON_FIELD_NAME(RESPONSE_TS_STR), &PrfCommonJson::m_has_response_ts, &PrfCommonJson::m_response_ts, nullptr,
+    FIELDS_TIMESTAMPS, JsonFieldEncoding::ResponseTs, JSON_FIELD_BOTH },
+  //result of handling set by encodeResponse()
+  { JSON_FIELD_NAME(STATUS_STR), nullptr, &PrfCommonJson::m_statusJ, nullptr,
+    FIELDS_STATUS, JsonFieldEncoding::Echo, JSON_FIELD_ENCODE },
+};
+
 PrfCommonJson::PrfCommonJson(const PrfCommonJson& o)
+  :m_arenaAllocator(m_arenaChunk, sizeof(m_arenaChunk), ARENA_CHUNK_SIZE)
+  , m_doc(&m_arenaAllocator)
 {
   m_has_ctype = o.m_has_ctype;
   m_has_type = o.m_has_type;
   m_has_nadr = o.m_has_nadr;
   m_has_hwpid = o.m_has_hwpid;
   m_has_timeout = o.m_has_timeout;
+  m_has_retries = o.m_has_retries;
   m_has_msgid = o.m_has_msgid;
   m_has_request = o.m_has_request;
   m_has_request_ts = o.m_has_request_ts;
@@ -76,12 +383,14 @@ PrfCommonJson::PrfCommonJson(const PrfCommonJson& o)
   m_has_cmd = o.m_has_cmd;
   m_has_rcode = o.m_has_rcode;
   m_has_dpaval = o.m_has_dpaval;
+  m_has_fields = o.m_has_fields;
 
   m_ctype = o.m_ctype;
   m_type = o.m_type;
   m_nadr = o.m_nadr;
   m_hwpid = o.m_hwpid;
   m_timeoutJ = o.m_timeoutJ;
+  m_retries = o.m_retries;
   m_msgid = o.m_msgid;
   m_requestJ = o.m_requestJ;
   m_request_ts = o.m_request_ts;
@@ -93,28 +402,65 @@ PrfCommonJson::PrfCommonJson(const PrfCommonJson& o)
   m_statusJ = o.m_statusJ;
   m_rcodeJ = o.m_rcodeJ;
   m_dpavalJ = o.m_dpavalJ;
+  m_prettyOutput = o.m_prettyOutput;
+  m_rawBinary = o.m_rawBinary;
+  m_documentWriter = o.m_documentWriter;
+  m_fields = o.m_fields;
 
   m_doc.SetObject();
 }
 
+uint32_t PrfCommonJson::parseFields(const rapidjson::Value& names)
+{
+  static const struct {
+    const char* name;
+    Fields fields;
+  } FIELD_NAMES[] = {
+    { "header", FIELDS_HEADER },
+    { "timestamps", FIELDS_TIMESTAMPS },
+    { "raw", FIELDS_RAW },
+    { "data", FIELDS_DATA },
+    { "status", FIELDS_STATUS },
+  };
+
+  jutils::assertIsArray(FIELDS_STR, names);
+
+  uint32_t fields = 0;
+  for (auto it = names.Begin(); it != names.End(); ++it) {
+    if (!it->IsString()) {
+      THROW_EX(std::logic_error, "Expected string in: " << PAR(FIELDS_STR));
+    }
+    std::string name(it->GetString(), it->GetStringLength());
+    uint32_t found = 0;
+    for (const auto& fn : FIELD_NAMES) {
+      if (name == fn.name) {
+        found = fn.fields;
+        break;
+      }
+    }
+    if (found == 0) {
+      THROW_EX(std::logic_error, "Unexpected field: " << PAR(name));
+    }
+    fields |= found;
+  }
+  return fields;
+}
+
 int PrfCommonJson::parseBinary(uint8_t* to, const std::string& from, int maxlen)
 {
   int retval = 0;
-  if (!from.empty()) {
-    std::string buf = from;
-    if (std::string::npos != buf.find_first_of('.')) {
-      std::replace(buf.begin(), buf.end(), '.', ' ');
+  if (m_rawBinary) {
+    //the rest is ignored as in case of hexadecimal text
+    retval = std::min((int)from.size(), maxlen);
+    memcpy(to, from.data(), retval);
+  }
+  else if (!from.empty()) {
+    if (std::string::npos != from.find_first_of('.')) {
       m_dotNotation = true;
     }
-    std::istringstream istr(buf);
-
-    int val;
-    while (retval < maxlen) {
-      if (!(istr >> std::hex >> val)) {
-        if (istr.eof()) break;
-        THROW_EX(std::logic_error, "Unexpected format: " << PAR(from));
-      }
-      to[retval++] = (uint8_t)val;
+    retval = hexcodec::decode(to, maxlen, from.data(), from.size());
+    if (retval < 0) {
+      THROW_EX(std::logic_error, "Unexpected format: " << PAR(from));
     }
   }
   return retval;
@@ -122,39 +468,28 @@ int PrfCommonJson::parseBinary(uint8_t* to, const std::string& from, int maxlen)
 
 void PrfCommonJson::encodeHexaNum(std::string& to, uint8_t from)
 {
-  std::ostringstream os;
-  os.fill('0'); os.width(2);
-  os << std::hex << (int)from;
-  to = os.str();
+  char buf[2];
+  to.assign(buf, hexcodec::encodeNum(buf, from));
 }
 
 void PrfCommonJson::encodeHexaNum(std::string& to, uint16_t from)
 {
-  std::ostringstream os;
-  os.fill('0'); os.width(4);
-  os << std::hex << (int)from;
-  to = os.str();
+  char buf[4];
+  to.assign(buf, hexcodec::encodeNum(buf, from));
 }
 
 void PrfCommonJson::encodeBinary(std::string& to, const uint8_t* from, int len)
 {
+  if (m_rawBinary) {
+    to.assign((const char*)from, len > 0 ? len : 0);
+    return;
+  }
   bool dot = std::string::npos != to.find_first_of('.');
   to.clear();
   if (len > 0) {
-    std::ostringstream ostr;
-    ostr << iqrf::TracerHexString(from, len, true);
-
-    if (m_dotNotation || dot) {
-      to = ostr.str();
-      std::replace(to.begin(), to.end(), ' ', '.');
-      if (to[to.size() - 1] == '.')
-        to.pop_back();
-    }
-    else {
-      to = ostr.str();
-      if (to[to.size() - 1] == ' ')
-        to.pop_back();
-    }
+    to.resize(hexcodec::encodedSize(len));
+    size_t n = hexcodec::encode(&to[0], from, len, (m_dotNotation || dot) ? '.' : ' ');
+    to.resize(n);
   }
 }
 
@@ -164,20 +499,8 @@ void PrfCommonJson::encodeTimestamp(std::string& to, std::chrono::time_point<std
 
   to.clear();
   if (from.time_since_epoch() != system_clock::duration()) {
-    auto fromUs = std::chrono::duration_cast<std::chrono::microseconds>(from.time_since_epoch()).count() % 1000000;
-    auto time = std::chrono::system_clock::to_time_t(from);
-    //auto tm = *std::gmtime(&time);
-    auto tm = *std::localtime(&time);
-
-    char buf[80];
-    strftime(buf, sizeof(buf), "%FT%T", &tm);
-
-    std::ostringstream os;
-    os.fill('0'); os.width(6);
-    //os << std::put_time(&tm, "%F %T.") <<  fromUs; // << std::put_time(&tm, " %Z\n");
-    os << buf << "." << fromUs;
-
-    to = os.str();
+    char buf[TimestampFormatter::MICROS_SIZE];
+    to.assign(buf, TimestampFormatter::formatMicros(buf, from));
   }
 }
 
@@ -185,22 +508,20 @@ void PrfCommonJson::parseRequestJson(const rapidjson::Value& val, DpaTask& dpaTa
 {
   jutils::assertIsObject("", val);
 
-  m_has_ctype = jutils::getMemberIfExistsAs<std::string>(CTYPE_STR, val, m_ctype);
-  m_has_type = jutils::getMemberIfExistsAs<std::string>(TYPE_STR, val, m_type);
-  m_has_nadr = jutils::getMemberIfExistsAs<std::string>(NADR_STR, val, m_nadr);
-  m_has_hwpid = jutils::getMemberIfExistsAs<std::string>(HWPID_STR, val, m_hwpid);
-  m_has_timeout = jutils::getMemberIfExistsAs<int>(TIMEOUT_STR, val, m_timeoutJ);
-  m_has_msgid = jutils::getMemberIfExistsAs<std::string>(MSGID_STR, val, m_msgid);
-  m_has_request = jutils::getMemberIfExistsAs<std::string>(REQUEST_STR, val, m_requestJ);
-  m_has_request_ts = jutils::getMemberIfExistsAs<std::string>(REQUEST_TS_STR, val, m_request_ts);
-  m_has_response = jutils::getMemberIfExistsAs<std::string>(RESPONSE_STR, val, m_responseJ);
-  m_has_response_ts = jutils::getMemberIfExistsAs<std::string>(RESPONSE_TS_STR, val, m_response_ts);
-  m_has_confirmation = jutils::getMemberIfExistsAs<std::string>(CONFIRMATION_STR, val, m_confirmationJ);
-  m_has_confirmation_ts = jutils::getMemberIfExistsAs<std::string>(CONFIRMATION_TS_STR, val, m_confirmation_ts);
-  m_has_cmd = jutils::getMemberIfExistsAs<std::string>(CMD_STR, val, m_cmdJ);
-  m_has_rcode = jutils::getMemberIfExistsAs<std::string>(RCODE_STR, val, m_rcodeJ);
-  m_has_dpaval = jutils::getMemberIfExistsAs<std::string>(DPAVAL_STR, val, m_dpavalJ);
+  parseJsonFields(*this, PRIO1_FIELDS, val);
+  parseJsonFields(*this, PRIO2_FIELDS, val);
+  parseJsonFields(*this, FINAL_FIELDS, val);
+
+  const auto fields = val.FindMember(FIELDS_STR);
+  m_has_fields = fields != val.MemberEnd();
+  if (m_has_fields) {
+    m_fields = parseFields(fields->value);
+  }
 
+  if (m_has_msgid) {
+    //correlates asynchronously sent response
+    dpaTask.setClid(m_msgid);
+  }
   if (m_has_nadr) {
     uint16_t nadr;
     parseHexaNum(nadr, m_nadr);
@@ -221,138 +542,180 @@ void PrfCommonJson::parseRequestJson(const rapidjson::Value& val, DpaTask& dpaTa
 
 void PrfCommonJson::addResponseJsonPrio1Params(const DpaTask& dpaTask)
 {
-  Document::AllocatorType& alloc = m_doc.GetAllocator();
-  rapidjson::Value v;
-
-  bool responded = true;
-  if (0 >= dpaTask.getResponse().GetLength())
-    responded = false;
-
-  if (m_has_ctype) {
-    v.SetString(m_ctype.c_str(), alloc);
-    m_doc.AddMember(CTYPE_STR, v, alloc);
-  }
-  if (m_has_type) {
-    v.SetString(m_type.c_str(), alloc);
-    m_doc.AddMember(TYPE_STR, v, alloc);
-  }
-  if (m_has_msgid) {
-    v.SetString(m_msgid.c_str(), alloc);
-    m_doc.AddMember(MSGID_STR, v, alloc);
-  }
-  if (m_has_timeout) {
-    v = m_timeoutJ;
-    m_doc.AddMember(TIMEOUT_STR, v, alloc);
-  }
-  if (m_has_nadr) {
-    if (!responded)
-      m_nadr.clear();
-    v.SetString(m_nadr.c_str(), alloc);
-    m_doc.AddMember(NADR_STR, v, alloc);
-  }
+  encodeJsonFields(*this, PRIO1_FIELDS, dpaTask);
 }
 
 void PrfCommonJson::addResponseJsonPrio2Params(const DpaTask& dpaTask)
 {
-  Document::AllocatorType& alloc = m_doc.GetAllocator();
-  rapidjson::Value v;
+  encodeJsonFields(*this, PRIO2_FIELDS, dpaTask);
+}
 
-  bool responded = true;
-  if (0 >= dpaTask.getResponse().GetLength())
-    responded = false;
+bool PrfCommonJson::parseJsonField(const rapidjson::Value& val, const char* name, rapidjson::SizeType length,
+  bool mandatory, std::string* str, int* num, bool* boolean, const JsonEnum* names)
+{
+  const auto m = val.FindMember(rapidjson::Value(rapidjson::StringRef(name, length)));
+  if (m == val.MemberEnd()) {
+    if (mandatory) {
+      THROW_EX(std::logic_error, "Expected member: " << PAR(name));
+    }
+    return false;
+  }
 
-  if (m_has_cmd) {
-    if (!responded)
-      m_cmdJ.clear();
-    v.SetString(m_cmdJ.c_str(), alloc);
-    m_doc.AddMember(CMD_STR, v, alloc);
+  if (str) {
+    if (!m->value.IsString()) {
+      jutils::assertIs<std::string>(name, m->value);
+    }
+    str->assign(m->value.GetString(), m->value.GetStringLength());
   }
-  if (m_has_hwpid) {
-    if (!responded)
-      m_hwpid.clear();
-    v.SetString(m_hwpid.c_str(), alloc);
-    m_doc.AddMember(HWPID_STR, v, alloc);
+  else if (num && names) {
+    if (!m->value.IsString()) {
+      jutils::assertIs<std::string>(name, m->value);
+    }
+    const JsonEnum* e = names;
+    while (e->name && strcmp(e->name, m->value.GetString()) != 0) {
+      e++;
+    }
+    if (!e->name) {
+      THROW_EX(std::logic_error, "Unexpected value: " << PAR(name) << NAME_PAR(value, m->value.GetString()));
+    }
+    *num = e->value;
+  }
+  else if (num) {
+    if (!m->value.IsInt()) {
+      jutils::assertIs<int>(name, m->value);
+    }
+    *num = m->value.GetInt();
+  }
+  else if (boolean) {
+    if (!m->value.IsBool()) {
+      jutils::assertIs<bool>(name, m->value);
+    }
+    *boolean = m->value.GetBool();
   }
+  return true;
 }
 
-std::string PrfCommonJson::encodeResponseJsonFinal(const DpaTask& dpaTask)
+void PrfCommonJson::encodeJsonField(const char* name, rapidjson::SizeType length, std::string* str, const int* num,
+  const bool* boolean, const JsonEnum* names, JsonFieldEncoding encoding, const DpaTask& dpaTask)
 {
   Document::AllocatorType& alloc = m_doc.GetAllocator();
   rapidjson::Value v;
 
-  bool responded = true;
-  if (0 >= dpaTask.getResponse().GetLength())
-    responded = false;
+  const auto& response = dpaTask.getResponse();
+  bool responded = 0 < response.GetLength();
 
-  if (m_has_rcode) {
+  switch (encoding) {
+  case JsonFieldEncoding::Echo:
+    break;
+  case JsonFieldEncoding::EchoResponded:
+    if (!responded)
+      str->clear();
+    break;
+  case JsonFieldEncoding::ResponseCode:
     if (responded)
-      encodeHexaNum(m_rcodeJ, dpaTask.getResponse().DpaPacket().DpaResponsePacket_t.ResponseCode);
+      encodeHexaNum(*str, response.DpaPacket().DpaResponsePacket_t.ResponseCode);
     else
-      m_rcodeJ.clear();
-    v.SetString(m_rcodeJ.c_str(), alloc);
-    m_doc.AddMember(RCODE_STR, v, alloc);
-  }
-
-  if (m_has_dpaval) {
+      str->clear();
+    break;
+  case JsonFieldEncoding::DpaValue:
     if (responded)
-      encodeHexaNum(m_dpavalJ, dpaTask.getResponse().DpaPacket().DpaResponsePacket_t.DpaValue);
+      encodeHexaNum(*str, response.DpaPacket().DpaResponsePacket_t.DpaValue);
     else
-      m_dpavalJ.clear();
-    v.SetString(m_dpavalJ.c_str(), alloc);
-    m_doc.AddMember(DPAVAL_STR, v, alloc);
-  }
-
-  if (m_has_rdata) {
+      str->clear();
+    break;
+  case JsonFieldEncoding::ResponseData:
     if (responded) {
-      int datalen = dpaTask.getResponse().GetLength() - sizeof(TDpaIFaceHeader) - 2; //DpaValue ResponseCode
+      int datalen = response.GetLength() - sizeof(TDpaIFaceHeader) - 2; //DpaValue ResponseCode
       if (datalen > 0) {
-        encodeBinary(m_rdataJ, dpaTask.getResponse().DpaPacket().DpaResponsePacket_t.DpaMessage.Response.PData, datalen);
+        encodeBinary(*str, response.DpaPacket().DpaResponsePacket_t.DpaMessage.Response.PData, datalen);
       }
     }
     else
-      m_rdataJ.clear();
-    v.SetString(m_rdataJ.c_str(), alloc);
-    m_doc.AddMember(RESD_STR, v, alloc);
+      str->clear();
+    break;
+  case JsonFieldEncoding::RequestPacket:
+    encodeBinary(*str, dpaTask.getRequest().DpaPacket().Buffer, dpaTask.getRequest().GetLength());
+    break;
+  case JsonFieldEncoding::ConfirmationPacket:
+    encodeBinary(*str, dpaTask.getConfirmation().DpaPacket().Buffer, dpaTask.getConfirmation().GetLength());
+    break;
+  case JsonFieldEncoding::ResponsePacket:
+    encodeBinary(*str, response.DpaPacket().Buffer, response.GetLength());
+    break;
+  case JsonFieldEncoding::RequestTs:
+    encodeTimestamp(*str, dpaTask.getRequestTs());
+    break;
+  case JsonFieldEncoding::ConfirmationTs:
+    encodeTimestamp(*str, dpaTask.getConfirmationTs());
+    break;
+  case JsonFieldEncoding::ResponseTs:
+    encodeTimestamp(*str, dpaTask.getResponseTs());
+    break;
+  case JsonFieldEncoding::Enum:
+  case JsonFieldEncoding::Callback:
+    break;
   }
 
-  if (m_has_request) {
-    encodeBinary(m_requestJ, dpaTask.getRequest().DpaPacket().Buffer, dpaTask.getRequest().GetLength());
-    v.SetString(m_requestJ.c_str(), alloc);
-    m_doc.AddMember(REQUEST_STR, v, alloc);
+  if (str) {
+    v.SetString(str->data(), (SizeType)str->size(), alloc);
   }
-  if (m_has_request_ts) {
-    encodeTimestamp(m_request_ts, dpaTask.getRequestTs());
-    v.SetString(m_request_ts.c_str(), alloc);
-    m_doc.AddMember(REQUEST_TS_STR, v, alloc);
+  else if (num && names) {
+    //names are string literals referenced by the document
+    const JsonEnum* e = names;
+    while (e->name && e->value != *num) {
+      e++;
+    }
+    v.SetString(rapidjson::StringRef(e->name ? e->name : ""));
   }
-  if (m_has_confirmation) {
-    encodeBinary(m_confirmationJ, dpaTask.getConfirmation().DpaPacket().Buffer, dpaTask.getConfirmation().GetLength());
-    v.SetString(m_confirmationJ.c_str(), alloc);
-    m_doc.AddMember(CONFIRMATION_STR, v, alloc);
+  else if (num) {
+    v = *num;
   }
-  if (m_has_confirmation_ts) {
-    encodeTimestamp(m_confirmation_ts, dpaTask.getConfirmationTs());
-    v.SetString(m_confirmation_ts.c_str(), alloc);
-    m_doc.AddMember(CONFIRMATION_TS_STR, v, alloc);
+  else {
+    v = *boolean;
   }
-  if (m_has_response) {
-    encodeBinary(m_responseJ, dpaTask.getResponse().DpaPacket().Buffer, dpaTask.getResponse().GetLength());
-    v.SetString(m_responseJ.c_str(), alloc);
-    m_doc.AddMember(RESPONSE_STR, v, alloc);
+  m_doc.AddMember(rapidjson::StringRef(name, length), v, alloc);
+}
+
+std::string PrfCommonJson::encodeResponseJsonFinal(const DpaTask& dpaTask)
+{
+  encodeJsonFields(*this, FINAL_FIELDS, dpaTask);
+
+  //written directly to the buffer of messaging if invoked via encodeResponseTo()
+  if (m_output) {
+    if (m_documentWriter) {
+      m_documentWriter(m_doc, m_binaryMembers, *m_output);
+    }
+    else {
+      writeJson(m_doc, m_prettyOutput, *m_output);
+    }
+    return std::string();
   }
-  if (m_has_response_ts) {
-    encodeTimestamp(m_response_ts, dpaTask.getResponseTs());
-    v.SetString(m_response_ts.c_str(), alloc);
-    m_doc.AddMember(RESPONSE_TS_STR, v, alloc);
+
+  if (m_documentWriter) {
+    OutputBuffer output;
+    m_documentWriter(m_doc, m_binaryMembers, output);
+    return output.str();
   }
+  return writeJson(m_doc, m_prettyOutput);
+}
 
-  v.SetString(m_statusJ.c_str(), alloc);
-  m_doc.AddMember(STATUS_STR, v, alloc);
+void PrfCommonJson::encodeResponseTo(const std::string& errStr, OutputBuffer& output)
+{
+  //the task is derived from this mixin, its encodeResponse() ends by encodeResponseJsonFinal()
+  DpaTask* dpaTask = dynamic_cast<DpaTask*>(this);
+  if (!dpaTask) {
+    THROW_EX(std::logic_error, "Not a DpaTask");
+  }
 
-  StringBuffer buffer;
-  PrettyWriter<StringBuffer> writer(buffer);
-  m_doc.Accept(writer);
-  return buffer.GetString();
+  m_output = &output;
+  try {
+    dpaTask->encodeResponse(errStr);
+  }
+  catch (...) {
+    m_output = nullptr;
+    throw;
+  }
+  m_output = nullptr;
 }
 
 /////////////////////////////////////////
@@ -364,7 +727,10 @@ PrfRawJson::PrfRawJson(const rapidjson::Value& val)
   if (!m_has_request) {
     THROW_EX(std::logic_error, "Missing member: " << REQUEST_STR);
   }
+}
 
+void PrfRawJson::parseBinaryMembers()
+{
   int len = parseBinary(m_request.DpaPacket().Buffer, m_requestJ, MAX_DPA_BUFFER);
   m_request.SetLength(len);
 }
@@ -428,16 +794,23 @@ const std::string PrfRawHdpJson::PRF_NAME("raw-hdp");
 #define PCMD_STR "pcmd"
 #define REQD_STR "rdata"
 
+const JsonField<PrfRawHdpJson> PrfRawHdpJson::HDP_FIELDS[4] = {
+  //mandatory here
+  { JSON_FIELD_NAME(PNUM_STR), nullptr, &PrfRawHdpJson::m_pnum, nullptr,
+    FIELDS_HEADER, JsonFieldEncoding::Echo, JSON_FIELD_BOTH },
+  { JSON_FIELD_NAME(PCMD_STR), nullptr, &PrfRawHdpJson::m_pcmd, nullptr,
+    FIELDS_HEADER, JsonFieldEncoding::Echo, JSON_FIELD_BOTH },
+  //encoded by common members
+  { JSON_FIELD_NAME(HWPID_STR), nullptr, &PrfCommonJson::m_hwpid, nullptr,
+    0, JsonFieldEncoding::Echo, JSON_FIELD_PARSE },
+  { JSON_FIELD_NAME(REQD_STR), &PrfRawHdpJson::m_has_data, &PrfRawHdpJson::m_data, nullptr,
+    0, JsonFieldEncoding::Echo, JSON_FIELD_PARSE | JSON_FIELD_BINARY },
+};
+
 PrfRawHdpJson::PrfRawHdpJson(const rapidjson::Value& val)
 {
   parseRequestJson(val, *this);
-
-  //mandatory here
-  m_pnum = jutils::getMemberAs<std::string>(PNUM_STR, val);
-  m_pcmd = jutils::getMemberAs<std::string>(PCMD_STR, val);
-  m_hwpid = jutils::getMemberAs<std::string>(HWPID_STR, val);
-
-  m_data = jutils::getPossibleMemberAs<std::string>(REQD_STR, val, m_data);
+  parseJsonFields(*this, HDP_FIELDS, val);
 
   {
     uint8_t pnum;
@@ -456,17 +829,16 @@ PrfRawHdpJson::PrfRawHdpJson(const rapidjson::Value& val)
     parseHexaNum(hwpid, m_hwpid);
     m_request.DpaPacket().DpaRequestPacket_t.HWPID = hwpid;
   }
+}
 
+void PrfRawHdpJson::parseBinaryMembers()
+{
   int len = parseBinary(m_request.DpaPacket().DpaRequestPacket_t.DpaMessage.Request.PData, m_data, DPA_MAX_DATA_LENGTH);
   m_request.SetLength(sizeof(TDpaIFaceHeader) + len);
-
 }
 
 std::string PrfRawHdpJson::encodeResponse(const std::string& errStr)
 {
-  Document::AllocatorType& alloc = m_doc.GetAllocator();
-  rapidjson::Value v;
-
   addResponseJsonPrio1Params(*this);
 
   bool responded = true;
@@ -489,11 +861,7 @@ std::string PrfRawHdpJson::encodeResponse(const std::string& errStr)
     m_hwpid.clear();
   }
 
-  v.SetString(m_pnum.c_str(), alloc);
-  m_doc.AddMember(PNUM_STR, v, alloc);
-  
-  v.SetString(m_pcmd.c_str(), alloc);
-  m_doc.AddMember(PCMD_STR, v, alloc);
+  encodeJsonFields(*this, HDP_FIELDS, *this);
 
   //mandatory here
   m_has_rcode = true;
@@ -507,20 +875,29 @@ std::string PrfRawHdpJson::encodeResponse(const std::string& errStr)
 }
 
 //-------------------------------
+#define TEMPERATURE_STR "temperature"
+
+const JsonField<PrfThermometerJson> PrfThermometerJson::THERMOMETER_FIELDS[1] = {
+  { JSON_FIELD_NAME(TEMPERATURE_STR), nullptr, nullptr, nullptr,
+    FIELDS_DATA, JsonFieldEncoding::Callback, JSON_FIELD_ENCODE, nullptr, nullptr, &PrfThermometerJson::encodeTemperature },
+};
+
 PrfThermometerJson::PrfThermometerJson(const rapidjson::Value& val)
 {
   parseRequestJson(val, *this);
 }
 
-std::string PrfThermometerJson::encodeResponse(const std::string& errStr)
+bool PrfThermometerJson::encodeTemperature(rapidjson::Value& v)
 {
-  rapidjson::Value v;
+  v = getFloatTemperature();
+  return true;
+}
 
+std::string PrfThermometerJson::encodeResponse(const std::string& errStr)
+{
   addResponseJsonPrio1Params(*this);
   addResponseJsonPrio2Params(*this);
-
-  v = getFloatTemperature();
-  m_doc.AddMember("temperature", v, m_doc.GetAllocator());
+  encodeJsonFields(*this, THERMOMETER_FIELDS, *this);
 
   m_statusJ = errStr;
   return encodeResponseJsonFinal(*this);
@@ -532,90 +909,188 @@ std::string PrfThermometerJson::encodeResponse(const std::string& errStr)
 #define FRC_USER_STR "frc_user"
 #define FRC_USER_DATA_STR "user_data"
 #define FRC_DATA_STR "frc_data"
+#define FRC_DATA_FORMAT_STR "frc_data_format"
+
+const JsonEnum PrfFrcJson::FRC_DATA_FORMATS[4] = {
+  { "hex", (int)FrcDataFormat::Hex },
+  { "array", (int)FrcDataFormat::Array },
+  { "nodes", (int)FrcDataFormat::Nodes },
+  { nullptr, 0 }
+};
+
+const JsonField<PrfFrcJson> PrfFrcJson::FRC_FIELDS[6] = {
+  //either predefined command or type and user command, echoed as parsed by PrfFrc
+  { JSON_FIELD_NAME(FRC_CMD_STR), &PrfFrcJson::m_predefinedFrcCommand, &PrfFrcJson::m_frcCmdJ, nullptr,
+    FIELDS_HEADER, JsonFieldEncoding::Callback, JSON_FIELD_BOTH, nullptr, nullptr, &PrfFrcJson::encodeFrcCmdField },
+  { JSON_FIELD_NAME(FRC_TYPE_STR), &PrfFrcJson::m_has_frcType, &PrfFrcJson::m_frcTypeJ, nullptr,
+    FIELDS_HEADER, JsonFieldEncoding::Callback, JSON_FIELD_BOTH, nullptr, nullptr, &PrfFrcJson::encodeFrcTypeField },
+  { JSON_FIELD_NAME(FRC_USER_STR), &PrfFrcJson::m_has_frcUser, nullptr, &PrfFrcJson::m_frcUserJ,
+    FIELDS_HEADER, JsonFieldEncoding::Callback, JSON_FIELD_BOTH, nullptr, nullptr, &PrfFrcJson::encodeFrcUserField },
+  { JSON_FIELD_NAME(FRC_USER_DATA_STR), &PrfFrcJson::m_has_userData, &PrfFrcJson::m_userData, nullptr,
+    0, JsonFieldEncoding::Echo, JSON_FIELD_PARSE | JSON_FIELD_BINARY },
+  { JSON_FIELD_NAME(FRC_DATA_FORMAT_STR), &PrfFrcJson::m_has_frcDataFormat, nullptr, &PrfFrcJson::m_frcDataFormatJ,
+    FIELDS_HEADER, JsonFieldEncoding::Enum, JSON_FIELD_BOTH, nullptr, FRC_DATA_FORMATS },
+  { JSON_FIELD_NAME(FRC_DATA_STR), nullptr, nullptr, nullptr,
+    FIELDS_DATA, JsonFieldEncoding::Callback, JSON_FIELD_ENCODE | JSON_FIELD_BINARY, nullptr, nullptr, &PrfFrcJson::encodeFrcData },
+};
 
 PrfFrcJson::PrfFrcJson(const rapidjson::Value& val)
 {
   parseRequestJson(val, *this);
+  parseJsonFields(*this, FRC_FIELDS, val);
 
-  std::string frcCmd = jutils::getPossibleMemberAs<std::string>(FRC_CMD_STR, val, "");
-  if (!frcCmd.empty()) {
-    setFrcCommand(parseFrcCmd(frcCmd));
-    m_predefinedFrcCommand = true;
+  if (m_predefinedFrcCommand && !m_frcCmdJ.empty()) {
+    setFrcCommand(parseFrcCmd(m_frcCmdJ));
+    //type and user command are given by predefined command
+    m_has_frcType = false;
+    m_has_frcUser = false;
   }
   else {
-    std::string frcType = jutils::getMemberAs<std::string>(FRC_TYPE_STR, val);
-    uint8_t frcUser = (uint8_t)jutils::getMemberAs<int>(FRC_USER_STR, val);
-    setFrcCommand(parseFrcType(frcType), frcUser);
+    m_predefinedFrcCommand = false;
+    if (!m_has_frcType) {
+      THROW_EX(std::logic_error, "Expected member: " << NAME_PAR(name, FRC_TYPE_STR));
+    }
+    if (!m_has_frcUser) {
+      THROW_EX(std::logic_error, "Expected member: " << NAME_PAR(name, FRC_USER_STR));
+    }
+    setFrcCommand(parseFrcType(m_frcTypeJ), (uint8_t)m_frcUserJ);
   }
 
-  m_userData = jutils::getPossibleMemberAs<std::string>(FRC_USER_DATA_STR, val, m_userData);
-  if (!m_userData.empty()) {
+  m_frcDataFormat = (FrcDataFormat)m_frcDataFormatJ;
+}
+
+void PrfFrcJson::parseBinaryMembers()
+{
+  if (m_has_userData && !m_userData.empty()) {
     const int udatalen = 30;
     uint8_t buf[udatalen];
     int len = parseBinary(buf, m_userData, udatalen);
     setUserData(PrfFrc::UserData(buf, len));
   }
+}
 
+bool PrfFrcJson::encodeFrcCmdField(rapidjson::Value& v)
+{
+  v.SetString(PrfFrc::encodeFrcCmd((FrcCmd)getFrcCommand()).c_str(), m_doc.GetAllocator());
+  return true;
 }
 
-std::string PrfFrcJson::encodeResponse(const std::string& errStr)
+bool PrfFrcJson::encodeFrcTypeField(rapidjson::Value& v)
 {
-  Document::AllocatorType& alloc = m_doc.GetAllocator();
-  rapidjson::Value v;
+  v.SetString(PrfFrc::encodeFrcType((FrcType)getFrcType()).c_str(), m_doc.GetAllocator());
+  return true;
+}
 
-  addResponseJsonPrio1Params(*this);
-  addResponseJsonPrio2Params(*this);
+bool PrfFrcJson::encodeFrcUserField(rapidjson::Value& v)
+{
+  v = (int)getFrcUser();
+  return true;
+}
 
-  if (m_predefinedFrcCommand) {
-    v.SetString(PrfFrc::encodeFrcCmd((FrcCmd)getFrcCommand()).c_str(), alloc);
-    m_doc.AddMember(FRC_CMD_STR, v, alloc);
+uint16_t PrfFrcJson::getFrcValue(int node) const
+{
+  switch (getFrcType()) {
+  case FrcType::GET_BIT2:
+    return getFrcData_bit2(node);
+  case FrcType::GET_BYTE:
+    return getFrcData_Byte(node);
+  case FrcType::GET_BYTE2:
+    return getFrcData_Byte2(node);
+  default:
+    return 0;
   }
-  else {
-    v.SetString(PrfFrc::encodeFrcType((FrcType)getFrcType()).c_str(), alloc);
-    m_doc.AddMember(FRC_TYPE_STR, v, alloc);
+}
 
-    v = (int)getFrcUser();
-    m_doc.AddMember(FRC_USER_STR, v, alloc);
+int PrfFrcJson::getFrcNodes() const
+{
+  switch (getFrcType()) {
+  case FrcType::GET_BIT2:
+    return PrfFrc::FRC_MAX_NODE_BIT2;
+  case FrcType::GET_BYTE:
+    return PrfFrc::FRC_MAX_NODE_BYTE;
+  case FrcType::GET_BYTE2:
+    return PrfFrc::FRC_MAX_NODE_BYTE2;
+  default:
+    return 0;
   }
+}
 
-  std::ostringstream os;
-  os.setf(std::ios::hex, std::ios::basefield);
-  os.fill('0');
-  char separator = m_dotNotation ? '.' : ' ';
+bool PrfFrcJson::encodeFrcData(rapidjson::Value& v)
+{
+  Document::AllocatorType& alloc = m_doc.GetAllocator();
+  int nodes = getFrcNodes();
 
-  switch (getFrcType()) {
-  case FrcType::GET_BIT2:
+  switch (m_frcDataFormat) {
+
+  case FrcDataFormat::Array:
   {
-    for (int i = 1; i <= PrfFrc::FRC_MAX_NODE_BIT2; i++) {
-      os << std::setw(2) << (int)getFrcData_bit2(i) << separator;
+    v.SetArray();
+    v.Reserve(nodes, alloc);
+    for (int i = 1; i <= nodes; i++) {
+      v.PushBack((unsigned)getFrcValue(i), alloc);
     }
   }
   break;
 
-  case FrcType::GET_BYTE:
+  case FrcDataFormat::Nodes:
   {
-    for (int i = 1; i <= PrfFrc::FRC_MAX_NODE_BYTE; i++) {
-      os << std::setw(2) << (int)getFrcData_Byte(i) << separator;
+    //not responded nodes keep zero value
+    v.SetObject();
+    for (int i = 1; i <= nodes; i++) {
+      uint16_t value = getFrcValue(i);
+      if (value != 0) {
+        char name[4];
+        int len = snprintf(name, sizeof(name), "%d", i);
+        rapidjson::Value n(name, (SizeType)len, alloc);
+        v.AddMember(n, (unsigned)value, alloc);
+      }
     }
   }
   break;
 
-  case FrcType::GET_BYTE2:
+  case FrcDataFormat::Hex:
+  default:
   {
-    for (int i = 1; i <= PrfFrc::FRC_MAX_NODE_BYTE2; i++) {
-      os << std::setw(4) << (int)getFrcData_Byte2(i) << separator;
+    if (m_rawBinary) {
+      //bytes of bit2 and byte values, little endian byte2 values as in DPA
+      uint8_t buf[PrfFrc::FRC_MAX_NODE_BIT2];
+      uint8_t* p = buf;
+      bool byte2 = getFrcType() == FrcType::GET_BYTE2;
+      for (int i = 1; i <= nodes; i++) {
+        uint16_t value = getFrcValue(i);
+        *p++ = (uint8_t)value;
+        if (byte2) {
+          *p++ = (uint8_t)(value >> 8);
+        }
+      }
+      v.SetString((const char*)buf, (SizeType)(p - buf), alloc);
+      break;
+    }
+
+    //2 digits of bit2 and byte values, 4 digits of byte2 values
+    char buf[PrfFrc::FRC_MAX_NODE_BIT2 * 3];
+    char separator = m_dotNotation ? '.' : ' ';
+    char* p = buf;
+    bool byte2 = getFrcType() == FrcType::GET_BYTE2;
+    for (int i = 1; i <= nodes; i++) {
+      uint16_t value = getFrcValue(i);
+      p += byte2 ? hexcodec::encodeNum(p, value) : hexcodec::encodeNum(p, (uint8_t)value);
+      *p++ = separator;
+    }
+    if (p > buf) {
+      p--;
     }
+    v.SetString(buf, (SizeType)(p - buf), alloc);
   }
-  break;
-  default:
-    ;
   }
+  return true;
+}
 
-  std::string values(os.str());
-  values.pop_back();
-
-  v.SetString(values.c_str(), alloc);
-  m_doc.AddMember(FRC_DATA_STR, v, alloc);
+std::string PrfFrcJson::encodeResponse(const std::string& errStr)
+{
+  addResponseJsonPrio1Params(*this);
+  addResponseJsonPrio2Params(*this);
+  encodeJsonFields(*this, FRC_FIELDS, *this);
 
   m_statusJ = errStr;
   return encodeResponseJsonFinal(*this);
@@ -627,6 +1102,34 @@ std::string PrfFrcJson::encodeResponse(const std::string& errStr)
 #define DIR_STR "inp"
 #define VAL_STR "val"
 
+const JsonField<PrfIoJson> PrfIoJson::DIRECTION_FIELDS[3] = {
+  { JSON_FIELD_NAME(PORT_STR), nullptr, &PrfIoJson::m_portJ, nullptr,
+    FIELDS_HEADER, JsonFieldEncoding::Callback, JSON_FIELD_BOTH, nullptr, nullptr, &PrfIoJson::encodePortField },
+  { JSON_FIELD_NAME(BIT_STR), nullptr, nullptr, &PrfIoJson::m_bit,
+    FIELDS_HEADER, JsonFieldEncoding::Echo, JSON_FIELD_BOTH },
+  { JSON_FIELD_NAME(DIR_STR), nullptr, nullptr, nullptr,
+    FIELDS_HEADER, JsonFieldEncoding::Echo, JSON_FIELD_BOTH, &PrfIoJson::m_val },
+};
+
+const JsonField<PrfIoJson> PrfIoJson::SET_FIELDS[3] = {
+  { JSON_FIELD_NAME(PORT_STR), nullptr, &PrfIoJson::m_portJ, nullptr,
+    FIELDS_HEADER, JsonFieldEncoding::Callback, JSON_FIELD_BOTH, nullptr, nullptr, &PrfIoJson::encodePortField },
+  { JSON_FIELD_NAME(BIT_STR), nullptr, nullptr, &PrfIoJson::m_bit,
+    FIELDS_HEADER, JsonFieldEncoding::Echo, JSON_FIELD_BOTH },
+  { JSON_FIELD_NAME(VAL_STR), nullptr, nullptr, nullptr,
+    FIELDS_HEADER, JsonFieldEncoding::Echo, JSON_FIELD_BOTH, &PrfIoJson::m_val },
+};
+
+const JsonField<PrfIoJson> PrfIoJson::GET_FIELDS[3] = {
+  { JSON_FIELD_NAME(PORT_STR), nullptr, &PrfIoJson::m_portJ, nullptr,
+    FIELDS_HEADER, JsonFieldEncoding::Callback, JSON_FIELD_BOTH, nullptr, nullptr, &PrfIoJson::encodePortField },
+  { JSON_FIELD_NAME(BIT_STR), nullptr, nullptr, &PrfIoJson::m_bit,
+    FIELDS_HEADER, JsonFieldEncoding::Echo, JSON_FIELD_BOTH },
+  //read input value is data
+  { JSON_FIELD_NAME(VAL_STR), nullptr, nullptr, nullptr,
+    FIELDS_DATA, JsonFieldEncoding::Callback, JSON_FIELD_ENCODE, nullptr, nullptr, &PrfIoJson::encodeInputField },
+};
+
 PrfIoJson::PrfIoJson(const rapidjson::Value& val)
 {
   parseRequestJson(val, *this);
@@ -634,93 +1137,58 @@ PrfIoJson::PrfIoJson(const rapidjson::Value& val)
   switch (getCmd()) {
 
   case PrfIo::Cmd::DIRECTION:
-  {
-    Port port = parsePort(jutils::getMemberAs<std::string>(PORT_STR, val));
-    int bit = jutils::getMemberAs<int>(BIT_STR, val);
-    bool inp = jutils::getMemberAs<bool>(DIR_STR, val);
-    directionCommand(port, bit, inp);
-    m_port = port;
-    m_bit = bit;
-    m_val = inp;
-  }
-  break;
+    parseJsonFields(*this, DIRECTION_FIELDS, val);
+    m_port = parsePort(m_portJ);
+    directionCommand(m_port, m_bit, m_val);
+    break;
 
   case PrfIo::Cmd::SET:
-  {
-    Port port = parsePort(jutils::getMemberAs<std::string>(PORT_STR, val));
-    int bit = jutils::getMemberAs<int>(BIT_STR, val);
-    bool value = jutils::getMemberAs<bool>(VAL_STR, val);
-    setCommand(port, bit, value);
-    m_port = port;
-    m_bit = bit;
-    m_val = value;
-  }
-  break;
+    parseJsonFields(*this, SET_FIELDS, val);
+    m_port = parsePort(m_portJ);
+    setCommand(m_port, m_bit, m_val);
+    break;
 
   case PrfIo::Cmd::GET:
-  {
-    Port port = parsePort(jutils::getMemberAs<std::string>(PORT_STR, val));
-    int bit = jutils::getMemberAs<int>(BIT_STR, val);
-    m_port = port;
-    m_bit = bit;
+    parseJsonFields(*this, GET_FIELDS, val);
+    m_port = parsePort(m_portJ);
     getCommand();
-  }
-  break;
+    break;
 
   default:
     ;
   }
 }
 
-std::string PrfIoJson::encodeResponse(const std::string& errStr)
+bool PrfIoJson::encodePortField(rapidjson::Value& v)
 {
+  v.SetString(encodePort(m_port).c_str(), m_doc.GetAllocator());
+  return true;
+}
 
-  Document::AllocatorType& alloc = m_doc.GetAllocator();
-  rapidjson::Value v;
+bool PrfIoJson::encodeInputField(rapidjson::Value& v)
+{
+  v = getInput(m_port, m_bit);
+  return true;
+}
 
+std::string PrfIoJson::encodeResponse(const std::string& errStr)
+{
   addResponseJsonPrio1Params(*this);
   addResponseJsonPrio2Params(*this);
 
   switch (getCmd()) {
 
   case PrfIo::Cmd::DIRECTION:
-  {
-    v.SetString(encodePort(m_port).c_str(), alloc);
-    m_doc.AddMember(PORT_STR, v, alloc);
-
-    v = m_bit;
-    m_doc.AddMember(BIT_STR, v, alloc);
-
-    v = m_val;
-    m_doc.AddMember(DIR_STR, v, alloc);
-  }
-  break;
+    encodeJsonFields(*this, DIRECTION_FIELDS, *this);
+    break;
 
   case PrfIo::Cmd::SET:
-  {
-    v.SetString(encodePort(m_port).c_str(), alloc);
-    m_doc.AddMember(PORT_STR, v, alloc);
-
-    v = m_bit;
-    m_doc.AddMember(BIT_STR, v, alloc);
-
-    v = m_val;
-    m_doc.AddMember(VAL_STR, v, alloc);
-  }
-  break;
+    encodeJsonFields(*this, SET_FIELDS, *this);
+    break;
 
   case PrfIo::Cmd::GET:
-  {
-    v.SetString(encodePort(m_port).c_str(), alloc);
-    m_doc.AddMember(PORT_STR, v, alloc);
-
-    v = m_bit;
-    m_doc.AddMember(BIT_STR, v, alloc);
-
-    v = getInput(m_port, m_bit);
-    m_doc.AddMember(VAL_STR, v, alloc);
-  }
-  break;
+    encodeJsonFields(*this, GET_FIELDS, *this);
+    break;
 
   default:
     ;
@@ -771,21 +1239,57 @@ std::string PrfOsJson::encodeResponse(const std::string& errStr)
   return encodeResponseJsonFinal(*this);
 }
 
+///////////////////////////////////////////
+JsonSchema::JsonSchema(const char* schema)
+{
+  m_doc.Parse(schema);
+  if (m_doc.HasParseError()) {
+    THROW_EX(std::logic_error, "Json parse error: " << NAME_PAR(emsg, m_doc.GetParseError()) <<
+      NAME_PAR(eoffset, m_doc.GetErrorOffset()));
+  }
+  m_schema.reset(ant_new rapidjson::SchemaDocument(m_doc));
+}
+
+bool JsonSchema::validate(const rapidjson::Value& val, std::string& error, RequestError& info) const
+{
+  rapidjson::SchemaValidator validator(*m_schema);
+  if (!val.Accept(validator)) {
+    error = describe(validator, info);
+    return false;
+  }
+  return true;
+}
+
 ///////////////////////////////////////////
 JsonSerializer::JsonSerializer()
   :m_name("Json")
 {
-  init();
+  init(false);
 }
 
 JsonSerializer::JsonSerializer(const std::string& name)
   : m_name(name)
 {
-  init();
+  init(false);
 }
 
-void JsonSerializer::init()
+JsonSerializer::JsonSerializer(const std::string& name, bool rawBinary)
+  : m_name(name)
+{
+  init(rawBinary);
+}
+
+void JsonSerializer::init(bool rawBinary)
 {
+  //schemas are compiled once
+  const char* data = rawBinary ? schemas::RAW_DATA : schemas::HEX_DATA;
+  m_requestSchema.reset(ant_new JsonSchema(schemas::request(data).c_str()));
+  m_confSchema.reset(ant_new JsonSchema(schemas::CONF));
+  m_typeSchemas.insert(DpaRaw::PRF_NAME, std::unique_ptr<JsonSchema>(ant_new JsonSchema(schemas::RAW)));
+  m_typeSchemas.insert(PrfRawHdpJson::PRF_NAME, std::unique_ptr<JsonSchema>(ant_new JsonSchema(schemas::rawHdp(data).c_str())));
+  m_typeSchemas.insert(PrfFrc::PRF_NAME, std::unique_ptr<JsonSchema>(ant_new JsonSchema(schemas::frc(data).c_str())));
+  m_typeSchemas.insert(PrfIo::PRF_NAME, std::unique_ptr<JsonSchema>(ant_new JsonSchema(schemas::IO)));
+
   registerClass<PrfRawJson>(DpaRaw::PRF_NAME);
   registerClass<PrfRawHdpJson>(PrfRawHdpJson::PRF_NAME);
   registerClass<PrfThermometerJson>(PrfThermometer::PRF_NAME);
@@ -796,12 +1300,27 @@ void JsonSerializer::init()
   registerClass<PrfOsJson>(PrfOs::PRF_NAME);
 }
 
+void JsonSerializer::update(const rapidjson::Value& cfg)
+{
+  m_prettyOutput = jutils::getPossibleMemberAs<bool>("PrettyOutput", cfg, m_prettyOutput);
+  const auto fields = cfg.FindMember("ResponseFields");
+  if (fields != cfg.MemberEnd()) {
+    m_responseFields = PrfCommonJson::parseFields(fields->value);
+  }
+  TRC_INF(PAR(m_name) << PAR(m_prettyOutput) << PAR(m_responseFields));
+}
+
 std::string JsonSerializer::parseCategory(const std::string& request)
 {
   std::string ctype;
   try {
-    Document doc;
-    jutils::parseString(request, doc);
+    PooledDocument pooled;
+    Document& doc = pooled.get();
+    MessageSpan span(request);
+    RequestError info;
+    if (!parseDocument(span, doc, m_lastError, info)) {
+      return ctype;
+    }
 
     jutils::assertIsObject("", doc);
     ctype = jutils::getMemberAs<std::string>("ctype", doc);
@@ -816,13 +1335,16 @@ std::unique_ptr<DpaTask> JsonSerializer::parseRequest(const std::string& request
 {
   std::unique_ptr<DpaTask> obj;
   try {
-    Document doc;
-    jutils::parseString(request, doc);
+    PooledDocument pooled;
+    Document& doc = pooled.get();
+    MessageSpan span(request);
+    RequestError info;
+    if (!parseDocument(span, doc, m_lastError, info)) {
+      return obj;
+    }
 
     jutils::assertIsObject("", doc);
-    std::string perif = jutils::getMemberAs<std::string>("type", doc);
-
-    obj = createObject(perif, doc);
+    obj = parseRequestVal(doc, m_lastError, info);
   }
   catch (std::exception &e) {
     m_lastError = e.what();
@@ -834,30 +1356,275 @@ std::string JsonSerializer::parseConfig(const std::string& request)
 {
   std::string cmd;
   try {
-    Document doc;
-    jutils::parseString(request, doc);
+    PooledDocument pooled;
+    Document& doc = pooled.get();
+    MessageSpan span(request);
+    RequestError info;
+    if (!parseDocument(span, doc, m_lastError, info)) {
+      return cmd;
+    }
 
     jutils::assertIsObject("", doc);
+    cmd = parseConfigVal(doc, m_lastError, info);
+  }
+  catch (std::exception &e) {
+    m_lastError = e.what();
+  }
+  return cmd;
+}
 
-    std::string type = jutils::getMemberAs<std::string>("type", doc);
+ParsedRequest JsonSerializer::parse(const std::string& request)
+{
+  MessageSpan span(request);
+  return parse(span);
+}
+
+ParsedRequest JsonSerializer::parse(MessageSpan& request)
+{
+  //the document is parsed once and passed to the factory,
+  //errors are returned by parsed request as more messaging threads may share the serializer
+  ParsedRequest parsed;
+  try {
+    PooledDocument pooled;
+    Document& doc = pooled.get();
+    if (!parseDocument(request, doc, parsed.m_error, parsed.m_errorInfo)) {
+      //completed document of rejected request holds msgid, else it was kept while parsing if read
+      if (parsed.m_errorInfo.m_msgid.empty()) {
+        getMsgid(doc, parsed.m_errorInfo);
+      }
+      return parsed;
+    }
 
-    if (type == "mode") {
-      cmd = jutils::getMemberAs<std::string>("cmd", doc);
+    jutils::assertIsObject("", doc);
+    parsed.m_category = jutils::getMemberAs<std::string>("ctype", doc);
+
+    if (parsed.m_category == CAT_DPA_STR) {
+      parsed.m_dpaTask = parseRequestVal(doc, parsed.m_error, parsed.m_errorInfo);
+      if (!parsed.m_dpaTask) {
+        getMsgid(doc, parsed.m_errorInfo);
+      }
+    }
+    else if (parsed.m_category == CAT_CONF_STR) {
+      parsed.m_command = parseConfigVal(doc, parsed.m_error, parsed.m_errorInfo);
+      if (parsed.m_command.empty()) {
+        getMsgid(doc, parsed.m_errorInfo);
+      }
+      if (!parsed.m_command.empty() && request.isWritable()) {
+        //the message was parsed in place, keep the request for encodeConfig()
+        parsed.m_request = writeDocument(doc);
+      }
     }
   }
   catch (std::exception &e) {
-    m_lastError = e.what();
+    parsed.m_error = e.what();
+  }
+  return parsed;
+}
+
+bool JsonSerializer::parseBatch(const std::string& request, std::vector<ParsedRequest>& items)
+{
+  MessageSpan span(request);
+  return parseBatch(span, items);
+}
+
+bool JsonSerializer::parseBatch(MessageSpan& request, std::vector<ParsedRequest>& items)
+{
+  //avoid parsing of ordinary requests
+  if (!isBatch(request)) {
+    return false;
+  }
+
+  try {
+    PooledDocument pooled;
+    Document& doc = pooled.get();
+    std::string error;
+    RequestError info;
+    if (!parseDocument(request, doc, error, info) || !doc.IsArray()) {
+      TRC_WAR("Cannot parse batch: " << PAR(error));
+      return false;
+    }
+
+    for (auto itr = doc.Begin(); itr != doc.End(); ++itr) {
+      ParsedRequest parsed;
+      try {
+        //items are validated one by one to answer each of them
+        if (!m_requestSchema->validate(*itr, parsed.m_error, parsed.m_errorInfo)) {
+          getMsgid(*itr, parsed.m_errorInfo);
+          items.push_back(std::move(parsed));
+          continue;
+        }
+        parsed.m_category = jutils::getMemberAs<std::string>("ctype", *itr);
+        if (parsed.m_category != CAT_DPA_STR) {
+          THROW_EX(std::logic_error, "Unexpected ctype in batch: " << PAR(parsed.m_category));
+        }
+        parsed.m_dpaTask = parseRequestVal(*itr, parsed.m_error, parsed.m_errorInfo);
+        if (!parsed.m_dpaTask) {
+          getMsgid(*itr, parsed.m_errorInfo);
+        }
+      }
+      catch (std::exception &e) {
+        parsed.m_error = e.what();
+      }
+      items.push_back(std::move(parsed));
+    }
+  }
+  catch (std::exception &e) {
+    CATCH_EX("Cannot parse batch: ", std::exception, e);
+    return false;
+  }
+  return true;
+}
+
+void JsonSerializer::encodeBatch(const std::vector<std::string>& responses, OutputBuffer& output)
+{
+  //items are already complete JSON documents
+  output.push_back('[');
+  for (size_t i = 0; i < responses.size(); i++) {
+    if (i > 0) {
+      output.push_back(',');
+    }
+    output.append(responses[i]);
+  }
+  output.push_back(']');
+}
+
+std::string JsonSerializer::encodeBatch(const std::vector<std::string>& responses)
+{
+  //items are already complete JSON documents
+  std::string res("[");
+  for (size_t i = 0; i < responses.size(); i++) {
+    if (i > 0) {
+      res += ',';
+    }
+    res += responses[i];
+  }
+  res += ']';
+  return res;
+}
+
+std::string JsonSerializer::encodeBatchError(const ParsedRequest& parsed)
+{
+  Document doc;
+  buildError(parsed, doc);
+  return writeDocument(doc);
+}
+
+void JsonSerializer::encodeError(const ParsedRequest& parsed, OutputBuffer& output)
+{
+  Document doc;
+  buildError(parsed, doc);
+  writeDocument(doc, output);
+}
+
+void JsonSerializer::buildError(const ParsedRequest& parsed, rapidjson::Document& doc) const
+{
+  //known parts of the request and the location of failed validation, e.g.
+  //{"ctype":"dpa","msgid":"1","status":"ERROR_PARSE","error":{"message":"...","keyword":"pattern","schema":"#/properties/nadr","member":"#/nadr"}}
+  doc.SetObject();
+  Document::AllocatorType& alloc = doc.GetAllocator();
+  const RequestError& info = parsed.m_errorInfo;
+  rapidjson::Value v;
+  if (!parsed.m_category.empty()) {
+    v.SetString(parsed.m_category.c_str(), alloc);
+    doc.AddMember(CTYPE_STR, v, alloc);
+  }
+  if (!info.m_msgid.empty()) {
+    v.SetString(info.m_msgid.c_str(), alloc);
+    doc.AddMember(MSGID_STR, v, alloc);
+  }
+  v.SetString("ERROR_PARSE", alloc);
+  doc.AddMember(STATUS_STR, v, alloc);
+
+  rapidjson::Value error(kObjectType);
+  v.SetString(parsed.m_error.c_str(), alloc);
+  error.AddMember("message", v, alloc);
+  if (!info.m_keyword.empty()) {
+    v.SetString(info.m_keyword.c_str(), alloc);
+    error.AddMember("keyword", v, alloc);
+    v.SetString(info.m_schema.c_str(), alloc);
+    error.AddMember("schema", v, alloc);
+    v.SetString(info.m_member.c_str(), alloc);
+    error.AddMember("member", v, alloc);
+  }
+  doc.AddMember("error", error, alloc);
+}
+
+std::unique_ptr<DpaTask> JsonSerializer::parseRequestVal(rapidjson::Value& val, std::string& error, RequestError& info)
+{
+  std::unique_ptr<DpaTask> obj;
+
+  //type is dispatched by characters of the document, it is string according request schema
+  auto found = val.FindMember(TYPE_STR);
+  if (found == val.MemberEnd() || !found->value.IsString()) {
+    error = "Missing member: " TYPE_STR;
+    return obj;
+  }
+  const char* perif = found->value.GetString();
+  size_t len = found->value.GetStringLength();
+
+  //invalid requests are rejected before the object is created
+  if (!hasClass(perif, len)) {
+    std::ostringstream os;
+    os << "Unregistered type: " << NAME_PAR(perif, std::string(perif, len));
+    error = os.str();
+    return obj;
+  }
+  auto schema = m_typeSchemas.find(perif, len);
+  if (schema && !(*schema)->validate(val, error, info)) {
+    return obj;
+  }
+
+  obj = createObject(perif, len, val);
+
+  PrfCommonJson* common = dynamic_cast<PrfCommonJson*>(obj.get());
+  if (common) {
+    initOutput(*common);
+    //decoded according the format set by initOutput()
+    common->parseBinaryMembers();
+    if (!common->m_has_fields) {
+      common->m_fields = m_responseFields;
+    }
+  }
+  return obj;
+}
+
+std::string JsonSerializer::parseConfigVal(const rapidjson::Value& val, std::string& error, RequestError& info)
+{
+  std::string cmd;
+  if (!m_confSchema->validate(val, error, info)) {
+    return cmd;
+  }
+
+  std::string type = jutils::getMemberAs<std::string>("type", val);
+
+  if (type == "mode") {
+    cmd = jutils::getMemberAs<std::string>("cmd", val);
+  }
+  else {
+    error = "Unexpected configuration type: " + type;
   }
   return cmd;
 }
 
 std::string JsonSerializer::encodeConfig(const std::string& request, const std::string& response)
 {
-  std::string res;
-  try {
-    Document doc;
+  OutputBuffer output;
+  encodeConfig(request, response, output);
+  return output.str();
+}
 
-    jutils::parseString(request, doc);
+void JsonSerializer::encodeConfig(const std::string& request, const std::string& response, OutputBuffer& output)
+{
+  try {
+    PooledDocument pooled;
+    Document& doc = pooled.get();
+    MessageSpan span(request);
+    std::string error;
+    RequestError info;
+    if (!parseDocument(span, doc, error, info)) {
+      TRC_WAR("Cannot encode config: " << PAR(error));
+      return;
+    }
     jutils::assertIsObject("", doc);
 
     Document::AllocatorType& alloc = doc.GetAllocator();
@@ -865,15 +1632,86 @@ std::string JsonSerializer::encodeConfig(const std::string& request, const std::
     v.SetString(response.c_str(), alloc);
     doc.AddMember("status", v, alloc);
   
-    StringBuffer buffer;
-    PrettyWriter<StringBuffer> writer(buffer);
-    doc.Accept(writer);
-    res = buffer.GetString();
+    writeDocument(doc, output);
   }
   catch (std::exception &e) {
-    m_lastError = e.what();
+    CATCH_EX("Cannot encode config: ", std::exception, e);
   }
-  return res;
+}
+
+bool JsonSerializer::parseDocument(MessageSpan& request, rapidjson::Document& doc, std::string& error, RequestError& info) const
+{
+  //other formats are rejected before any copying or parsing
+  size_t first = firstNonSpace(request);
+  if (first == request.size() || (request[first] != '{' && request[first] != '[')) {
+    std::ostringstream os;
+    os << "Json parse error: " << NAME_PAR(emsg, kParseErrorValueInvalid) << NAME_PAR(eoffset, first);
+    error = os.str();
+    return false;
+  }
+
+  //handed over buffer is parsed in place, other message is copied to the buffer reused by the calling thread,
+  //so strings of the document are not allocated but they point to the buffer
+  char* begin = request.writable();
+  if (!begin) {
+    static thread_local std::vector<char> buffer;
+    buffer.assign(request.chars(), request.chars() + request.size());
+    begin = buffer.data();
+  }
+  SpanInsituStream is(begin, request.size());
+
+  ParseResult result;
+  if (request[first] == '[') {
+    //items are validated one by one
+    doc.ParseStream<kParseInsituFlag>(is);
+    result = doc;
+  }
+  else {
+    //validated while parsed, invalid request stops parsing
+    SchemaValidatingReader<kParseInsituFlag, SpanInsituStream, UTF8<>> reader(is, m_requestSchema->get());
+    auto generator = [&](Document& d) {
+      MsgidHandler handler(d, info.m_msgid);
+      return reader(handler);
+    };
+    doc.Populate(generator);
+    if (!reader.IsValid()) {
+      error = JsonSchema::describe(reader, info);
+      return false;
+    }
+    result = reader.GetParseResult();
+  }
+
+  if (result.IsError()) {
+    std::ostringstream os;
+    os << "Json parse error: " << NAME_PAR(emsg, result.Code()) << NAME_PAR(eoffset, result.Offset());
+    error = os.str();
+    return false;
+  }
+  return true;
+}
+
+void JsonSerializer::writeDocument(const rapidjson::Value& val, OutputBuffer& output) const
+{
+  writeJson(val, m_prettyOutput, output);
+}
+
+std::string JsonSerializer::writeDocument(const rapidjson::Value& val) const
+{
+  OutputBuffer output;
+  writeDocument(val, output);
+  return output.str();
+}
+
+bool JsonSerializer::isBatch(const MessageSpan& request) const
+{
+  //batch is JSON array
+  size_t first = firstNonSpace(request);
+  return first != request.size() && request[first] == '[';
+}
+
+void JsonSerializer::initOutput(PrfCommonJson& common) const
+{
+  common.m_prettyOutput = m_prettyOutput;
 }
 
 std::string JsonSerializer::getLastError() const
@@ -882,23 +1720,34 @@ std::string JsonSerializer::getLastError() const
 }
 
 std::string JsonSerializer::encodeAsyncAsDpaRaw(const DpaMessage& dpaMessage) const
+{
+  OutputBuffer output;
+  encodeAsyncAsDpaRaw(dpaMessage, output);
+  return output.str();
+}
+
+void JsonSerializer::encodeAsyncAsDpaRaw(const DpaMessage& dpaMessage, OutputBuffer& output) const
 {
   PrfRawJson raw(dpaMessage);
   raw.m_dotNotation = true;
+  initOutput(raw);
+  raw.m_output = &output;
   std::string status;
   switch (dpaMessage.MessageDirection()) {
   case DpaMessage::MessageType::kRequest:
     raw.m_has_request = true;
     raw.m_has_response = false;
     status = "ASYNC_REQUEST";
-    return raw.encodeAsyncRequest(status);
+    raw.encodeAsyncRequest(status);
+    return;
   case DpaMessage::MessageType::kResponse:
     raw.m_has_request = false;
     raw.m_has_response = true;
     status = "ASYNC_RESPONSE";
-    return raw.encodeResponse(status);
+    raw.encodeResponse(status);
+    return;
   default:
     status = "ASYNC_MESSAGE";
   }
-  return raw.encodeResponse(status);
+  raw.encodeResponse(status);
 }
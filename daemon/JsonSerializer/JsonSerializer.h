@@ -30,21 +30,198 @@
 #include "rapidjson/istreamwrapper.h"
 #include "rapidjson/stringbuffer.h"
 #include "rapidjson/prettywriter.h"
+#include "rapidjson/schema.h"
 #include <algorithm>
 #include <memory>
+#include <sstream>
 #include <string>
 
+/// \brief Encoding of JSON member described by JsonField
+enum class JsonFieldEncoding : uint8_t
+{
+  Echo,               ///< value parsed from request
+  EchoResponded,      ///< value parsed from request, empty if DPA response was not received
+  ResponseCode,       ///< hexa response code of DPA response
+  DpaValue,           ///< hexa DPA value of DPA response
+  ResponseData,       ///< hexa data of DPA response
+  RequestPacket,      ///< hexa DPA request
+  ConfirmationPacket, ///< hexa DPA confirmation
+  ResponsePacket,     ///< hexa DPA response
+  RequestTs,          ///< timestamp of DPA request
+  ConfirmationTs,     ///< timestamp of DPA confirmation
+  ResponseTs,         ///< timestamp of DPA response
+  Enum,               ///< integer value encoded by its name from JsonField::names
+  Callback            ///< value computed by JsonField::encoder, the member is omitted if it returns false
+};
+
+/// \brief Handling of JSON member described by JsonField
+enum JsonFieldFlags : uint8_t
+{
+  JSON_FIELD_PARSE = 0x01,    ///< parsed from request
+  JSON_FIELD_ENCODE = 0x02,   ///< encoded in response
+  JSON_FIELD_BOTH = 0x03,
+  JSON_FIELD_BINARY = 0x04    ///< binary data, hexadecimal text or raw bytes according PrfCommonJson::m_rawBinary
+};
+
+/// \struct JsonEnum
+/// \brief Name of enumerated value of JSON member
+/// \details
+/// Tables of names are terminated by nullptr name.
+struct JsonEnum
+{
+  const char* name;  ///< name in JSON
+  int value;         ///< enumerated value
+};
+
+/// \struct JsonField
+/// \brief Descriptor of JSON member of object T
+/// \details
+/// Peripheral classes describe their members by constant tables of descriptors. Members are parsed and encoded
+/// by PrfCommonJson::parseJsonFields() and PrfCommonJson::encodeJsonFields() driven by the tables.
+/// Use macro JSON_FIELD_NAME to set name and its length.
+/// Enumerated members are integers with names, values computed from DPA response are set by encoder callback.
+/// Trailing pointers may be omitted in tables, they are nullptr then.
+template<typename T>
+struct JsonField
+{
+  const char* name;            ///< member name
+  rapidjson::SizeType length;  ///< length of member name
+  bool T::* has;               ///< presence of member, nullptr if the member is mandatory
+  std::string T::* str;        ///< string value, nullptr if the value is not string
+  int T::* num;                ///< integer value, nullptr if the value is not integer
+  uint32_t fields;             ///< group of PrfCommonJson::Fields selecting the member in response, 0 for always
+  JsonFieldEncoding encoding;  ///< encoding of the value in response
+  uint8_t flags;               ///< JsonFieldFlags
+  bool T::* boolean;           ///< boolean value, nullptr if the value is not boolean
+  const JsonEnum* names;       ///< names of integer value parsed and encoded as string, nullptr if not enumerated
+  bool (T::* encoder)(rapidjson::Value& val);  ///< sets value of JsonFieldEncoding::Callback, nullptr otherwise
+};
+
+/// name and its length of JsonField taken from string literal
+#define JSON_FIELD_NAME(name) name, (rapidjson::SizeType)(sizeof(name) - 1)
+
 /// \class PrfCommonJson
 /// \brief Implements common features of JsonDpaMessage
 /// \details
 /// Common functions as parsing and encoding common items of JSON coded DPA messages
-class PrfCommonJson
+class PrfCommonJson : public DpaRequestOptions, public DpaResponseOutput
 {
+public:
+  /// \brief Groups of response members
+  /// \details
+  /// A request may select the groups encoded in its response by member "fields", e.g. ["data", "status"].
+  /// Members of other groups are not generated at all. Member msgid is always encoded to correlate the response.
+  enum Fields : uint32_t
+  {
+    FIELDS_HEADER = 0x01,     ///< "header": echoed parameters as ctype, type, nadr, hwpid, cmd and type specific ones
+    FIELDS_TIMESTAMPS = 0x02, ///< "timestamps": request_ts, confirmation_ts, response_ts
+    FIELDS_RAW = 0x04,        ///< "raw": request, confirmation, response, rcode, dpaval
+    FIELDS_DATA = 0x08,       ///< "data": decoded data as temperature, frc_data, rdata
+    FIELDS_STATUS = 0x10,     ///< "status": status
+    FIELDS_ALL = 0x1F
+  };
+
+  /// \brief Parse names of field groups
+  /// \param [in] names JSON array of group names
+  /// \return mask of Fields
+  /// \throws std::logic_error in case of unknown name
+  static uint32_t parseFields(const rapidjson::Value& names);
+
+  /// size of arena chunk embedded in the object for values and strings of its JSON document
+  static const size_t ARENA_CHUNK_SIZE = 2048;
+
+  /// \brief Allocate object from pool of reusable request blocks
+  /// \param [in] size size of object
+  /// \return allocated memory
+  /// \details
+  /// The object including its embedded arena chunk takes one block. Blocks are reused for next requests,
+  /// objects bigger than the block are allocated from heap.
+  static void* operator new(size_t size);
+
+  /// \brief Return object memory to pool of reusable request blocks
+  /// \param [in] ptr memory of object
+  /// \param [in] size size of object
+  static void operator delete(void* ptr, size_t size);
+
+  /// \brief DpaResponseOutput overriden method
+  /// \param [in] errStr result of DpaTask handling in IQRF mesh to be stored in message
+  /// \param [out] output buffer the encoded message is appended to
+  /// \details
+  /// Invokes DpaTask::encodeResponse() of the object, its final document is written to the buffer.
+  void encodeResponseTo(const std::string& errStr, OutputBuffer& output) override;
+
 protected:
 
   PrfCommonJson();
   PrfCommonJson(const PrfCommonJson& o);
 
+  /// common members of request and response in the order of encoding
+  static const JsonField<PrfCommonJson> PRIO1_FIELDS[6];
+  static const JsonField<PrfCommonJson> PRIO2_FIELDS[2];
+  static const JsonField<PrfCommonJson> FINAL_FIELDS[10];
+
+  /// \brief Parse members described by table
+  /// \param [in,out] obj object holding the members
+  /// \param [in] table descriptors of the members
+  /// \param [in] val JSON structure to be parsed
+  /// \throws std::logic_error in case of missing mandatory member or unexpected type
+  template<typename T, size_t N>
+  void parseJsonFields(T& obj, const JsonField<T>(&table)[N], const rapidjson::Value& val)
+  {
+    for (const JsonField<T>& field : table) {
+      if (field.flags & JSON_FIELD_PARSE) {
+        bool has = parseJsonField(val, field.name, field.length, field.has == nullptr,
+          field.str ? &(obj.*field.str) : nullptr, field.num ? &(obj.*field.num) : nullptr,
+          field.boolean ? &(obj.*field.boolean) : nullptr, field.names);
+        if (field.has) {
+          obj.*field.has = has;
+        }
+      }
+    }
+  }
+
+  /// \brief Encode members described by table to response document
+  /// \param [in,out] obj object holding the members
+  /// \param [in] table descriptors of the members
+  /// \param [in] dpaTask handled task providing values of DPA packets
+  template<typename T, size_t N>
+  void encodeJsonFields(T& obj, const JsonField<T>(&table)[N], const DpaTask& dpaTask)
+  {
+    for (const JsonField<T>& field : table) {
+      if ((field.flags & JSON_FIELD_ENCODE) && (!field.has || obj.*field.has) &&
+        (!field.fields || (m_fields & field.fields))) {
+        if (field.encoding == JsonFieldEncoding::Callback) {
+          rapidjson::Value v;
+          if ((obj.*field.encoder)(v)) {
+            if (field.flags & JSON_FIELD_BINARY) {
+              markBinaryMember();
+            }
+            m_doc.AddMember(rapidjson::StringRef(field.name, field.length), v, m_doc.GetAllocator());
+          }
+        }
+        else {
+          if (field.flags & JSON_FIELD_BINARY) {
+            markBinaryMember();
+          }
+          encodeJsonField(field.name, field.length, field.str ? &(obj.*field.str) : nullptr,
+            field.num ? &(obj.*field.num) : nullptr, field.boolean ? &(obj.*field.boolean) : nullptr,
+            field.names, field.encoding, dpaTask);
+        }
+      }
+    }
+  }
+
+  /// \brief Mark the member added next to the response document as binary
+  /// \details
+  /// Writers of binary formats write string values of marked members as raw bytes.
+  void markBinaryMember()
+  {
+    rapidjson::SizeType index = m_doc.MemberCount();
+    if (m_rawBinary && index < 64) {
+      m_binaryMembers |= (uint64_t)1 << index;
+    }
+  }
+
   /// \brief Parse common items
   /// \param [in] val JSON structure to be parsed
   /// \param [out] dpaTask reference to be set according parsed data
@@ -64,18 +241,51 @@ protected:
   /// Gets DPA request common members to be stored in the middle of JSON message
   void addResponseJsonPrio2Params(const DpaTask& dpaTask);
 
+  /// \brief Parse member
+  /// \param [in] val JSON structure to be parsed
+  /// \param [in] name member name
+  /// \param [in] length length of member name
+  /// \param [in] mandatory member has to exist
+  /// \param [out] str string value to be set or nullptr
+  /// \param [out] num integer value to be set or nullptr
+  /// \param [out] boolean boolean value to be set or nullptr
+  /// \param [in] names names of enumerated integer value or nullptr
+  /// \return true if the member exists
+  /// \throws std::logic_error in case of missing mandatory member, unexpected type or unknown name
+  bool parseJsonField(const rapidjson::Value& val, const char* name, rapidjson::SizeType length, bool mandatory,
+    std::string* str, int* num, bool* boolean, const JsonEnum* names);
+
+  /// \brief Encode member to response document
+  /// \param [in] name member name, it is referenced by the document
+  /// \param [in] length length of member name
+  /// \param [in,out] str string value or nullptr, set according encoding
+  /// \param [in] num integer value or nullptr
+  /// \param [in] boolean boolean value or nullptr
+  /// \param [in] names names of enumerated integer value or nullptr
+  /// \param [in] encoding encoding of the value
+  /// \param [in] dpaTask handled task providing values of DPA packets
+  void encodeJsonField(const char* name, rapidjson::SizeType length, std::string* str, const int* num,
+    const bool* boolean, const JsonEnum* names, JsonFieldEncoding encoding, const DpaTask& dpaTask);
+
   /// \brief Encode final members of JSON and return it
   /// \param [in] dpaTask reference to be encoded
-  /// \return complete JSON encoded message
+  /// \return complete JSON encoded message, empty if written to output buffer
   /// \details
-  /// Gets DPA request common parameters to be stored at the end of JSON message and return complete JSON
+  /// Gets DPA request common parameters to be stored at the end of JSON message and return complete JSON.
+  /// If invoked via encodeResponseTo() the message is written to its output buffer.
   std::string encodeResponseJsonFinal(const DpaTask& dpaTask);
 
 public:
 
+  /// \brief Decode binary members of request
+  /// \details
+  /// Called by the serializer when the object is created and its format is set, so binary members are decoded
+  /// either from hexadecimal text or from raw bytes according m_rawBinary.
+  virtual void parseBinaryMembers() {}
+
   /// \brief Parse binary data encoded hexa
   /// \param [out] to buffer for result binary data
-  /// \param [in] from hexadecimal string
+  /// \param [in] from hexadecimal string or raw bytes if m_rawBinary is set
   /// \param [in] maxlen maximal length of binary data
   /// \return length of result
   /// \details
@@ -112,7 +322,7 @@ public:
   void encodeHexaNum(std::string& to, uint16_t from);
 
   /// \brief Encode binary data to hexa string
-  /// \param [out] to result string
+  /// \param [out] to result string, raw bytes if m_rawBinary is set
   /// \param [in] from data to be encoded
   /// \param [in] len length of dat to be encoded
   /// \details
@@ -125,12 +335,18 @@ public:
   /// \param [in] from timestamp to be encoded
   void encodeTimestamp(std::string& to, std::chrono::time_point<std::chrono::system_clock> from);
 
+  /// \brief Check if group of members is to be encoded in response
+  /// \param [in] fields group of members
+  /// \return true if selected
+  bool hasFields(Fields fields) const { return (m_fields & fields) != 0; }
+
   /// various flags to store presence of members of DPA request to be used in DPA response
   bool m_has_ctype = false;
   bool m_has_type = false;
   bool m_has_nadr = false;
   bool m_has_hwpid = false;
   bool m_has_timeout = false;
+  bool m_has_retries = false;
   bool m_has_msgid = false;
   bool m_has_request = false;
   bool m_has_request_ts = false;
@@ -142,6 +358,7 @@ public:
   bool m_has_rcode = false;
   bool m_has_rdata = false;
   bool m_has_dpaval = false;
+  bool m_has_fields = false;
 
   /// various flags to store members of DPA request to be used in DPA response
   std::string m_ctype;
@@ -162,9 +379,28 @@ public:
   std::string m_rdataJ;
   std::string m_dpavalJ;
 
+  /// request arena, the document allocates values and strings from the chunk and releases them at once
+  alignas(8) char m_arenaChunk[ARENA_CHUNK_SIZE];
+  rapidjson::MemoryPoolAllocator<> m_arenaAllocator;
   rapidjson::Document m_doc;
 
   bool m_dotNotation = true;
+  bool m_prettyOutput = false;
+
+  /// binary members hold raw bytes instead of hexadecimal text, set by serializers of binary formats
+  bool m_rawBinary = false;
+  /// bits of members of response document holding raw bytes by order of the members, see markBinaryMember()
+  uint64_t m_binaryMembers = 0;
+
+  /// mask of Fields to be encoded in response
+  uint32_t m_fields = FIELDS_ALL;
+
+  /// writer of encoded document and its binary members, JSON text if not set
+  typedef void(*DocumentWriter)(const rapidjson::Value& doc, uint64_t binaryMembers, OutputBuffer& output);
+  DocumentWriter m_documentWriter = nullptr;
+
+  /// buffer of messaging the response is written to, set just during encodeResponseTo()
+  OutputBuffer* m_output = nullptr;
 };
 
 /// \class PrfRawJson
@@ -195,6 +431,9 @@ public:
   /// \param [in] errStr result of DpaTask handling in IQRF mesh - asynchronous
   /// \return encoded message
   std::string encodeAsyncRequest(const std::string& errStr);
+
+  /// \brief PrfCommonJson overriden method
+  void parseBinaryMembers() override;
 private:
 };
 
@@ -219,10 +458,17 @@ public:
   /// \param [in] errStr result of DpaTask handling in IQRF mesh to be stored in message
   /// \return encoded message
   std::string encodeResponse(const std::string& errStr) override;
+
+  /// \brief PrfCommonJson overriden method
+  void parseBinaryMembers() override;
 private:
+  /// members of DPA header
+  static const JsonField<PrfRawHdpJson> HDP_FIELDS[4];
+
   /// parsed DPA header items
   std::string m_pnum;
   std::string m_pcmd;
+  bool m_has_data = false;
   std::string m_data;
 
 };
@@ -245,6 +491,12 @@ public:
   /// \param [in] errStr result of DpaTask handling in IQRF mesh to be stored in message
   /// \return encoded message
   std::string encodeResponse(const std::string& errStr) override;
+private:
+  /// members of response
+  static const JsonField<PrfThermometerJson> THERMOMETER_FIELDS[1];
+
+  /// encoder of read temperature
+  bool encodeTemperature(rapidjson::Value& v);
 };
 
 /// \class PrfFrcJson
@@ -256,6 +508,16 @@ public:
 class PrfFrcJson : public PrfFrc, public PrfCommonJson
 {
 public:
+  /// \brief Format of FRC data in response selected by "frc_data_format"
+  enum class FrcDataFormat {
+    /// "hex": hexadecimal string of values of all nodes, default
+    Hex,
+    /// "array": array of decoded values of all nodes starting by node 1
+    Array,
+    /// "nodes": object of decoded values keyed by address of responded nodes
+    Nodes
+  };
+
   /// \brief parametric constructor
   /// \param [in] val JSON to be parsed
   explicit PrfFrcJson(const rapidjson::Value& val);
@@ -265,9 +527,45 @@ public:
   /// \param [in] errStr result of DpaTask handling in IQRF mesh to be stored in message
   /// \return encoded message
   std::string encodeResponse(const std::string& errStr) override;
+
+  /// \brief PrfCommonJson overriden method
+  void parseBinaryMembers() override;
 private:
+  /// \brief Get decoded FRC value of node according FRC type
+  /// \param [in] node node address
+  /// \return value, zero if the node did not respond
+  uint16_t getFrcValue(int node) const;
+
+  /// \brief Get number of nodes with FRC value according FRC type
+  /// \return number of nodes
+  int getFrcNodes() const;
+
+  /// \brief Encode FRC data to document value according required format
+  /// \param [out] v encoded value
+  /// \return true
+  bool encodeFrcData(rapidjson::Value& v);
+
+  /// encoders of FRC command echoed from parsed values
+  bool encodeFrcCmdField(rapidjson::Value& v);
+  bool encodeFrcTypeField(rapidjson::Value& v);
+  bool encodeFrcUserField(rapidjson::Value& v);
+
+  /// members of request and response
+  static const JsonField<PrfFrcJson> FRC_FIELDS[6];
+  /// names of FrcDataFormat
+  static const JsonEnum FRC_DATA_FORMATS[4];
+
   bool m_predefinedFrcCommand = false;
+  std::string m_frcCmdJ;
+  bool m_has_frcType = false;
+  std::string m_frcTypeJ;
+  bool m_has_frcUser = false;
+  int m_frcUserJ = 0;
+  bool m_has_userData = false;
   std::string m_userData;
+  bool m_has_frcDataFormat = false;
+  int m_frcDataFormatJ = (int)FrcDataFormat::Hex;
+  FrcDataFormat m_frcDataFormat = FrcDataFormat::Hex;
 };
 
 /// \class PrfIoJson
@@ -289,9 +587,20 @@ public:
   /// \return encoded message
   std::string encodeResponse(const std::string& errStr) override;
 private:
+  /// members of request and response according command
+  static const JsonField<PrfIoJson> DIRECTION_FIELDS[3];
+  static const JsonField<PrfIoJson> SET_FIELDS[3];
+  static const JsonField<PrfIoJson> GET_FIELDS[3];
+
+  /// encoder of port name
+  bool encodePortField(rapidjson::Value& v);
+  /// encoder of read input value
+  bool encodeInputField(rapidjson::Value& v);
+
   Port m_port;
-  uint8_t m_bit;
-  bool m_val;
+  std::string m_portJ;
+  int m_bit = 0;
+  bool m_val = false;
 };
 
 /// \class PrfOsJson
@@ -338,21 +647,34 @@ public:
   /// \return encoded message
   std::string encodeResponse(const std::string& errStr) override
   {
-    rapidjson::Value v;
-
     addResponseJsonPrio1Params(*this);
     addResponseJsonPrio2Params(*this);
-
-    int ls = L::getLedState();
-    if (ls >= 0) {
-      v.SetString((ls ? "on" : "off"), m_doc.GetAllocator());
-      m_doc.AddMember("led_state", v, m_doc.GetAllocator());
-    }
+    encodeJsonFields(*this, LED_FIELDS, *this);
 
     m_statusJ = errStr;
     return encodeResponseJsonFinal(*this);
   }
 
+private:
+  /// members of response
+  static const JsonField<PrfLedJson> LED_FIELDS[1];
+
+  /// encoder of LED state, omitted if unknown
+  bool encodeLedState(rapidjson::Value& v)
+  {
+    int ls = L::getLedState();
+    if (ls < 0) {
+      return false;
+    }
+    v.SetString(rapidjson::StringRef(ls ? "on" : "off"));
+    return true;
+  }
+};
+
+template <typename L>
+const JsonField<PrfLedJson<L>> PrfLedJson<L>::LED_FIELDS[1] = {
+  { JSON_FIELD_NAME("led_state"), nullptr, nullptr, nullptr,
+    0, JsonFieldEncoding::Callback, JSON_FIELD_ENCODE, nullptr, nullptr, &PrfLedJson<L>::encodeLedState },
 };
 
 /// Type for embedded Green LED
@@ -361,10 +683,65 @@ typedef PrfLedJson<PrfLedG> PrfLedGJson;
 /// Type for embedded Red LED
 typedef PrfLedJson<PrfLedR> PrfLedRJson;
 
+/// \class JsonSchema
+/// \brief JSON schema compiled from its text
+class JsonSchema
+{
+public:
+  /// \brief parametric constructor
+  /// \param [in] schema schema text
+  /// \throws std::logic_error in case of malformed schema
+  explicit JsonSchema(const char* schema);
+
+  /// \brief Get compiled schema
+  /// \return compiled schema
+  const rapidjson::SchemaDocument& get() const { return *m_schema; }
+
+  /// \brief Validate value
+  /// \param [in] val value to be validated
+  /// \param [out] error description of failed validation
+  /// \param [out] info location of failed validation
+  /// \return true if valid else false
+  bool validate(const rapidjson::Value& val, std::string& error, RequestError& info) const;
+
+  /// \brief Describe failed validation
+  /// \param [in] validator schema validator or validating reader
+  /// \param [out] info failed keyword, its schema location and location of invalid member
+  /// \return description of failed validation
+  template<typename V>
+  static std::string describe(const V& validator, RequestError& info)
+  {
+    rapidjson::StringBuffer schemaPtr;
+    rapidjson::StringBuffer memberPtr;
+    validator.GetInvalidSchemaPointer().StringifyUriFragment(schemaPtr);
+    validator.GetInvalidDocumentPointer().StringifyUriFragment(memberPtr);
+    info.m_keyword = validator.GetInvalidSchemaKeyword();
+    info.m_schema = schemaPtr.GetString();
+    info.m_member = memberPtr.GetString();
+
+    std::ostringstream os;
+    os << "Invalid request: " << NAME_PAR(keyword, info.m_keyword) <<
+      NAME_PAR(schema, info.m_schema) << NAME_PAR(member, info.m_member);
+    return os.str();
+  }
+
+private:
+  rapidjson::Document m_doc;
+  std::unique_ptr<rapidjson::SchemaDocument> m_schema;
+};
+
 /// \class JsonSerializer
 /// \brief Object factory to create DpaTask objects from incoming messages
 /// \details
 /// Uses inherited ObjectFactory features to create DpaTask object from incoming JSON messages.
+///
+/// Configurable via its update() method accepting JSON properties:
+/// ```json
+/// "Properties": {
+///   "PrettyOutput": false    #pretty formatted responses for debugging, compact if false
+///   "ResponseFields": ["header", "timestamps", "raw", "data", "status"]    #groups of response members if not selected by request
+/// }
+/// ```
 class JsonSerializer : public ObjectFactory<DpaTask, rapidjson::Value>, public ISerializer
 {
 public:
@@ -379,15 +756,93 @@ public:
   const std::string& getName() const override { return m_name; }
 
   /// ISerializer overriden methods
+  void update(const rapidjson::Value& cfg) override;
   std::string parseCategory(const std::string& request) override;
   std::unique_ptr<DpaTask> parseRequest(const std::string& request) override;
   std::string parseConfig(const std::string& request) override;
   std::string encodeConfig(const std::string& request, const std::string& response) override;
+  void encodeConfig(const std::string& request, const std::string& response, OutputBuffer& output) override;
   std::string getLastError() const override;
   std::string encodeAsyncAsDpaRaw(const DpaMessage& dpaMessage) const override;
+  void encodeAsyncAsDpaRaw(const DpaMessage& dpaMessage, OutputBuffer& output) const override;
+  ParsedRequest parse(const std::string& request) override;
+  ParsedRequest parse(MessageSpan& request) override;
+  bool parseBatch(const std::string& request, std::vector<ParsedRequest>& items) override;
+  bool parseBatch(MessageSpan& request, std::vector<ParsedRequest>& items) override;
+  std::string encodeBatch(const std::vector<std::string>& responses) override;
+  void encodeBatch(const std::vector<std::string>& responses, OutputBuffer& output) override;
+  std::string encodeBatchError(const ParsedRequest& parsed) override;
+  void encodeError(const ParsedRequest& parsed, OutputBuffer& output) override;
 
-private:
-  void init();
+protected:
+  /// \brief parametric constructor of serializers of binary formats
+  /// \param [in] name instance name
+  /// \param [in] rawBinary binary members of requests are raw bytes instead of hexadecimal text
+  JsonSerializer(const std::string& name, bool rawBinary);
+
+  /// \brief Parse incoming message to document
+  /// \param [in] request incoming message
+  /// \param [out] doc parsed document
+  /// \param [out] error description of parse or validation error
+  /// \param [out] info location of validation error, msgid of the request if the document is not completed
+  /// \return true if parsed and valid else false
+  /// \details
+  /// A request is validated against common request schema, a batch is validated by parseBatch() item by item.
+  /// Handed over buffer of the message is parsed in place, strings of the document point to it then.
+  virtual bool parseDocument(MessageSpan& request, rapidjson::Document& doc, std::string& error, RequestError& info) const;
+
+  /// \brief Write document to outgoing message
+  /// \param [in] val document to be written
+  /// \param [out] output buffer the message is appended to
+  virtual void writeDocument(const rapidjson::Value& val, OutputBuffer& output) const;
+
+  /// \brief Write document to outgoing message
+  /// \param [in] val document to be written
+  /// \return outgoing message
+  std::string writeDocument(const rapidjson::Value& val) const;
+
+  /// \brief Check if incoming message is a batch without its parsing
+  /// \param [in] request incoming message
+  /// \return true if it may be a batch
+  virtual bool isBatch(const MessageSpan& request) const;
+
+  /// \brief Set output format of created object
+  /// \param [in] common object to be set
+  virtual void initOutput(PrfCommonJson& common) const;
+
+  /// \brief Create DpaTask from parsed request
+  /// \param [in] val parsed request
+  /// \param [out] error description of error
+  /// \param [out] info location of validation error
+  /// \return created task, empty in case of error
+  std::unique_ptr<DpaTask> parseRequestVal(rapidjson::Value& val, std::string& error, RequestError& info);
+
+  /// \brief Get command of parsed configuration request
+  /// \param [in] val parsed request
+  /// \param [out] error description of error
+  /// \param [out] info location of validation error
+  /// \return command, empty in case of error
+  std::string parseConfigVal(const rapidjson::Value& val, std::string& error, RequestError& info);
+
+  /// \brief Build error document of rejected request
+  /// \param [in] parsed rejected request
+  /// \param [out] doc error document
+  void buildError(const ParsedRequest& parsed, rapidjson::Document& doc) const;
+
+  /// error of parseCategory(), parseRequest() and parseConfig(), other methods return their errors
+  /// as they may be called by more threads
   std::string m_lastError;
+  bool m_prettyOutput = false;
+
+  /// mask of PrfCommonJson::Fields encoded in responses to requests without member fields
+  uint32_t m_responseFields = PrfCommonJson::FIELDS_ALL;
+
+  /// compiled schemas of common members, configuration requests and DPA requests according type
+  std::unique_ptr<JsonSchema> m_requestSchema;
+  std::unique_ptr<JsonSchema> m_confSchema;
+  PerfectHashMap<std::unique_ptr<JsonSchema>> m_typeSchemas;
+
+private:
+  void init(bool rawBinary);
   std::string m_name;
 };
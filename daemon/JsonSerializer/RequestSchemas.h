@@ -0,0 +1,118 @@
+/**
+ * Copyright 2016-2017 MICRORISC s.r.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <string>
+
+/// JSON schemas (draft 4) of incoming requests compiled by JsonSerializer at startup.
+/// Only members parsed by JsonSerializer are constrained, other members are ignored.
+/// Schemas with binary members are composed with the schema of the data, hexadecimal text in JSON,
+/// raw bytes in binary formats.
+namespace schemas {
+
+  /// binary member as hexadecimal text
+  const char* const HEX_DATA = R"({ "type": "string", "pattern": "^[0-9a-fA-FxX. ]*$" })";
+
+  /// binary member as raw bytes
+  const char* const RAW_DATA = R"({ "type": "string" })";
+
+  /// common members of all requests, validated while the request is parsed
+  inline std::string request(const char* data)
+  {
+    return std::string(R"({
+    "type": "object",
+    "required": ["ctype", "type"],
+    "properties": {
+      "ctype": { "enum": ["dpa", "conf"] },
+      "type": { "type": "string" },
+      "nadr": { "type": "string", "pattern": "^(0[xX])?[0-9a-fA-F]{1,4}$" },
+      "hwpid": { "type": "string", "pattern": "^(0[xX])?[0-9a-fA-F]{1,4}$" },
+      "timeout": { "type": "integer" },
+      "retries": { "type": "integer" },
+      "msgid": { "type": "string" },
+      "cmd": { "type": "string" },
+      "request": )") + data + R"(,
+      "request_ts": { "type": "string" },
+      "response": { "type": "string" },
+      "response_ts": { "type": "string" },
+      "confirmation": { "type": "string" },
+      "confirmation_ts": { "type": "string" },
+      "rcode": { "type": "string" },
+      "dpaval": { "type": "string" },
+      "fields": {
+        "type": "array",
+        "items": { "enum": ["header", "timestamps", "raw", "data", "status"] }
+      }
+    }
+  })";
+  }
+
+  /// configuration request
+  const char* const CONF = R"({
+    "required": ["cmd"],
+    "properties": {
+      "ctype": { "enum": ["conf"] },
+      "type": { "enum": ["mode"] }
+    }
+  })";
+
+  /// raw DPA request
+  const char* const RAW = R"({
+    "required": ["request"]
+  })";
+
+  /// raw DPA request with separated header
+  inline std::string rawHdp(const char* data)
+  {
+    return std::string(R"({
+    "required": ["pnum", "pcmd", "hwpid"],
+    "properties": {
+      "pnum": { "type": "string", "pattern": "^(0[xX])?[0-9a-fA-F]{1,2}$" },
+      "pcmd": { "type": "string", "pattern": "^(0[xX])?[0-9a-fA-F]{1,2}$" },
+      "rdata": )") + data + R"(
+    }
+  })";
+  }
+
+  /// FRC request either predefined command or type and user command
+  inline std::string frc(const char* data)
+  {
+    return std::string(R"({
+    "anyOf": [
+      { "required": ["frc_cmd"] },
+      { "required": ["frc_type", "frc_user"] }
+    ],
+    "properties": {
+      "frc_cmd": { "type": "string" },
+      "frc_type": { "type": "string" },
+      "frc_user": { "type": "integer", "minimum": 0, "maximum": 255 },
+      "user_data": )") + data + R"(,
+      "frc_data_format": { "enum": ["hex", "array", "nodes"] }
+    }
+  })";
+  }
+
+  /// IO request
+  const char* const IO = R"({
+    "properties": {
+      "port": { "type": "string" },
+      "bit": { "type": "integer", "minimum": 0, "maximum": 7 },
+      "inp": { "type": "boolean" },
+      "val": { "type": "boolean" }
+    }
+  })";
+}
@@ -23,6 +23,8 @@
 INIT_COMPONENT(IMessaging, MqMessaging)
 
 const unsigned IQRF_MQ_BUFFER_SIZE = 64*1024;
+/// preallocated outgoing message, typical response fits it without reallocation
+const size_t IQRF_MQ_OUTPUT_CAPACITY = 512;
 
 MqMessaging::MqMessaging(const std::string& name)
   : m_mqChannel(nullptr)
@@ -88,13 +90,27 @@ void MqMessaging::sendMessage(const ustring& msg)
   m_toMqMessageQueue->pushToQueue(msg);
 }
 
+OutputBuffer MqMessaging::createOutput()
+{
+  return OutputBuffer(IQRF_MQ_OUTPUT_CAPACITY);
+}
+
+void MqMessaging::sendMessage(OutputBuffer& msg)
+{
+  TRC_DBG(FORM_HEX(msg.data(), msg.size()));
+  m_toMqMessageQueue->pushToQueue(msg.release());
+}
+
 int MqMessaging::handleMessageFromMq(const ustring& mqMessage)
 {
   TRC_DBG("==================================" << std::endl <<
     "Received from MQ: " << std::endl << FORM_HEX(mqMessage.data(), mqMessage.size()));
 
-  if (m_messageHandlerFunc)
-    m_messageHandlerFunc(mqMessage);
+  if (m_messageHandlerFunc) {
+    //the channel keeps the buffer
+    MessageSpan span(mqMessage);
+    m_messageHandlerFunc(span);
+  }
 
   return 0;
 }
@@ -53,6 +53,8 @@ public:
   void registerMessageHandler(MessageHandlerFunc hndl) override;
   void unregisterMessageHandler() override;
   void sendMessage(const ustring& msg) override;
+  OutputBuffer createOutput() override;
+  void sendMessage(OutputBuffer& msg) override;
 
 private:
   int handleMessageFromMq(const ustring& mqMessage);
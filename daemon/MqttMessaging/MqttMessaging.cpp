@@ -27,6 +27,9 @@
 
 INIT_COMPONENT(IMessaging, MqttMessaging)
 
+/// preallocated payload of outgoing message, typical response fits it without reallocation
+const size_t MQTT_OUTPUT_CAPACITY = 512;
+
 class MqttMessagingImpl {
 
 private:
@@ -242,7 +245,13 @@ public:
   }
 
   //------------------------
-  void handleMessageFromMqtt(const ustring& mqMessage)
+  void sendMessage(OutputBuffer& msg) {
+    //the payload is moved to the queue and published from there
+    m_toMqttMessageQueue->pushToQueue(msg.release());
+  }
+
+  //------------------------
+  void handleMessageFromMqtt(MessageSpan& mqMessage)
   {
     TRC_DBG("==================================" << std::endl <<
       "Received from MQTT: " << std::endl << FORM_HEX(mqMessage.data(), mqMessage.size()));
@@ -396,8 +405,13 @@ public:
   static int s_msgarrvd(void *context, char *topicName, int topicLen, MQTTAsync_message *message) {
     return ((MqttMessagingImpl*)context)->msgarrvd(topicName, topicLen, message);
   }
+  static void s_freeMessage(void* message) {
+    MQTTAsync_message* msg = (MQTTAsync_message*)message;
+    MQTTAsync_freeMessage(&msg);
+  }
   int msgarrvd(char *topicName, int topicLen, MQTTAsync_message *message) {
-    ustring msg((unsigned char*)message->payload, message->payloadlen);
+    //the payload is handed over to the handler and released with the span
+    MessageSpan msg((unsigned char*)message->payload, message->payloadlen, message, s_freeMessage);
     std::string topic;
     if (topicLen > 0)
       topic = std::string(topicName, topicLen);
@@ -412,7 +426,6 @@ public:
     }
     else if (0 == m_mqttTopicRequest.compare(topic))
       handleMessageFromMqtt(msg);
-    MQTTAsync_freeMessage(&message);
     MQTTAsync_free(topicName);
     return 1;
   }
@@ -499,6 +512,16 @@ void MqttMessaging::sendMessage(const ustring& msg)
   m_impl->sendMessage(msg);
 }
 
+OutputBuffer MqttMessaging::createOutput()
+{
+  return OutputBuffer(MQTT_OUTPUT_CAPACITY);
+}
+
+void MqttMessaging::sendMessage(OutputBuffer& msg)
+{
+  m_impl->sendMessage(msg);
+}
+
 const std::string& MqttMessaging::getName() const
 {
   return m_impl->getName();
@@ -69,6 +69,8 @@ public:
   void registerMessageHandler(MessageHandlerFunc hndl) override;
   void unregisterMessageHandler() override;
   void sendMessage(const ustring& msg) override;
+  OutputBuffer createOutput() override;
+  void sendMessage(OutputBuffer& msg) override;
 
 private:
   MqttMessagingImpl* m_impl;
@@ -17,6 +17,7 @@
 #include "Scheduler.h"
 #include "IqrfLogging.h"
 #include "PlatformDep.h"
+#include "TimestampFormatter.h"
 #include <algorithm>
 
 using namespace std::chrono;
@@ -413,15 +414,16 @@ ScheduleRecord::ScheduleRecord(const std::string& clientId, const std::string& t
   init();
 
   std::time_t tt = system_clock::to_time_t(tp);
-  struct std::tm * ptm = std::localtime(&tt);
-
-  m_vsec.push_back(ptm->tm_sec);
-  m_vmin.push_back(ptm->tm_min);
-  m_vhour.push_back(ptm->tm_hour);
-  m_vmday.push_back(ptm->tm_mday);
-  m_vmon.push_back(ptm->tm_mon);
-  m_vyear.push_back(ptm->tm_year);
-  m_vwday.push_back(ptm->tm_wday);
+  std::tm tm;
+  TimestampFormatter::localTime(tt, tm);
+
+  m_vsec.push_back(tm.tm_sec);
+  m_vmin.push_back(tm.tm_min);
+  m_vhour.push_back(tm.tm_hour);
+  m_vmday.push_back(tm.tm_mday);
+  m_vmon.push_back(tm.tm_mon);
+  m_vyear.push_back(tm.tm_year);
+  m_vwday.push_back(tm.tm_wday);
   m_task = task;
 
 }
@@ -695,19 +697,11 @@ bool ScheduleRecord::verifyTimePattern(int cval, const std::vector<int>& tvalV)
 
 std::string ScheduleRecord::asString(const std::chrono::system_clock::time_point& tp)
 {
-  // convert to system time:
-  std::time_t t = std::chrono::system_clock::to_time_t(tp);
-  std::string ts = ctime(&t);   // convert to calendar time
-  ts.resize(ts.size() - 1);       // skip trailing newline
-  return ts;
+  return TimestampFormatter::formatMicros(tp);
 }
 
 void ScheduleRecord::getTime(std::chrono::system_clock::time_point& timePoint, std::tm& timeStr)
 {
   timePoint = system_clock::now();
-  time_t tt;
-  tt = system_clock::to_time_t(timePoint);
-  std::tm* timeinfo;
-  timeinfo = localtime(&tt);
-  timeStr = *timeinfo;
+  TimestampFormatter::localTime(system_clock::to_time_t(timePoint), timeStr);
 }
@@ -17,76 +17,122 @@
 #include "LaunchUtils.h"
 #include "SimpleSerializer.h"
 #include "IqrfLogging.h"
+#include "HexCodec.h"
 #include <vector>
-#include <iterator>
 #include <array>
+#include <cstdint>
+#include <cstdio>
 
 INIT_COMPONENT(ISerializer, SimpleSerializer)
 
-std::vector<std::string> parseTokens(DpaTask& dpaTask, std::istream& istr)
+namespace {
+  inline bool isSpace(char c)
+  {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' || c == '\v';
+  }
+
+  /// \brief Get value of option "NAME=value"
+  /// \return false if the token is not the option
+  template<size_t N>
+  bool getOptionValue(const SimpleTokenizer::Token& token, const char(&name)[N], SimpleTokenizer::Token& value)
+  {
+    const size_t len = N - 1;
+    if (token.size < len || std::memcmp(token.data, name, len) != 0) {
+      return false;
+    }
+    if (token.size < len + 2 || token.data[len] != '=') {
+      std::string tokenStr = token.str();
+      THROW_EX(std::logic_error, "Parse error: " << NAME_PAR(token, tokenStr));
+    }
+    value.data = token.data + len + 1;
+    value.size = token.size - len - 1;
+    return true;
+  }
+}
+
+bool SimpleTokenizer::next(Token& token)
 {
-  std::istream_iterator<std::string> begin(istr);
-  std::istream_iterator<std::string> end;
-  std::vector<std::string> vstrings(begin, end);
-
-  std::size_t found;
-  auto it = vstrings.begin();
-  while (it != vstrings.end()) {
-    if (std::string::npos != (found = it->find("TIMEOUT"))) {
-      std::string timeoutStr = *it;
-      it = vstrings.erase(it);
-      found = timeoutStr.find_first_of('=');
-      if (std::string::npos != found && found < timeoutStr.size()-1) {
-        dpaTask.setTimeout(std::stoi(timeoutStr.substr(++found, timeoutStr.size() - 1)));
-      }
-      else {
-        THROW_EX(std::logic_error, "Parse error: " << NAME_PAR(token, timeoutStr));
-      }
+  while (m_pos < m_end && isSpace(*m_pos)) {
+    m_pos++;
+  }
+  if (m_pos == m_end) {
+    return false;
+  }
+  token.data = m_pos;
+  while (m_pos < m_end && !isSpace(*m_pos)) {
+    m_pos++;
+  }
+  token.size = m_pos - token.data;
+  return true;
+}
+
+bool SimpleTokenizer::nextParam(DpaTask& dpaTask, Token& token)
+{
+  Token value;
+  while (next(token)) {
+    if (getOptionValue(token, "TIMEOUT", value)) {
+      dpaTask.setTimeout(parseInt(value));
     }
-    else if (std::string::npos != (found = it->find("CLID"))) {
-      std::string clientIdStr = *it;
-      it = vstrings.erase(it);
-      found = clientIdStr.find_first_of('=');
-      if (std::string::npos != found && found < clientIdStr.size() - 1) {
-        dpaTask.setClid(clientIdStr.substr(++found, clientIdStr.size() - 1));
-      }
-      else {
-        THROW_EX(std::logic_error, "Parse error: " << NAME_PAR(token, clientIdStr));
-      }
+    else if (getOptionValue(token, "CLID", value)) {
+      dpaTask.setClid(value.str());
     }
-    else {
+    else if (token == "timeout") {
       // via mq: raw 01.00.06.03.ff.ff timeout 1000
-      std::string paramStr = *it;
-      if (paramStr == "timeout") {
-        it = vstrings.erase(it);
-        if (it != vstrings.end()) {
-          // timeout value
-          std::string nextParamStr = *it;
-          dpaTask.setTimeout(std::stoi(nextParamStr));
-          it = vstrings.erase(it);
-        }
-      }
-      else {
-        it++;
+      if (next(value)) {
+        dpaTask.setTimeout(parseInt(value));
       }
     }
+    else {
+      return true;
+    }
   }
+  return false;
+}
 
-  return vstrings;
+void SimpleTokenizer::finish(DpaTask& dpaTask)
+{
+  Token token;
+  while (nextParam(dpaTask, token));
+}
+
+int SimpleTokenizer::parseInt(const Token& token)
+{
+  const char* p = token.data;
+  const char* end = token.data + token.size;
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = *p++ == '-';
+  }
+
+  long long val = 0;
+  bool valid = p < end && end - p <= 10;
+  for (; valid && p < end; p++) {
+    if (*p < '0' || *p > '9') {
+      valid = false;
+    }
+    val = val * 10 + (*p - '0');
+  }
+  if (negative) {
+    val = -val;
+  }
+  if (!valid || val > INT32_MAX || val < INT32_MIN) {
+    std::string tokenStr = token.str();
+    THROW_EX(std::logic_error, "Parse error: " << NAME_PAR(token, tokenStr));
+  }
+  return (int)val;
 }
 
-void parseRequestSimple(DpaTask & dpaTask, std::vector<std::string>& tokens)
+void parseRequestSimple(DpaTask & dpaTask, SimpleTokenizer& tokenizer)
 {
-  int address = -1;
-  std::string command;
-  if (tokens.size() > 1) {
-    address = std::stoi(tokens[0]);
-    command = tokens[1];
-    dpaTask.setAddress(address);
-    dpaTask.parseCommand(command);
+  SimpleTokenizer::Token address;
+  SimpleTokenizer::Token command;
+  if (tokenizer.nextParam(dpaTask, address) && tokenizer.nextParam(dpaTask, command)) {
+    dpaTask.setAddress(SimpleTokenizer::parseInt(address));
+    dpaTask.parseCommand(command.str());
+    tokenizer.finish(dpaTask);
   }
   else {
-    THROW_EX(std::logic_error, "Parse error: " << NAME_PAR(tokensNum, tokens.size()));
+    THROW_EX(std::logic_error, "Parse error: expected address and command");
   }
 }
 
@@ -111,31 +157,24 @@ void encodeTokens(const DpaTask& dpaTask, const std::string& errStr, std::ostrea
 //00 00 06 03 ff ff  LedR 0 PULSE
 //00 00 07 03 ff ff  LedG 0 PULSE
 
-PrfRawSimple::PrfRawSimple(std::istream& istr)
+PrfRawSimple::PrfRawSimple(SimpleTokenizer& tokenizer)
   :DpaRaw()
 {
-  uint8_t bbyte;
-  int val;
-  int i = 0;
-
-  std::vector<std::string> vstrings = parseTokens(*this, istr);
-  //workaround to handle "."
-  if (vstrings.size() == 1) {
-    std::string dotbuf = vstrings[0];
-    vstrings.clear();
-    m_dotNotation = true;
-    std::replace(dotbuf.begin(), dotbuf.end(), '.', ' ');
-    std::istringstream is(dotbuf);
-    vstrings = parseTokens(*this, is);
-  }
-
-  int sz = (int)vstrings.size();
-  while (i < MAX_DPA_BUFFER && i < sz) {
-    val = std::stoi(vstrings[i], nullptr, 16);
-    m_request.DpaPacket().Buffer[i] = (uint8_t)val;
-    i++;
+  int len = 0;
+
+  //bytes separated by spaces or dots are decoded directly to the request
+  SimpleTokenizer::Token token;
+  while (tokenizer.nextParam(*this, token)) {
+    if (len < MAX_DPA_BUFFER) {
+      int n = hexcodec::decode(m_request.DpaPacket().Buffer + len, MAX_DPA_BUFFER - len, token.data, token.size);
+      if (n < 0) {
+        std::string tokenStr = token.str();
+        THROW_EX(std::logic_error, "Parse error: " << NAME_PAR(token, tokenStr));
+      }
+      len += n;
+    }
   }
-  m_request.SetLength(i);
+  m_request.SetLength(len);
 }
 
 std::string PrfRawSimple::encodeResponse(const std::string& errStr)
@@ -164,10 +203,9 @@ std::string PrfRawSimple::encodeResponse(const std::string& errStr)
 }
 
 //////////////////////////////////////////
-PrfThermometerSimple::PrfThermometerSimple(std::istream& istr)
+PrfThermometerSimple::PrfThermometerSimple(SimpleTokenizer& tokenizer)
 {
-  std::vector<std::string> v = parseTokens(*this, istr);
-  parseRequestSimple(*this, v);
+  parseRequestSimple(*this, tokenizer);
 }
 
 std::string PrfThermometerSimple::encodeResponse(const std::string& errStr)
@@ -204,10 +242,9 @@ void SimpleSerializer::init()
 
 std::string SimpleSerializer::parseCategory(const std::string& request)
 {
-  std::istringstream istr(request);
-  std::string category;
-  istr >> category;
-  if (category == CAT_CONF_STR) {
+  SimpleTokenizer tokenizer(request.data(), request.size());
+  SimpleTokenizer::Token category;
+  if (tokenizer.next(category) && category == "conf") {
     return CAT_CONF_STR;
   }
   else
@@ -215,42 +252,75 @@ std::string SimpleSerializer::parseCategory(const std::string& request)
 }
 
 std::unique_ptr<DpaTask> SimpleSerializer::parseRequest(const std::string& request)
+{
+  SimpleTokenizer tokenizer(request.data(), request.size());
+  SimpleTokenizer::Token perif;
+  tokenizer.next(perif);
+  m_lastError = "OK";
+  return parseRequest(perif, tokenizer, m_lastError);
+}
+
+std::unique_ptr<DpaTask> SimpleSerializer::parseRequest(const SimpleTokenizer::Token& perif, SimpleTokenizer& tokenizer,
+  std::string& error)
 {
   std::unique_ptr<DpaTask> obj;
   try {
-    std::istringstream istr(request);
-    std::string perif;
-    
-    istr >> perif;
-    obj = m_dpaParser.createObject(perif, istr);
-
-    m_lastError = "OK";
+    obj = m_dpaParser.createObject(perif.data, perif.size, tokenizer);
   }
   catch (std::exception &e) {
-    m_lastError = e.what();
+    error = e.what();
   }
-  return std::move(obj);
+  return obj;
 }
 
 std::string SimpleSerializer::parseConfig(const std::string& request)
 {
-  std::string cmd = "unknown";
-
-  std::istringstream istr(request);
-  std::string category;
-  istr >> category >> cmd;
-  if (category == CAT_CONF_STR) {
+  SimpleTokenizer tokenizer(request.data(), request.size());
+  SimpleTokenizer::Token category;
+  SimpleTokenizer::Token cmd;
+  tokenizer.next(category);
+  if (category == "conf") {
     m_lastError = "OK";
-    return cmd;
+    return tokenizer.next(cmd) ? cmd.str() : std::string("unknown");
   }
   else {
+    std::string categoryStr = category.str();
     std::ostringstream ostr;
-    ostr << "Unexpected: " << PAR(category);
+    ostr << "Unexpected: " << NAME_PAR(category, categoryStr);
     m_lastError = ostr.str();
     return "";
   }
 }
 
+ParsedRequest SimpleSerializer::parse(const std::string& request)
+{
+  return parse(request.data(), request.size());
+}
+
+ParsedRequest SimpleSerializer::parse(MessageSpan& request)
+{
+  return parse(request.chars(), request.size());
+}
+
+ParsedRequest SimpleSerializer::parse(const char* data, size_t size)
+{
+  ParsedRequest parsed;
+  SimpleTokenizer tokenizer(data, size);
+  SimpleTokenizer::Token first;
+  tokenizer.next(first);
+
+  if (first == "conf") {
+    SimpleTokenizer::Token cmd;
+    parsed.m_category = CAT_CONF_STR;
+    parsed.m_command = tokenizer.next(cmd) ? cmd.str() : std::string("unknown");
+  }
+  else {
+    parsed.m_category = CAT_DPA_STR;
+    parsed.m_dpaTask = parseRequest(first, tokenizer, parsed.m_error);
+  }
+  return parsed;
+}
+
 std::string SimpleSerializer::encodeConfig(const std::string& request, const std::string& response)
 {
   std::ostringstream ostr;
@@ -265,6 +335,47 @@ std::string SimpleSerializer::getLastError() const
 
 std::string SimpleSerializer::encodeAsyncAsDpaRaw(const DpaMessage& dpaMessage) const
 {
-  //TODO
-  return "";
+  OutputBuffer output;
+  encodeAsyncAsDpaRaw(dpaMessage, output);
+  return output.str();
+}
+
+void SimpleSerializer::encodeAsyncAsDpaRaw(const DpaMessage& dpaMessage, OutputBuffer& output) const
+{
+  const auto& packet = dpaMessage.DpaPacket();
+  int datalen = dpaMessage.GetLength() - (int)sizeof(TDpaIFaceHeader);
+  const uint8_t* data = packet.DpaRequestPacket_t.DpaMessage.Request.PData;
+  const char* status;
+
+  switch (dpaMessage.MessageDirection()) {
+  case DpaMessage::MessageType::kRequest:
+    status = "ASYNC_REQUEST";
+    break;
+  case DpaMessage::MessageType::kResponse:
+    datalen -= 2; //ResponseCode DpaValue
+    data = packet.DpaResponsePacket_t.DpaMessage.Response.PData;
+    status = "ASYNC_RESPONSE";
+    break;
+  default:
+    status = "ASYNC_MESSAGE";
+  }
+
+  //"async " + nadr + 3 hexa header items + data + status
+  char buf[6 + 6 + 3 + 3 + 5 + 3 * DPA_MAX_DATA_LENGTH];
+  char* p = buf;
+  std::memcpy(p, "async ", 6);
+  p += 6;
+  p += snprintf(p, 7, "%u ", (unsigned)packet.DpaRequestPacket_t.NADR);
+  p += hexcodec::encodeNum(p, (uint8_t)packet.DpaRequestPacket_t.PNUM);
+  *p++ = ' ';
+  p += hexcodec::encodeNum(p, (uint8_t)packet.DpaRequestPacket_t.PCMD);
+  *p++ = ' ';
+  p += hexcodec::encodeNum(p, (uint16_t)packet.DpaRequestPacket_t.HWPID);
+  *p++ = ' ';
+  if (datalen > 0) {
+    p += hexcodec::encode(p, data, std::min(datalen, (int)DPA_MAX_DATA_LENGTH), '.');
+    *p++ = ' ';
+  }
+  output.append(buf, p - buf);
+  output.append(status, std::strlen(status));
 }
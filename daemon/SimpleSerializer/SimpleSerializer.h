@@ -25,10 +25,76 @@
 #include <algorithm>
 #include <vector>
 #include <string>
+#include <cstring>
+
+/// \class SimpleTokenizer
+/// \brief Single pass tokenizer of simple messages
+/// \details
+/// Splits the message to tokens separated by whitespaces. Tokens refer to characters of the message,
+/// nothing is copied or allocated, numbers and hexadecimal data are parsed in place.
+/// Options "TIMEOUT=<ms>", "CLID=<id>" and "timeout <ms>" may follow the type anywhere,
+/// nextParam() applies them to DpaTask and skips them.
+class SimpleTokenizer
+{
+public:
+  /// \brief Token referring to characters of the message
+  struct Token
+  {
+    const char* data = nullptr;
+    size_t size = 0;
+
+    /// \brief Compare with string literal
+    template<size_t N>
+    bool operator==(const char(&str)[N]) const
+    {
+      return size == N - 1 && std::memcmp(data, str, size) == 0;
+    }
+
+    /// \brief Copy token to string
+    std::string str() const { return std::string(data, size); }
+  };
+
+  /// \brief parametric constructor
+  /// \param [in] data characters of the message, they have to be valid while the tokenizer is used
+  /// \param [in] size number of characters
+  SimpleTokenizer(const char* data, size_t size)
+    :m_pos(data)
+    , m_end(data + size)
+  {
+  }
+
+  /// \brief Get next token
+  /// \param [out] token next token
+  /// \return false if there is no other token
+  bool next(Token& token);
+
+  /// \brief Get next parameter
+  /// \param [in,out] dpaTask task options are applied to
+  /// \param [out] token next token other than option
+  /// \return false if there is no other parameter
+  /// \throws std::logic_error in case of malformed option
+  bool nextParam(DpaTask& dpaTask, Token& token);
+
+  /// \brief Apply options of the rest of message
+  /// \param [in,out] dpaTask task options are applied to
+  /// \throws std::logic_error in case of malformed option
+  /// \details
+  /// Parameters not used by the task are ignored.
+  void finish(DpaTask& dpaTask);
+
+  /// \brief Parse decimal integer
+  /// \param [in] token parsed token
+  /// \return integer value
+  /// \throws std::logic_error if the token is not an integer
+  static int parseInt(const Token& token);
+
+private:
+  const char* m_pos;
+  const char* m_end;
+};
 
 /// auxiliar parse/encode functions
-std::vector<std::string> parseTokens(DpaTask& dpaTask, std::istream& istr);
-void parseRequestSimple(DpaTask& dpaTask, std::vector<std::string>& tokens);
+void parseRequestSimple(DpaTask& dpaTask, SimpleTokenizer& tokenizer);
 void encodeResponseSimple(const DpaTask & dt, std::ostream& ostr);
 void encodeTokens(const DpaTask& dpaTask, const std::string& errStr, std::ostream& ostr);
 
@@ -42,8 +108,8 @@ class PrfRawSimple : public DpaRaw
 {
 public:
   /// \brief parametric constructor
-  /// \param [in] istr string stream to be parsed
-  explicit PrfRawSimple(std::istream& istr);
+  /// \param [in] tokenizer tokens of message to be parsed
+  explicit PrfRawSimple(SimpleTokenizer& tokenizer);
   virtual ~PrfRawSimple() {};
   
   /// \brief DpaTask overriden method
@@ -62,8 +128,8 @@ class PrfThermometerSimple : public PrfThermometer
 {
 public:
   /// \brief parametric constructor
-  /// \param [in] istr string stream to be parsed
-  explicit PrfThermometerSimple(std::istream& istr);
+  /// \param [in] tokenizer tokens of message to be parsed
+  explicit PrfThermometerSimple(SimpleTokenizer& tokenizer);
   virtual ~PrfThermometerSimple() {};
 
   /// \brief DpaTask overriden method
@@ -81,10 +147,9 @@ class PrfLedSimple : public L
 {
 public:
   /// \brief parametric constructor
-  /// \param [in] istr string stream to be parsed
-  explicit PrfLedSimple(std::istream& istr) {
-    std::vector<std::string> v = parseTokens(*this, istr);
-    parseRequestSimple(*this, v);
+  /// \param [in] tokenizer tokens of message to be parsed
+  explicit PrfLedSimple(SimpleTokenizer& tokenizer) {
+    parseRequestSimple(*this, tokenizer);
   }
 
   virtual ~PrfLedSimple() {}
@@ -114,6 +179,12 @@ typedef PrfLedSimple<PrfLedR> PrfLedRSimple;
 /// \brief Object factory to create DpaTask objects from incoming messages
 /// \details
 /// Uses inherited ObjectFactory features to create DpaTask object from incoming simple messages.
+///
+/// Asynchronous DPA messages are encoded as: "async <nadr> <pnum> <pcmd> <hwpid> [<data>] <status>"
+/// e.g: "async 3 20 80 ffff 01.02.03 ASYNC_RESPONSE"
+/// where nadr is decimal as addresses of simple requests, pnum, pcmd and hwpid are hexadecimal, data are dot separated
+/// hexadecimal bytes following the header (and response code and DPA value of response) and they are omitted if empty.
+/// Status is ASYNC_REQUEST, ASYNC_RESPONSE or ASYNC_MESSAGE according direction of the message.
 class SimpleSerializer : public ISerializer
 {
 public:
@@ -132,9 +203,26 @@ public:
   std::string encodeConfig(const std::string& request, const std::string& response) override;
   std::string getLastError() const override;
   std::string encodeAsyncAsDpaRaw(const DpaMessage& dpaMessage) const override;
+  void encodeAsyncAsDpaRaw(const DpaMessage& dpaMessage, OutputBuffer& output) const override;
+  ParsedRequest parse(const std::string& request) override;
+  ParsedRequest parse(MessageSpan& request) override;
 
 private:
-  ObjectFactory<DpaTask, std::istream> m_dpaParser;
+  /// \brief Parse message of any category in single pass
+  /// \param [in] data characters of the message
+  /// \param [in] size number of characters
+  /// \return parsed request
+  ParsedRequest parse(const char* data, size_t size);
+
+  /// \brief Create DpaTask from the rest of message
+  /// \param [in] perif type of peripheral
+  /// \param [in] tokenizer tokens of message following the type
+  /// \param [out] error description of error
+  /// \return created task, empty in case of error
+  std::unique_ptr<DpaTask> parseRequest(const SimpleTokenizer::Token& perif, SimpleTokenizer& tokenizer,
+    std::string& error);
+
+  ObjectFactory<DpaTask, SimpleTokenizer> m_dpaParser;
 
   void init();
   std::string m_lastError;
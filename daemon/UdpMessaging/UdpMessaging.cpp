@@ -22,6 +22,7 @@
 #include "UdpMessage.h"
 #include "IqrfLogging.h"
 #include "crc.h"
+#include "TimestampFormatter.h"
 
 INIT_COMPONENT(IMessaging, UdpMessaging)
 
@@ -237,19 +238,20 @@ void UdpMessaging::getGwStatus(ustring& message)
 {
   // current date/time based on current system
   time_t now = time(0);
-  tm *ltm = localtime(&now);
+  tm ltm;
+  TimestampFormatter::localTime(now, ltm);
 
   message.resize(UdpGwStatus::unused12 + 1, '\0');
   //TODO get channel status to Channel iface
   message[trStatus] = 0x80;   //SPI_IQRF_SPI_READY_COMM = 0x80, see spi_iqrf.h
   message[supplyExt] = 0x01;  //DB3 0x01 supplied from external source
-  message[timeSec] = (unsigned char)ltm->tm_sec;    //DB4 GW time – seconds(see Time and date coding)
-  message[timeMin] = (unsigned char)ltm->tm_min;    //DB5 GW time – minutes
-  message[timeHour] = (unsigned char)ltm->tm_hour;    //DB6 GW time – hours
-  message[timeWday] = (unsigned char)ltm->tm_wday;    //DB7 GW date – day of the week
-  message[timeMday] = (unsigned char)ltm->tm_mday;    //DB8 GW date – day
-  message[timeMon] = (unsigned char)ltm->tm_mon;    //DB9 GW date – month
-  message[timeYear] = (unsigned char)(ltm->tm_year % 100);   //DB10 GW date – year
+  message[timeSec] = (unsigned char)ltm.tm_sec;    //DB4 GW time – seconds(see Time and date coding)
+  message[timeMin] = (unsigned char)ltm.tm_min;    //DB5 GW time – minutes
+  message[timeHour] = (unsigned char)ltm.tm_hour;    //DB6 GW time – hours
+  message[timeWday] = (unsigned char)ltm.tm_wday;    //DB7 GW date – day of the week
+  message[timeMday] = (unsigned char)ltm.tm_mday;    //DB8 GW date – day
+  message[timeMon] = (unsigned char)ltm.tm_mon;    //DB9 GW date – month
+  message[timeYear] = (unsigned char)(ltm.tm_year % 100);   //DB10 GW date – year
 }
 
 void UdpMessaging::start()
@@ -306,3 +308,8 @@ void UdpMessaging::sendMessage(const ustring& msg)
   //TODO not used now from any Service
   m_toUdpMessageQueue->pushToQueue(msg);
 }
+
+void UdpMessaging::sendMessage(OutputBuffer& msg)
+{
+  m_toUdpMessageQueue->pushToQueue(msg.release());
+}
@@ -69,6 +69,7 @@ public:
   void registerMessageHandler(MessageHandlerFunc hndl) override;
   void unregisterMessageHandler() override;
   void sendMessage(const ustring& msg) override;
+  void sendMessage(OutputBuffer& msg) override;
 
   // IDpaMessageForwarding overriden methods
   std::unique_ptr<DpaTransaction> getDpaTransactionForward(DpaTransaction* forwarded) override;
@@ -0,0 +1,316 @@
+/*
+ * Copyright 2016-2017 MICRORISC s.r.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#if defined(HEXCODEC_SCALAR)
+//vector code is disabled, e.g. to test scalar code
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#define HEXCODEC_SSSE3
+#elif defined(HEXCODEC_NEON_ENABLED) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+//not enabled by default until verified by examples/hexcodec_test on the target
+#include <arm_neon.h>
+#define HEXCODEC_NEON
+#endif
+
+/// \namespace hexcodec
+/// \brief Conversion of binary data from/to hexadecimal string
+/// \details
+/// Canonical form is two lower case hexadecimal digits per byte separated by '.' or ' ', e.g: "00.a5.b1".
+/// Blocks of 16 bytes are converted with SSSE3 instructions if the build enables them (or NEON if
+/// HEXCODEC_NEON_ENABLED is defined), the rest and non canonical input is converted by table driven scalar code.
+/// HEXCODEC_SCALAR disables the vector code. Round trip is tested by examples/hexcodec_test.
+namespace hexcodec
+{
+  /// \brief Get size of buffer for encoded data
+  /// \param [in] len length of binary data
+  /// \return required size of output buffer
+  inline size_t encodedSize(size_t len)
+  {
+    return 3 * len;
+  }
+
+  namespace detail
+  {
+    /// \brief Table of digit pairs indexed by byte value
+    inline const char* pairTable()
+    {
+      static const char table[] =
+        "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f"
+        "202122232425262728292a2b2c2d2e2f303132333435363738393a3b3c3d3e3f"
+        "404142434445464748494a4b4c4d4e4f505152535455565758595a5b5c5d5e5f"
+        "606162636465666768696a6b6c6d6e6f707172737475767778797a7b7c7d7e7f"
+        "808182838485868788898a8b8c8d8e8f909192939495969798999a9b9c9d9e9f"
+        "a0a1a2a3a4a5a6a7a8a9aaabacadaeafb0b1b2b3b4b5b6b7b8b9babbbcbdbebf"
+        "c0c1c2c3c4c5c6c7c8c9cacbcccdcecfd0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
+        "e0e1e2e3e4e5e6e7e8e9eaebecedeeeff0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
+      return table;
+    }
+
+    /// \brief Get value of hexadecimal digit
+    /// \return value of the digit or -1 if it isn't hexadecimal digit
+    inline int digitValue(char c)
+    {
+      if (c >= '0' && c <= '9') return c - '0';
+      if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+      if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+      return -1;
+    }
+
+    inline bool isSeparator(char c)
+    {
+      return c == '.' || c == ' ' || c == '\t' || c == '\r' || c == '\n';
+    }
+
+#if defined(HEXCODEC_SSSE3)
+    /// 16 bytes to 48 chars
+    inline void encodeBlock(char* to, const uint8_t* from, char separator)
+    {
+      const __m128i nibbleMask = _mm_set1_epi8(0x0f);
+      const __m128i nine = _mm_set1_epi8(9);
+      const __m128i zeroChar = _mm_set1_epi8('0');
+      const __m128i letterOffset = _mm_set1_epi8('a' - '0' - 10);
+
+      __m128i in = _mm_loadu_si128((const __m128i*)from);
+      __m128i hi = _mm_and_si128(_mm_srli_epi16(in, 4), nibbleMask);
+      __m128i lo = _mm_and_si128(in, nibbleMask);
+      hi = _mm_add_epi8(_mm_add_epi8(hi, zeroChar), _mm_and_si128(_mm_cmpgt_epi8(hi, nine), letterOffset));
+      lo = _mm_add_epi8(_mm_add_epi8(lo, zeroChar), _mm_and_si128(_mm_cmpgt_epi8(lo, nine), letterOffset));
+
+      //digit pairs 0-7 and 8-15
+      __m128i il0 = _mm_unpacklo_epi8(hi, lo);
+      __m128i il1 = _mm_unpackhi_epi8(hi, lo);
+
+      //spread pairs and insert separators
+      const char z = (char)0x80;
+      const char s = separator;
+      __m128i out0 = _mm_or_si128(
+        _mm_shuffle_epi8(il0, _mm_setr_epi8(0, 1, z, 2, 3, z, 4, 5, z, 6, 7, z, 8, 9, z, 10)),
+        _mm_setr_epi8(0, 0, s, 0, 0, s, 0, 0, s, 0, 0, s, 0, 0, s, 0));
+      __m128i out1 = _mm_or_si128(_mm_or_si128(
+        _mm_shuffle_epi8(il0, _mm_setr_epi8(11, z, 12, 13, z, 14, 15, z, z, z, z, z, z, z, z, z)),
+        _mm_shuffle_epi8(il1, _mm_setr_epi8(z, z, z, z, z, z, z, z, 0, 1, z, 2, 3, z, 4, 5))),
+        _mm_setr_epi8(0, s, 0, 0, s, 0, 0, s, 0, 0, s, 0, 0, s, 0, 0));
+      __m128i out2 = _mm_or_si128(
+        _mm_shuffle_epi8(il1, _mm_setr_epi8(z, 6, 7, z, 8, 9, z, 10, 11, z, 12, 13, z, 14, 15, z)),
+        _mm_setr_epi8(s, 0, 0, s, 0, 0, s, 0, 0, s, 0, 0, s, 0, 0, s));
+
+      _mm_storeu_si128((__m128i*)to, out0);
+      _mm_storeu_si128((__m128i*)(to + 16), out1);
+      _mm_storeu_si128((__m128i*)(to + 32), out2);
+    }
+
+    /// 16 ASCII digits to nibbles, returns false if any of them is not hexadecimal digit
+    inline bool digitsToNibbles(__m128i& v)
+    {
+      const __m128i zero = _mm_setzero_si128();
+      __m128i d = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+      __m128i l = _mm_sub_epi8(_mm_or_si128(v, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+      __m128i isDigit = _mm_cmpeq_epi8(_mm_subs_epu8(d, _mm_set1_epi8(9)), zero);
+      __m128i isLetter = _mm_cmpeq_epi8(_mm_subs_epu8(l, _mm_set1_epi8(5)), zero);
+      if (_mm_movemask_epi8(_mm_or_si128(isDigit, isLetter)) != 0xffff)
+        return false;
+      v = _mm_or_si128(_mm_and_si128(isDigit, d), _mm_and_si128(isLetter, _mm_add_epi8(l, _mm_set1_epi8(10))));
+      return true;
+    }
+
+    /// 48 chars to 16 bytes, returns false if the block is not canonical
+    inline bool decodeBlock(uint8_t* to, const char* from, char separator)
+    {
+      const char z = (char)0x80;
+      __m128i in0 = _mm_loadu_si128((const __m128i*)from);
+      __m128i in1 = _mm_loadu_si128((const __m128i*)(from + 16));
+      __m128i in2 = _mm_loadu_si128((const __m128i*)(from + 32));
+
+      __m128i sep = _mm_or_si128(_mm_or_si128(
+        _mm_shuffle_epi8(in0, _mm_setr_epi8(2, 5, 8, 11, 14, z, z, z, z, z, z, z, z, z, z, z)),
+        _mm_shuffle_epi8(in1, _mm_setr_epi8(z, z, z, z, z, 1, 4, 7, 10, 13, z, z, z, z, z, z))),
+        _mm_shuffle_epi8(in2, _mm_setr_epi8(z, z, z, z, z, z, z, z, z, z, 0, 3, 6, 9, 12, 15)));
+      if (_mm_movemask_epi8(_mm_cmpeq_epi8(sep, _mm_set1_epi8(separator))) != 0xffff)
+        return false;
+
+      __m128i hi = _mm_or_si128(_mm_or_si128(
+        _mm_shuffle_epi8(in0, _mm_setr_epi8(0, 3, 6, 9, 12, 15, z, z, z, z, z, z, z, z, z, z)),
+        _mm_shuffle_epi8(in1, _mm_setr_epi8(z, z, z, z, z, z, 2, 5, 8, 11, 14, z, z, z, z, z))),
+        _mm_shuffle_epi8(in2, _mm_setr_epi8(z, z, z, z, z, z, z, z, z, z, z, 1, 4, 7, 10, 13)));
+      __m128i lo = _mm_or_si128(_mm_or_si128(
+        _mm_shuffle_epi8(in0, _mm_setr_epi8(1, 4, 7, 10, 13, z, z, z, z, z, z, z, z, z, z, z)),
+        _mm_shuffle_epi8(in1, _mm_setr_epi8(z, z, z, z, z, 0, 3, 6, 9, 12, 15, z, z, z, z, z))),
+        _mm_shuffle_epi8(in2, _mm_setr_epi8(z, z, z, z, z, z, z, z, z, z, z, 2, 5, 8, 11, 14)));
+
+      if (!digitsToNibbles(hi) || !digitsToNibbles(lo))
+        return false;
+
+      //nibbles don't overflow to neighbour byte
+      _mm_storeu_si128((__m128i*)to, _mm_or_si128(_mm_slli_epi16(hi, 4), lo));
+      return true;
+    }
+#elif defined(HEXCODEC_NEON)
+    /// 16 bytes to 48 chars
+    inline void encodeBlock(char* to, const uint8_t* from, char separator)
+    {
+      const uint8x16_t nine = vdupq_n_u8(9);
+      const uint8x16_t zeroChar = vdupq_n_u8('0');
+      const uint8x16_t letterOffset = vdupq_n_u8('a' - '0' - 10);
+
+      uint8x16_t in = vld1q_u8(from);
+      uint8x16_t hi = vshrq_n_u8(in, 4);
+      uint8x16_t lo = vandq_u8(in, vdupq_n_u8(0x0f));
+
+      uint8x16x3_t out;
+      out.val[0] = vaddq_u8(vaddq_u8(hi, zeroChar), vandq_u8(vcgtq_u8(hi, nine), letterOffset));
+      out.val[1] = vaddq_u8(vaddq_u8(lo, zeroChar), vandq_u8(vcgtq_u8(lo, nine), letterOffset));
+      out.val[2] = vdupq_n_u8((uint8_t)separator);
+      vst3q_u8((uint8_t*)to, out);
+    }
+
+    inline bool allSet(uint8x16_t m)
+    {
+      uint8x8_t r = vand_u8(vget_low_u8(m), vget_high_u8(m));
+      return vget_lane_u64(vreinterpret_u64_u8(r), 0) == ~(uint64_t)0;
+    }
+
+    /// 16 ASCII digits to nibbles, returns false if any of them is not hexadecimal digit
+    inline bool digitsToNibbles(uint8x16_t& v)
+    {
+      uint8x16_t d = vsubq_u8(v, vdupq_n_u8('0'));
+      uint8x16_t l = vsubq_u8(vorrq_u8(v, vdupq_n_u8(0x20)), vdupq_n_u8('a'));
+      uint8x16_t isDigit = vcleq_u8(d, vdupq_n_u8(9));
+      uint8x16_t isLetter = vcleq_u8(l, vdupq_n_u8(5));
+      if (!allSet(vorrq_u8(isDigit, isLetter)))
+        return false;
+      v = vorrq_u8(vandq_u8(isDigit, d), vandq_u8(isLetter, vaddq_u8(l, vdupq_n_u8(10))));
+      return true;
+    }
+
+    /// 48 chars to 16 bytes, returns false if the block is not canonical
+    inline bool decodeBlock(uint8_t* to, const char* from, char separator)
+    {
+      uint8x16x3_t in = vld3q_u8((const uint8_t*)from);
+      if (!allSet(vceqq_u8(in.val[2], vdupq_n_u8((uint8_t)separator))))
+        return false;
+      if (!digitsToNibbles(in.val[0]) || !digitsToNibbles(in.val[1]))
+        return false;
+      vst1q_u8(to, vorrq_u8(vshlq_n_u8(in.val[0], 4), in.val[1]));
+      return true;
+    }
+#endif
+
+    /// \brief Decode any accepted form
+    /// \details
+    /// Tokens of one or two digits optionally prefixed by "0x" are separated by '.' or whitespaces
+    inline int decodeScalar(uint8_t* to, size_t maxlen, const char* from, size_t len)
+    {
+      size_t retval = 0;
+      size_t i = 0;
+      while (retval < maxlen) {
+        while (i < len && isSeparator(from[i])) i++;
+        if (i == len) break;
+
+        if (i + 1 < len && from[i] == '0' && (from[i + 1] == 'x' || from[i + 1] == 'X')) i += 2;
+
+        int val = 0;
+        int digits = 0;
+        int d;
+        while (i < len && (d = digitValue(from[i])) >= 0) {
+          //a byte has at most two digits, longer runs are rejected before they can overflow
+          if (++digits > 2)
+            return -1;
+          val = (val << 4) | d;
+          i++;
+        }
+        if (digits == 0 || (i < len && !isSeparator(from[i])))
+          return -1;
+        to[retval++] = (uint8_t)val;
+      }
+      return (int)retval;
+    }
+  }
+
+  /// \brief Encode binary data to hexadecimal string
+  /// \param [out] to output buffer of at least encodedSize(len) chars
+  /// \param [in] from data to be encoded
+  /// \param [in] len length of data to be encoded
+  /// \param [in] separator separator of bytes, typically '.' or ' '
+  /// \return number of written chars, there is no trailing separator
+  inline size_t encode(char* to, const uint8_t* from, size_t len, char separator)
+  {
+    if (len == 0)
+      return 0;
+
+    const char* table = detail::pairTable();
+    size_t i = 0;
+#if defined(HEXCODEC_SSSE3) || defined(HEXCODEC_NEON)
+    for (; i + 16 <= len; i += 16) {
+      detail::encodeBlock(to + 3 * i, from + i, separator);
+    }
+#endif
+    for (; i < len; i++) {
+      const char* pair = table + 2 * from[i];
+      to[3 * i] = pair[0];
+      to[3 * i + 1] = pair[1];
+      to[3 * i + 2] = separator;
+    }
+    return 3 * len - 1;
+  }
+
+  /// \brief Decode hexadecimal string to binary data
+  /// \param [out] to output buffer
+  /// \param [in] maxlen size of output buffer, the rest of input is ignored if exceeded
+  /// \param [in] from hexadecimal string
+  /// \param [in] len length of hexadecimal string
+  /// \return number of decoded bytes or -1 in case of unexpected format
+  /// \details
+  /// Accepts canonical form and also one digit bytes, "0x" prefixes and more whitespaces between bytes
+  inline int decode(uint8_t* to, size_t maxlen, const char* from, size_t len)
+  {
+    size_t retval = 0;
+    size_t i = 0;
+#if defined(HEXCODEC_SSSE3) || defined(HEXCODEC_NEON)
+    //canonical blocks followed by separator
+    if (len > 2 && detail::isSeparator(from[2])) {
+      char separator = from[2];
+      while (i + 48 <= len && retval + 16 <= maxlen && detail::decodeBlock(to + retval, from + i, separator)) {
+        i += 48;
+        retval += 16;
+      }
+    }
+#endif
+    int rest = detail::decodeScalar(to + retval, maxlen - retval, from + i, len - i);
+    return rest < 0 ? -1 : (int)retval + rest;
+  }
+
+  /// \brief Encode number to hexadecimal digits
+  /// \param [out] to output buffer of at least 2 * sizeof(T) chars
+  /// \param [in] from number to be encoded
+  /// \return number of written chars
+  template<typename T>
+  inline size_t encodeNum(char* to, T from)
+  {
+    const char* table = detail::pairTable();
+    size_t n = sizeof(T);
+    for (size_t i = 0; i < n; i++) {
+      const char* pair = table + 2 * (uint8_t)(from >> (8 * (n - 1 - i)));
+      to[2 * i] = pair[0];
+      to[2 * i + 1] = pair[1];
+    }
+    return 2 * n;
+  }
+}
@@ -18,6 +18,8 @@
 
 #include "DpaTransaction.h"
 #include <string>
+#include <vector>
+#include <utility>
 
 typedef std::basic_string<unsigned char> ustring;
 /// Asynchronous DPA message handler functional type
@@ -39,6 +41,27 @@ public:
   /// The transaction consists from DPA requeste sent to coordinator. It is finished by DPA response or timeout
   virtual void executeDpaTransaction(DpaTransaction& dpaTransaction) = 0;
 
+  /// \brief Execute DPA transaction with retries
+  /// \param [in]     dpaTransaction Transaction to be executed
+  /// \param [in]     retries number of retries in case of retryable error, negative value means default retry policy
+  /// \details
+  /// The transaction is repeated before it is finished if it fails with an error configured as retryable.
+  virtual void executeDpaTransaction(DpaTransaction& dpaTransaction, int retries)
+  {
+    executeDpaTransaction(dpaTransaction);
+  }
+
+  /// \brief Execute DPA transactions back to back
+  /// \param [in]     dpaTransactions Transactions to be executed paired with their number of retries
+  /// \details
+  /// The transactions are queued at once so no other transaction is executed between them.
+  virtual void executeDpaTransactions(const std::vector<std::pair<DpaTransaction*, int>>& dpaTransactions)
+  {
+    for (const auto& trn : dpaTransactions) {
+      executeDpaTransaction(*trn.first, trn.second);
+    }
+  }
+
   /// \brief Register Asynchronous DPA message handler
   /// \param [in] clientId client identification registering handler function
   /// \param [in] fun handler function
@@ -72,32 +95,32 @@ public:
   /// \brief Get IQRF coordination identification
   /// \details
   /// \return Module ID
-  /// Module ID is taken from the coordinator at the initialization phase, e.g. "8100528a"
-  virtual const std::string& getModuleId() = 0;
+  /// Module ID is taken from the coordinator at the initialization phase and updated by refresh, e.g. "8100528a"
+  virtual std::string getModuleId() = 0;
 
   /// \brief Get IQRF coordination OS version
   /// \return OS version
   /// \details
-  /// OS version is taken from the coordinator at the initialization phase, e.g. "3.08D"
-  virtual const std::string& getOsVersion() = 0;
+  /// OS version is taken from the coordinator at the initialization phase and updated by refresh, e.g. "3.08D"
+  virtual std::string getOsVersion() = 0;
 
   /// \brief Get IQRF coordination TR type
   /// \return TR type
   /// \details
-  /// TR type is taken from the coordinator at the initialization phase, e.g. "DCTR-72D"
-  virtual const std::string& getTrType() = 0;
+  /// TR type is taken from the coordinator at the initialization phase and updated by refresh, e.g. "DCTR-72D"
+  virtual std::string getTrType() = 0;
 
   /// \brief Get IQRF coordination MCU type
   /// \return MCU type
   /// \details
-  /// MCU type is taken from the coordinator at the initialization phase, e.g. "PIC16F1938"
-  virtual const std::string& getMcuType() = 0;
+  /// MCU type is taken from the coordinator at the initialization phase and updated by refresh, e.g. "PIC16F1938"
+  virtual std::string getMcuType() = 0;
 
   /// \brief Get IQRF coordination OS build
   /// \return OS build
   /// \details
-  /// OS build is taken from the coordinator at the initialization phase, e.g. "0879"
-  virtual const std::string& getOsBuild() = 0;
+  /// OS build is taken from the coordinator at the initialization phase and updated by refresh, e.g. "0879"
+  virtual std::string getOsBuild() = 0;
 
   /// \brief Get iqrf-daemon Version
   /// \return Version
@@ -17,6 +17,8 @@
 #pragma once
 
 #include "JsonUtils.h"
+#include "MessageSpan.h"
+#include "OutputBuffer.h"
 #include <string>
 #include <functional>
 
@@ -53,13 +55,15 @@ public:
 
   typedef std::basic_string<unsigned char> ustring;
   /// Incoming message handler functional type
-  typedef std::function<void(const ustring&)> MessageHandlerFunc;
+  typedef std::function<void(MessageSpan&)> MessageHandlerFunc;
 
   /// \brief Register message handler
   /// \param [in] hndl registering handler function
   /// \details
   /// Whenever a message is received it is passed to the handler function. It is possible to register 
-  /// just one handler
+  /// just one handler.
+  /// The message is passed as a span of messaging buffer valid during the call. If the buffer is handed over,
+  /// the handler may modify it or take it, see MessageSpan.
   virtual void registerMessageHandler(MessageHandlerFunc hndl) = 0;
 
   /// \brief Unregister message handler
@@ -73,5 +77,24 @@ public:
   /// The message is send outside
   virtual void sendMessage(const ustring& msg) = 0;
 
+  /// \brief Create buffer for outgoing message
+  /// \return empty buffer to be written and passed to sendMessage(OutputBuffer&)
+  /// \details
+  /// Messaging may preallocate the buffer according its payload.
+  virtual OutputBuffer createOutput()
+  {
+    return OutputBuffer();
+  }
+
+  /// \brief send message written to the buffer
+  /// \param [in] msg buffer with message to be sent
+  /// \details
+  /// The message is taken over from the buffer without copying, the buffer is empty after the call.
+  /// The default implementation passes the message to sendMessage(const ustring&).
+  virtual void sendMessage(OutputBuffer& msg)
+  {
+    sendMessage(msg.release());
+  }
+
   inline virtual ~IMessaging() {};
 };
@@ -18,14 +18,86 @@
 
 #include "ObjectFactory.h"
 #include "DpaTask.h"
+#include "JsonUtils.h"
+#include "MessageSpan.h"
+#include "OutputBuffer.h"
 #include <memory>
 #include <string>
+#include <vector>
 
 /// Configuration category identification string
 static const std::string CAT_CONF_STR("conf");
 /// DPA category identification sting
 static const std::string CAT_DPA_STR("dpa");
 
+/// \class DpaRequestOptions
+/// \brief Optional DPA request processing parameters
+/// \details
+/// DpaTask created by ISerializer may inherit it to pass processing parameters not covered by DpaTask.
+/// The service executing the task gets them via dynamic_cast.
+class DpaRequestOptions
+{
+public:
+  virtual ~DpaRequestOptions() {}
+
+  /// \brief Get number of retries
+  /// \return number of retries, negative value means default retry policy
+  int getRetries() const { return m_retries; }
+
+  /// \brief Set number of retries
+  /// \param [in] retries number of retries, negative value means default retry policy
+  void setRetries(int retries) { m_retries = retries; }
+
+protected:
+  int m_retries = -1;
+};
+
+/// \class DpaResponseOutput
+/// \brief Encoding of DPA response to output buffer
+/// \details
+/// DpaTask created by ISerializer may inherit it to write its response directly to the buffer provided by messaging.
+/// The service gets it via dynamic_cast, responses of other tasks are taken from DpaTask::encodeResponse().
+class DpaResponseOutput
+{
+public:
+  virtual ~DpaResponseOutput() {}
+
+  /// \brief Encode DPA response to output buffer
+  /// \param [in] errStr result of DpaTask handling in IQRF mesh to be stored in message
+  /// \param [out] output buffer the encoded message is appended to
+  virtual void encodeResponseTo(const std::string& errStr, OutputBuffer& output) = 0;
+};
+
+/// \class RequestError
+/// \brief Structured description of rejected request
+/// \details
+/// Filled by serializers able to locate the failure, e.g. by schema validation. Empty members are unknown.
+struct RequestError
+{
+  std::string m_msgid;    ///< message id of the rejected request
+  std::string m_keyword;  ///< failed schema keyword
+  std::string m_schema;   ///< URI fragment of the failed schema
+  std::string m_member;   ///< URI fragment of the invalid member
+};
+
+/// \class ParsedRequest
+/// \brief Result of request parsing
+/// \details
+/// Holds category and according the category either created DpaTask or configuration command.
+/// Category is empty if the request is not recognized. DpaTask or command is empty in case of error
+/// and the error is described by m_error and m_errorInfo.
+/// If the serializer modified the message while parsing, it keeps configuration request in m_request
+/// to be passed to encodeConfig().
+struct ParsedRequest
+{
+  std::string m_category;
+  std::unique_ptr<DpaTask> m_dpaTask;
+  std::string m_command;
+  std::string m_error;
+  RequestError m_errorInfo;
+  std::string m_request;
+};
+
 /// \class ISerializer
 /// \brief ISerializer interface
 class ISerializer
@@ -34,6 +106,12 @@ public:
   // component
   virtual const std::string& getName() const = 0;
 
+  /// \brief Update ISerializer instance configuration
+  /// \param [in] cfg configuration data
+  /// \details
+  /// Serializers without configurable properties keep the default empty implementation.
+  virtual void update(const rapidjson::Value& cfg) {}
+
   /// \brief Get category identification from request
   /// \param [in] request incoming request to be examined
   /// \return category string
@@ -58,6 +136,105 @@ public:
   /// The only switch mode forwarding | operational | service is supported now.
   /// Returned string may be empty in case of error.
   virtual std::string parseConfig(const std::string& request) = 0;
+
+  /// \brief Parse request of any category
+  /// \param [in] request incoming request
+  /// \return parsed request
+  /// \details
+  /// Gets category and parses the request according it. Serializers should override it to parse the request only once.
+  /// The default implementation calls parseCategory() and then parseRequest() or parseConfig().
+  virtual ParsedRequest parse(const std::string& request)
+  {
+    ParsedRequest parsed;
+    parsed.m_category = parseCategory(request);
+    if (parsed.m_category == CAT_DPA_STR) {
+      parsed.m_dpaTask = parseRequest(request);
+    }
+    else if (parsed.m_category == CAT_CONF_STR) {
+      parsed.m_command = parseConfig(request);
+    }
+    if (!parsed.m_dpaTask && parsed.m_command.empty()) {
+      parsed.m_error = getLastError();
+    }
+    return parsed;
+  }
+
+  /// \brief Parse received message of any category
+  /// \param [in] request span of received message
+  /// \return parsed request
+  /// \details
+  /// Serializers should override it to parse the message without copying. They may parse handed over buffer
+  /// in place, the message must not be used by other serializers then.
+  /// The default implementation copies the message and calls parse().
+  virtual ParsedRequest parse(MessageSpan& request)
+  {
+    return parse(request.str());
+  }
+
+  /// \brief Parse batch of requests
+  /// \param [in] request incoming message
+  /// \param [out] items parsed requests of the batch
+  /// \return true if the message is a batch else false
+  /// \details
+  /// A message may hold more requests to be executed back to back and answered by one response.
+  /// If the message is not a batch it is left to parse(). Only DPA requests are expected in the batch.
+  /// The default implementation does not support batches.
+  virtual bool parseBatch(const std::string& request, std::vector<ParsedRequest>& items)
+  {
+    return false;
+  }
+
+  /// \brief Parse batch of requests from received message
+  /// \param [in] request span of received message
+  /// \param [out] items parsed requests of the batch
+  /// \return true if the message is a batch else false
+  /// \details
+  /// The same as parse(MessageSpan&) applies. The default implementation copies the message and calls parseBatch().
+  virtual bool parseBatch(MessageSpan& request, std::vector<ParsedRequest>& items)
+  {
+    return parseBatch(request.str(), items);
+  }
+
+  /// \brief Encode batch response
+  /// \param [in] responses encoded responses of batch items in order of requests
+  /// \return batch response
+  virtual std::string encodeBatch(const std::vector<std::string>& responses)
+  {
+    std::string res;
+    for (const auto& rsp : responses) {
+      res += rsp;
+      res += '\n';
+    }
+    return res;
+  }
+
+  /// \brief Encode batch response to output buffer
+  /// \param [in] responses encoded responses of batch items in order of requests
+  /// \param [out] output buffer the batch response is appended to
+  /// \details
+  /// The default implementation appends result of encodeBatch().
+  virtual void encodeBatch(const std::vector<std::string>& responses, OutputBuffer& output)
+  {
+    output.append(encodeBatch(responses));
+  }
+
+  /// \brief Encode batch item error
+  /// \param [in] parsed batch item failed to be parsed
+  /// \return encoded error to be used as item response
+  virtual std::string encodeBatchError(const ParsedRequest& parsed)
+  {
+    return "PARSE ERROR: " + parsed.m_error;
+  }
+
+  /// \brief Encode error of rejected request to output buffer
+  /// \param [in] parsed request failed to be parsed
+  /// \param [out] output buffer the encoded error is appended to
+  /// \details
+  /// The default implementation appends result of encodeBatchError().
+  virtual void encodeError(const ParsedRequest& parsed, OutputBuffer& output)
+  {
+    output.append(encodeBatchError(parsed));
+  }
   
   /// \brief Encode confiquration response
   /// \param [in] request original configuration request
@@ -66,6 +243,17 @@ public:
   /// \details
   /// Encode configuration response based on original configuration request and passed response phrase.
   virtual std::string encodeConfig(const std::string& request, const std::string& response) = 0;
+
+  /// \brief Encode confiquration response to output buffer
+  /// \param [in] request original configuration request
+  /// \param [in] response string with response phrase
+  /// \param [out] output buffer the configuration response is appended to
+  /// \details
+  /// The default implementation appends result of encodeConfig().
+  virtual void encodeConfig(const std::string& request, const std::string& response, OutputBuffer& output)
+  {
+    output.append(encodeConfig(request, response));
+  }
   
   /// \brief Get last error string
   /// \return error string
@@ -80,5 +268,15 @@ public:
   /// Passed asynchronous DPA message is serialized in an appropriate form.
   virtual std::string encodeAsyncAsDpaRaw(const DpaMessage& dpaMessage) const = 0;
 
+  /// \brief Encode Asynchronous DPA message to output buffer
+  /// \param [in] dpaMessage message to be encoded
+  /// \param [out] output buffer the serialized message is appended to
+  /// \details
+  /// The default implementation appends result of encodeAsyncAsDpaRaw().
+  virtual void encodeAsyncAsDpaRaw(const DpaMessage& dpaMessage, OutputBuffer& output) const
+  {
+    output.append(encodeAsyncAsDpaRaw(dpaMessage));
+  }
+
   virtual ~ISerializer() {}
 };
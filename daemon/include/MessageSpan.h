@@ -0,0 +1,162 @@
+/*
+ * Copyright 2016-2017 MICRORISC s.r.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <string>
+#include <cstdlib>
+#include <cstring>
+
+/// \class MessageSpan
+/// \brief Received message passed without copying
+/// \details
+/// Refers to bytes of a message kept by messaging. The bytes are valid just during the message handler call.
+/// Messaging may hand its buffer over together with a deleter. The bytes are writable then, e.g. a serializer
+/// may parse them in place, and the receiver may take() the buffer to keep it after the handler returns.
+/// The buffer is released by the deleter when the owning span is destroyed.
+class MessageSpan
+{
+public:
+  typedef std::basic_string<unsigned char> ustring;
+  /// Deleter of handed over buffer
+  typedef void(*Deleter)(void* owner);
+
+  /// \brief Span of bytes kept by caller
+  /// \param [in] data message bytes
+  /// \param [in] size number of bytes
+  MessageSpan(const unsigned char* data, size_t size)
+    :m_data(data)
+    , m_size(size)
+  {
+  }
+
+  /// \brief Span of message kept by caller
+  /// \param [in] msg message
+  MessageSpan(const ustring& msg)
+    :MessageSpan(msg.data(), msg.size())
+  {
+  }
+
+  /// \brief Span of message kept by caller
+  /// \param [in] msg message
+  MessageSpan(const std::string& msg)
+    :MessageSpan((const unsigned char*)msg.data(), msg.size())
+  {
+  }
+
+  /// \brief Span of handed over buffer
+  /// \param [in] data message bytes inside the buffer
+  /// \param [in] size number of bytes
+  /// \param [in] owner buffer passed to deleter
+  /// \param [in] deleter releases the buffer
+  MessageSpan(unsigned char* data, size_t size, void* owner, Deleter deleter)
+    :m_data(data)
+    , m_size(size)
+    , m_owner(owner)
+    , m_deleter(deleter)
+  {
+  }
+
+  MessageSpan(MessageSpan&& other)
+    :m_data(other.m_data)
+    , m_size(other.m_size)
+    , m_owner(other.m_owner)
+    , m_deleter(other.m_deleter)
+  {
+    other.m_data = nullptr;
+    other.m_size = 0;
+    other.m_owner = nullptr;
+  }
+
+  MessageSpan& operator=(MessageSpan&& other)
+  {
+    if (this != &other) {
+      release();
+      m_data = other.m_data;
+      m_size = other.m_size;
+      m_owner = other.m_owner;
+      m_deleter = other.m_deleter;
+      other.m_data = nullptr;
+      other.m_size = 0;
+      other.m_owner = nullptr;
+    }
+    return *this;
+  }
+
+  MessageSpan(const MessageSpan&) = delete;
+  MessageSpan& operator=(const MessageSpan&) = delete;
+
+  ~MessageSpan()
+  {
+    release();
+  }
+
+  const unsigned char* data() const { return m_data; }
+  const char* chars() const { return (const char*)m_data; }
+  size_t size() const { return m_size; }
+  bool empty() const { return m_size == 0; }
+  unsigned char operator[](size_t i) const { return m_data[i]; }
+
+  /// \brief Check handed over buffer
+  /// \return true if the buffer is handed over so the bytes may be modified
+  bool isWritable() const { return m_owner != nullptr; }
+
+  /// \brief Get writable bytes
+  /// \return message bytes or nullptr if the buffer is not handed over
+  char* writable() { return m_owner ? (char*)m_data : nullptr; }
+
+  /// \brief Take message to keep it after the handler returns
+  /// \return span owning the message
+  /// \details
+  /// Handed over buffer is moved to the returned span, other bytes are copied to a new buffer.
+  /// This span is empty then.
+  MessageSpan take()
+  {
+    if (m_owner) {
+      return std::move(*this);
+    }
+    unsigned char* copy = (unsigned char*)std::malloc(m_size > 0 ? m_size : 1);
+    if (m_size > 0) {
+      std::memcpy(copy, m_data, m_size);
+    }
+    MessageSpan taken(copy, m_size, copy, std::free);
+    m_data = nullptr;
+    m_size = 0;
+    return taken;
+  }
+
+  /// \brief Copy message to string
+  /// \return message bytes
+  std::string str() const { return std::string(chars(), m_size); }
+
+  /// \brief Copy message to ustring
+  /// \return message bytes
+  ustring ustr() const { return ustring(m_data, m_size); }
+
+private:
+  void release()
+  {
+    if (m_owner) {
+      m_deleter(m_owner);
+      m_owner = nullptr;
+    }
+  }
+
+  const unsigned char* m_data = nullptr;
+  size_t m_size = 0;
+  void* m_owner = nullptr;
+  Deleter m_deleter = nullptr;
+};
@@ -18,7 +18,7 @@
 
 #include "PlatformDep.h"
 #include "IqrfLogging.h"
-#include <map>
+#include "PerfectHashMap.h"
 #include <functional>
 #include <memory>
 
@@ -28,7 +28,9 @@
 /// Allows registering object creator functions for classes created from their representations.
 /// Typically used for parsing incomming messages. The messages are preparsed to get type of class
 /// to be parsed and the type is passed together with the message to createObject method. The method
-/// creates an object via matching object creator and message data representation
+/// creates an object via matching object creator and message data representation.
+/// Creators are found by perfect hash of the name, so the cost of lookup does not depend on number of registered
+/// classes and the name may be passed as characters taken from the message without allocation.
 template<typename T, typename R>
 class ObjectFactory
 {
@@ -36,7 +38,7 @@ private:
   /// Object creator function type
   typedef std::function<std::unique_ptr<T>(R&)> CreateObjectFunc;
   /// Map of object creators
-  std::map<std::string, CreateObjectFunc> m_creators;
+  PerfectHashMap<CreateObjectFunc> m_creators;
 
   /// \brief Template function to create object of type S
   /// \param [in] representation object to be used for creation
@@ -58,10 +60,9 @@ public:
   /// the exception std::logic_error is thrown
   template<typename S>
   void registerClass(const std::string& id){
-    if (m_creators.find(id) != m_creators.end()){
+    if (!m_creators.insert(id, createObject<S>)){
       THROW_EX(std::logic_error, "Duplicit registration of: " << PAR(id));
     }
-    m_creators.insert(std::make_pair(id, createObject<S>));
   }
 
   /// \brief Check if a creator object is registered
@@ -70,7 +71,15 @@ public:
   /// \details
   /// Check registrar map if object creator for class named id is registered if yes return true else false
   bool hasClass(const std::string& id){
-    return m_creators.find(id) != m_creators.end();
+    return m_creators.find(id) != nullptr;
+  }
+
+  /// \brief Check if a creator object is registered
+  /// \param [in] id characters of name representing the class, need not to be null terminated
+  /// \param [in] len length of name
+  /// \return true if registered else false
+  bool hasClass(const char* id, size_t len){
+    return m_creators.find(id, len) != nullptr;
   }
 
   /// \brief Create object based on data representation
@@ -81,11 +90,22 @@ public:
   /// \throws std::logic_error in case of creator is not registered for passed id
   /// Crreates an object via matching object creator and message data representation
   std::unique_ptr<T> createObject(const std::string& id, R& representation){
-    auto iter = m_creators.find(id);
-    if (iter == m_creators.end()){
-      THROW_EX(std::logic_error, "Unregistered creator for: " << PAR(id));
+    return createObject(id.data(), id.size(), representation);
+  }
+
+  /// \brief Create object based on data representation
+  /// \param [in] id characters of name representing the class, need not to be null terminated
+  /// \param [in] len length of name
+  /// \param [in] representation data representing object to be created
+  /// \return created object
+  /// \throws std::logic_error in case of creator is not registered for passed id
+  std::unique_ptr<T> createObject(const char* id, size_t len, R& representation){
+    const CreateObjectFunc* creator = m_creators.find(id, len);
+    if (creator == nullptr){
+      std::string name(id, len);
+      THROW_EX(std::logic_error, "Unregistered creator for: " << PAR(name));
     }
     //calls the required createObject() function
-    return std::move(iter->second(representation));
+    return (*creator)(representation);
   }
 };
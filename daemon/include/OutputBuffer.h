@@ -0,0 +1,73 @@
+/*
+ * Copyright 2016-2017 MICRORISC s.r.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <string>
+#include <utility>
+
+/// \class OutputBuffer
+/// \brief Growable buffer of outgoing message
+/// \details
+/// Messaging provides the buffer via IMessaging::createOutput(), possibly preallocated according its payload.
+/// Serializers write encoded message directly to the buffer and messaging takes it over via
+/// IMessaging::sendMessage(OutputBuffer&), so the message is encoded once and it is not copied.
+/// The buffer meets rapidjson output stream concept, rapidjson::Writer writes to it directly.
+class OutputBuffer
+{
+public:
+  typedef char Ch;
+  typedef std::basic_string<unsigned char> ustring;
+
+  OutputBuffer() {}
+
+  /// \brief Preallocated buffer
+  /// \param [in] capacity expected size of message
+  explicit OutputBuffer(size_t capacity)
+  {
+    m_data.reserve(capacity);
+  }
+
+  /// rapidjson output stream
+  void Put(Ch c) { m_data.push_back((unsigned char)c); }
+  void Flush() {}
+
+  void push_back(char c) { m_data.push_back((unsigned char)c); }
+  void append(const char* data, size_t size) { m_data.append((const unsigned char*)data, size); }
+  void append(const std::string& data) { append(data.data(), data.size()); }
+  void reserve(size_t capacity) { m_data.reserve(capacity); }
+  void clear() { m_data.clear(); }
+
+  const unsigned char* data() const { return m_data.data(); }
+  size_t size() const { return m_data.size(); }
+  bool empty() const { return m_data.empty(); }
+
+  /// \brief Copy message to string
+  /// \return written message
+  std::string str() const { return std::string((const char*)m_data.data(), m_data.size()); }
+
+  /// \brief Take over written message
+  /// \return written message, the buffer is empty then
+  ustring release()
+  {
+    ustring released(std::move(m_data));
+    m_data.clear();
+    return released;
+  }
+
+private:
+  ustring m_data;
+};
@@ -0,0 +1,138 @@
+/*
+ * Copyright 2016-2017 MICRORISC s.r.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "IqrfLogging.h"
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+/// \class PerfectHashMap
+/// \brief Map of string keys to values without hash collisions
+/// \details
+/// Keys are placed to a table by a seeded hash. The seed and the table size are searched when a key is inserted
+/// so that each key gets its own slot. Lookup computes one hash and compares one key, no string is allocated
+/// and the cost does not depend on number of keys.
+/// Intended for small sets of keys registered at initialization and looked up per message.
+template<typename V>
+class PerfectHashMap
+{
+public:
+  /// \brief Insert value
+  /// \param [in] key key of value
+  /// \param [in] value value to be inserted
+  /// \return true if inserted, false if the key already exists
+  /// \throws std::logic_error if no perfect hash is found
+  bool insert(const std::string& key, V value)
+  {
+    if (find(key.data(), key.size())) {
+      return false;
+    }
+    m_keys.push_back(key);
+    m_values.push_back(std::move(value));
+    if (!rebuild()) {
+      m_keys.pop_back();
+      m_values.pop_back();
+      THROW_EX(std::logic_error, "No perfect hash found for: " << PAR(key));
+    }
+    return true;
+  }
+
+  /// \brief Find value
+  /// \param [in] key key characters, need not to be null terminated
+  /// \param [in] len key length
+  /// \return found value or nullptr
+  const V* find(const char* key, size_t len) const
+  {
+    if (m_slots.empty()) {
+      return nullptr;
+    }
+    int idx = m_slots[hash(key, len, m_seed) & m_mask];
+    if (idx < 0 || m_keys[idx].size() != len || memcmp(m_keys[idx].data(), key, len) != 0) {
+      return nullptr;
+    }
+    return &m_values[idx];
+  }
+
+  /// \brief Find value
+  /// \param [in] key key of value
+  /// \return found value or nullptr
+  const V* find(const std::string& key) const
+  {
+    return find(key.data(), key.size());
+  }
+
+  /// \brief Get number of values
+  /// \return number of values
+  size_t size() const { return m_keys.size(); }
+
+private:
+  static uint32_t hash(const char* key, size_t len, uint32_t seed)
+  {
+    //FNV-1a
+    uint32_t h = 2166136261u ^ seed;
+    for (size_t i = 0; i < len; i++) {
+      h ^= (uint8_t)key[i];
+      h *= 16777619u;
+    }
+    return h ^ (h >> 15);
+  }
+
+  bool place(size_t size, uint32_t seed)
+  {
+    std::vector<int> slots(size, -1);
+    for (size_t i = 0; i < m_keys.size(); i++) {
+      int& slot = slots[hash(m_keys[i].data(), m_keys[i].size(), seed) & (size - 1)];
+      if (slot >= 0) {
+        return false;
+      }
+      slot = (int)i;
+    }
+    m_slots.swap(slots);
+    m_seed = seed;
+    m_mask = (uint32_t)(size - 1);
+    return true;
+  }
+
+  bool rebuild()
+  {
+    //table twice bigger than number of keys, doubled if no seed is found
+    size_t size = 8;
+    while (size < 2 * m_keys.size()) {
+      size *= 2;
+    }
+    for (; size <= MAX_TABLE_SIZE; size *= 2) {
+      for (uint32_t attempt = 0; attempt < SEED_ATTEMPTS; attempt++) {
+        if (place(size, attempt * 0x9E3779B9u)) {
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  static const size_t MAX_TABLE_SIZE = 1 << 16;
+  static const uint32_t SEED_ATTEMPTS = 64;
+
+  std::vector<std::string> m_keys;
+  std::vector<V> m_values;
+  std::vector<int> m_slots;
+  uint32_t m_seed = 0;
+  uint32_t m_mask = 0;
+};
@@ -22,6 +22,8 @@
 #include <atomic>
 #include <condition_variable>
 #include <queue>
+#include <vector>
+#include <utility>
 
 /// \class TaskQueue
 /// \brief Maintain queue of tasks and invoke sequential processing
@@ -83,6 +85,44 @@ public:
     return retval;
   }
 
+  /// \brief Push task to queue
+  /// \param [in] task object to be moved to queue
+  /// \return size of queue
+  /// \details
+  /// The same as pushToQueue(const T&) just the task is moved to queue container without copying
+  int pushToQueue(T&& task)
+  {
+    int retval = 0;
+    {
+      std::unique_lock<std::mutex> lck(m_taskQueueMutex);
+      m_taskQueue.push(std::move(task));
+      retval = m_taskQueue.size();
+      m_taskPushed = true;
+    }
+    m_conditionVariable.notify_all();
+    return retval;
+  }
+
+  /// \brief Push tasks to queue
+  /// \param [in] tasks objects to push to queue
+  /// \return size of queue
+  /// \details
+  /// Pushes all tasks at once so they are processed back to back without other tasks between them
+  int pushToQueue(const std::vector<T>& tasks)
+  {
+    int retval = 0;
+    {
+      std::unique_lock<std::mutex> lck(m_taskQueueMutex);
+      for (const auto& task : tasks) {
+        m_taskQueue.push(task);
+      }
+      retval = m_taskQueue.size();
+      m_taskPushed = true;
+    }
+    m_conditionVariable.notify_all();
+    return retval;
+  }
+
   /// \brief Stop queue
   /// \details
   /// Worker thread is explicitly stopped
@@ -124,7 +164,7 @@ private:
 
       while (m_runWorkerThread) {
         if (!m_taskQueue.empty()) {
-          auto task = m_taskQueue.front();
+          auto task = std::move(m_taskQueue.front());
           m_taskQueue.pop();
           lck.unlock();
           m_processTaskFunc(task);
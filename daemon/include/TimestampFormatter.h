@@ -0,0 +1,187 @@
+/*
+ * Copyright 2016-2017 MICRORISC s.r.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <ctime>
+#include <cstdint>
+#include <string>
+
+/// \class TimestampFormatter
+/// \brief Local time formatting without global localtime lock
+/// \details
+/// Local time is computed arithmetically from UTC and the time zone offset. The offset is taken by localtime_r
+/// (localtime_s on Windows) once per hour in each thread, so daylight saving changes are applied at the latest
+/// at the next hour. Formatted date and time of the last second is cached per thread, just the fraction is patched.
+/// All methods are thread safe.
+class TimestampFormatter
+{
+public:
+  /// size of "YYYY-MM-DDTHH:MM:SS"
+  static const size_t SECONDS_SIZE = 19;
+  /// size of "YYYY-MM-DDTHH:MM:SS.uuuuuu"
+  static const size_t MICROS_SIZE = 26;
+
+  /// \brief Get local time
+  /// \param [in] t time to be converted
+  /// \param [out] tm broken down local time
+  static void localTime(std::time_t t, std::tm& tm)
+  {
+    int64_t offset = zoneOffset(t);
+    int64_t local = (int64_t)t + offset;
+
+    int64_t days = floorDiv(local, 86400);
+    int64_t secs = local - days * 86400;
+    int y;
+    unsigned m, d;
+    civilFromDays(days, y, m, d);
+
+    tm = std::tm();
+    tm.tm_sec = (int)(secs % 60);
+    tm.tm_min = (int)(secs / 60 % 60);
+    tm.tm_hour = (int)(secs / 3600);
+    tm.tm_mday = (int)d;
+    tm.tm_mon = (int)m - 1;
+    tm.tm_year = y - 1900;
+    tm.tm_wday = (int)((days % 7 + 11) % 7); //1970-01-01 was Thursday
+    tm.tm_yday = (int)(days - daysFromCivil(y, 1, 1));
+    tm.tm_isdst = -1;
+  }
+
+  /// \brief Format local time with seconds resolution
+  /// \param [out] to output buffer of at least SECONDS_SIZE chars
+  /// \param [in] t time to be formatted
+  /// \param [in] separator separator of date and time, e.g. 'T' gives "2017-06-23T09:53:37"
+  /// \return number of written chars
+  static size_t formatSeconds(char* to, std::time_t t, char separator = 'T')
+  {
+    struct Cache {
+      std::time_t m_time = -1;
+      char m_separator = 0;
+      char m_buf[SECONDS_SIZE];
+    };
+    static thread_local Cache cache;
+
+    if (cache.m_time != t || cache.m_separator != separator) {
+      std::tm tm;
+      localTime(t, tm);
+      char* p = cache.m_buf;
+      p = putNum(p, tm.tm_year + 1900, 4); *p++ = '-';
+      p = putNum(p, tm.tm_mon + 1, 2); *p++ = '-';
+      p = putNum(p, tm.tm_mday, 2); *p++ = separator;
+      p = putNum(p, tm.tm_hour, 2); *p++ = ':';
+      p = putNum(p, tm.tm_min, 2); *p++ = ':';
+      putNum(p, tm.tm_sec, 2);
+      cache.m_time = t;
+      cache.m_separator = separator;
+    }
+
+    std::char_traits<char>::copy(to, cache.m_buf, SECONDS_SIZE);
+    return SECONDS_SIZE;
+  }
+
+  /// \brief Format local time with microseconds resolution
+  /// \param [out] to output buffer of at least MICROS_SIZE chars
+  /// \param [in] tp time to be formatted
+  /// \return number of written chars
+  /// \details
+  /// Format is ISO 8601 without time zone, e.g. "2017-06-23T09:53:37.012345"
+  static size_t formatMicros(char* to, std::chrono::system_clock::time_point tp)
+  {
+    int64_t us = std::chrono::duration_cast<std::chrono::microseconds>(tp.time_since_epoch()).count();
+    int64_t secs = floorDiv(us, 1000000);
+    char* p = to + formatSeconds(to, (std::time_t)secs);
+    *p++ = '.';
+    putNum(p, (int)(us - secs * 1000000), 6);
+    return MICROS_SIZE;
+  }
+
+  /// \brief Format local time with microseconds resolution
+  /// \param [in] tp time to be formatted
+  /// \return formatted time
+  static std::string formatMicros(std::chrono::system_clock::time_point tp)
+  {
+    char buf[MICROS_SIZE];
+    return std::string(buf, formatMicros(buf, tp));
+  }
+
+private:
+  static int64_t floorDiv(int64_t a, int64_t b)
+  {
+    return a / b - (a % b < 0 ? 1 : 0);
+  }
+
+  static char* putNum(char* to, int val, int width)
+  {
+    for (int i = width - 1; i >= 0; i--) {
+      to[i] = (char)('0' + val % 10);
+      val /= 10;
+    }
+    return to + width;
+  }
+
+  /// offset of local time to UTC in seconds valid for the hour of t
+  static int64_t zoneOffset(std::time_t t)
+  {
+    struct Cache {
+      int64_t m_hour = INT64_MIN;
+      int64_t m_offset = 0;
+    };
+    static thread_local Cache cache;
+
+    int64_t hour = floorDiv((int64_t)t, 3600);
+    if (cache.m_hour != hour) {
+      std::time_t h = (std::time_t)(hour * 3600);
+      std::tm tm;
+#if defined(WIN) || defined(_WIN32)
+      localtime_s(&tm, &h);
+#else
+      localtime_r(&h, &tm);
+#endif
+      int64_t local = daysFromCivil(tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday) * 86400 +
+        tm.tm_hour * 3600 + tm.tm_min * 60 + tm.tm_sec;
+      cache.m_offset = local - (int64_t)h;
+      cache.m_hour = hour;
+    }
+    return cache.m_offset;
+  }
+
+  /// days since 1970-01-01 of proleptic Gregorian date
+  static int64_t daysFromCivil(int y, unsigned m, unsigned d)
+  {
+    y -= m <= 2;
+    const int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = (unsigned)(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int64_t)doe - 719468;
+  }
+
+  /// proleptic Gregorian date of days since 1970-01-01
+  static void civilFromDays(int64_t z, int& y, unsigned& m, unsigned& d)
+  {
+    z += 719468;
+    const int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    const unsigned doe = (unsigned)(z - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    y = (int)(yoe + era * 400) + (m <= 2);
+  }
+};
@@ -19,6 +19,8 @@
 /// Declaration of init functions of static link components
 void init_SimpleSerializer();
 void init_JsonSerializer();
+void init_BinarySerializer();
+void init_CborSerializer();
 void init_MqMessaging();
 void init_MqttMessaging();
 void init_UdpMessaging();
@@ -28,6 +30,8 @@ void init_BaseService();
 #define STATIC_INIT \
 init_SimpleSerializer(); \
 init_JsonSerializer(); \
+init_BinarySerializer(); \
+init_CborSerializer(); \
 init_MqMessaging(); \
 init_MqttMessaging(); \
 init_UdpMessaging(); \
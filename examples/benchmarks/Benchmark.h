@@ -0,0 +1,70 @@
+/**
+ * Copyright 2016-2017 MICRORISC s.r.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <cstdlib>
+
+namespace benchmark {
+
+  /// \brief Number of iterations
+  /// \param [in] argc main() argument count
+  /// \param [in] argv main() arguments, the first one optionally overrides the default
+  /// \param [in] defaultCount used if not passed on command line
+  inline size_t getCount(int argc, char** argv, size_t defaultCount)
+  {
+    if (argc > 1) {
+      long count = strtol(argv[1], nullptr, 10);
+      if (count > 0)
+        return (size_t)count;
+    }
+    return defaultCount;
+  }
+
+  /// \brief Measure and print time of repeated call
+  /// \param [in] name printed label
+  /// \param [in] count number of calls
+  /// \param [in] fn called with index of iteration
+  /// \return elapsed time in seconds
+  /// \details
+  /// The function is called once before measuring to warm up caches and pools.
+  template <typename F>
+  double run(const std::string& name, size_t count, F fn)
+  {
+    fn(0);
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; i++)
+      fn(i);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    double seconds = elapsed.count();
+    std::cout << std::left << std::setw(32) << name << std::right
+      << std::setw(10) << std::fixed << std::setprecision(1) << seconds * 1000 << " ms"
+      << std::setw(14) << std::setprecision(0) << (seconds > 0 ? count / seconds : 0) << " ops/s" << std::endl;
+    return seconds;
+  }
+
+  /// \brief Print ratio of baseline and optimized time
+  inline void speedup(double baseline, double optimized)
+  {
+    std::cout << "speedup: " << std::fixed << std::setprecision(2)
+      << (optimized > 0 ? baseline / optimized : 0) << "x" << std::endl << std::endl;
+  }
+}
@@ -0,0 +1,131 @@
+/**
+ * Copyright 2016-2017 MICRORISC s.r.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Benchmark.h"
+#include "ObjectFactory.h"
+#include "JsonSerializer.h"
+#include "PrfThermometer.h"
+#include "PrfLeds.h"
+#include "PrfFrc.h"
+#include "PrfIo.h"
+#include "PrfOs.h"
+#include <map>
+#include <vector>
+
+// Dispatch of type names by ObjectFactory:
+// perfect hash looked up by characters of the message against std::map looked up by std::string copied
+// from the message as the factory did before
+
+namespace {
+  /// representation passed to creators
+  struct Representation
+  {
+    size_t m_created = 0;
+  };
+
+  /// trivial class so the allocation does not hide the cost of dispatch
+  class Created
+  {
+  public:
+    virtual ~Created() {}
+  };
+
+  template <int N>
+  class CreatedN : public Created
+  {
+  public:
+    CreatedN(Representation& rep) { rep.m_created += N; }
+  };
+
+  /// the factory replaced by perfect hash
+  template<typename T, typename R>
+  class MapObjectFactory
+  {
+  private:
+    typedef std::function<std::unique_ptr<T>(R&)> CreateObjectFunc;
+    std::map<std::string, CreateObjectFunc> m_creators;
+
+    template<typename S>
+    static std::unique_ptr<T> createObject(R& representation) {
+      return std::unique_ptr<T>(ant_new S(representation));
+    }
+  public:
+    template<typename S>
+    void registerClass(const std::string& id) {
+      m_creators.insert(std::make_pair(id, createObject<S>));
+    }
+
+    std::unique_ptr<T> createObject(const std::string& id, R& representation) {
+      auto iter = m_creators.find(id);
+      if (iter == m_creators.end()) {
+        THROW_EX(std::logic_error, "Unregistered creator for: " << PAR(id));
+      }
+      return std::move(iter->second(representation));
+    }
+  };
+
+  /// registers all types of JsonSerializer
+  template <typename F>
+  void registerTypes(F& factory)
+  {
+    factory.template registerClass<CreatedN<1>>(DpaRaw::PRF_NAME);
+    factory.template registerClass<CreatedN<2>>(PrfRawHdpJson::PRF_NAME);
+    factory.template registerClass<CreatedN<3>>(PrfThermometer::PRF_NAME);
+    factory.template registerClass<CreatedN<4>>(PrfLedG::PRF_NAME);
+    factory.template registerClass<CreatedN<5>>(PrfLedR::PRF_NAME);
+    factory.template registerClass<CreatedN<6>>(PrfFrc::PRF_NAME);
+    factory.template registerClass<CreatedN<7>>(PrfIo::PRF_NAME);
+    factory.template registerClass<CreatedN<8>>(PrfOs::PRF_NAME);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  size_t count = benchmark::getCount(argc, argv, 5000000);
+
+  //type names as they are found in received messages
+  std::string message = DpaRaw::PRF_NAME + PrfRawHdpJson::PRF_NAME + PrfThermometer::PRF_NAME + PrfLedG::PRF_NAME
+    + PrfLedR::PRF_NAME + PrfFrc::PRF_NAME + PrfIo::PRF_NAME + PrfOs::PRF_NAME;
+  std::vector<std::pair<const char*, size_t>> names;
+  for (const std::string* name : { &DpaRaw::PRF_NAME, &PrfRawHdpJson::PRF_NAME, &PrfThermometer::PRF_NAME,
+    &PrfLedG::PRF_NAME, &PrfLedR::PRF_NAME, &PrfFrc::PRF_NAME, &PrfIo::PRF_NAME, &PrfOs::PRF_NAME }) {
+    names.push_back(std::make_pair(message.data() + message.find(*name), name->size()));
+  }
+
+  MapObjectFactory<Created, Representation> mapFactory;
+  registerTypes(mapFactory);
+  ObjectFactory<Created, Representation> hashFactory;
+  registerTypes(hashFactory);
+
+  Representation mapRep, hashRep;
+  std::cout << count << " objects of " << names.size() << " types" << std::endl;
+
+  double map = benchmark::run("std::map", count, [&](size_t i) {
+    const auto& name = names[i % names.size()];
+    std::string id(name.first, name.second);
+    mapFactory.createObject(id, mapRep);
+  });
+
+  double hash = benchmark::run("perfect hash", count, [&](size_t i) {
+    const auto& name = names[i % names.size()];
+    hashFactory.createObject(name.first, name.second, hashRep);
+  });
+
+  benchmark::speedup(map, hash);
+
+  //both factories created the same objects
+  return mapRep.m_created == hashRep.m_created ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,146 @@
+/**
+ * Copyright 2016-2017 MICRORISC s.r.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Benchmark.h"
+#include "HexCodec.h"
+#include "IqrfLogging.h"
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+// Hexadecimal DPA payloads encoded and decoded by hexcodec as PrfCommonJson does now
+// against the replaced istringstream and ostringstream code
+
+namespace legacy {
+  /// the replaced PrfCommonJson::parseBinary()
+  int parseBinary(uint8_t* to, const std::string& from, int maxlen)
+  {
+    int retval = 0;
+    if (!from.empty()) {
+      std::string buf = from;
+      if (std::string::npos != buf.find_first_of('.')) {
+        std::replace(buf.begin(), buf.end(), '.', ' ');
+      }
+      std::istringstream istr(buf);
+
+      int val;
+      while (retval < maxlen) {
+        if (!(istr >> std::hex >> val)) {
+          if (istr.eof()) break;
+          THROW_EX(std::logic_error, "Unexpected format: " << PAR(from));
+        }
+        to[retval++] = (uint8_t)val;
+      }
+    }
+    return retval;
+  }
+
+  /// the replaced PrfCommonJson::encodeBinary() with dot notation
+  void encodeBinary(std::string& to, const uint8_t* from, int len)
+  {
+    to.clear();
+    if (len > 0) {
+      std::ostringstream ostr;
+      ostr << iqrf::TracerHexString(from, len, true);
+      to = ostr.str();
+      std::replace(to.begin(), to.end(), ' ', '.');
+      if (to[to.size() - 1] == '.')
+        to.pop_back();
+    }
+  }
+}
+
+namespace current {
+  /// PrfCommonJson::parseBinary()
+  int parseBinary(uint8_t* to, const std::string& from, int maxlen)
+  {
+    int retval = hexcodec::decode(to, maxlen, from.data(), from.size());
+    if (retval < 0) {
+      THROW_EX(std::logic_error, "Unexpected format: " << PAR(from));
+    }
+    return retval;
+  }
+
+  /// PrfCommonJson::encodeBinary() with dot notation
+  void encodeBinary(std::string& to, const uint8_t* from, int len)
+  {
+    to.clear();
+    if (len > 0) {
+      to.resize(hexcodec::encodedSize(len));
+      to.resize(hexcodec::encode(&to[0], from, len, '.'));
+    }
+  }
+}
+
+int main(int argc, char** argv)
+{
+  size_t count = benchmark::getCount(argc, argv, 1000000);
+
+#if defined(HEXCODEC_SSSE3)
+  std::cout << "hexcodec path: SSSE3" << std::endl;
+#elif defined(HEXCODEC_NEON)
+  std::cout << "hexcodec path: NEON" << std::endl;
+#else
+  std::cout << "hexcodec path: scalar" << std::endl;
+#endif
+
+  //header only request, typical request with data and the longest DPA packet
+  const size_t sizes[] = { 6, 20, 64 };
+
+  for (size_t size : sizes) {
+    std::vector<uint8_t> data(size);
+    for (size_t i = 0; i < size; i++)
+      data[i] = (uint8_t)(i * 37 + 11);
+
+    std::string legacyStr, currentStr;
+    legacy::encodeBinary(legacyStr, data.data(), (int)size);
+    current::encodeBinary(currentStr, data.data(), (int)size);
+    std::vector<uint8_t> legacyData(size), currentData(size);
+    if (legacyStr != currentStr
+      || legacy::parseBinary(legacyData.data(), currentStr, (int)size) != (int)size
+      || current::parseBinary(currentData.data(), currentStr, (int)size) != (int)size
+      || legacyData != data || currentData != data) {
+      std::cerr << "different results of " << size << " bytes" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    std::cout << count << " payloads of " << size << " bytes" << std::endl;
+    size_t sink = 0;
+
+    double legacyEncode = benchmark::run("encode ostringstream", count, [&](size_t i) {
+      legacy::encodeBinary(legacyStr, data.data(), (int)size);
+      sink += legacyStr.size();
+    });
+    double currentEncode = benchmark::run("encode hexcodec", count, [&](size_t i) {
+      current::encodeBinary(currentStr, data.data(), (int)size);
+      sink += currentStr.size();
+    });
+    benchmark::speedup(legacyEncode, currentEncode);
+
+    double legacyDecode = benchmark::run("decode istringstream", count, [&](size_t i) {
+      sink += legacy::parseBinary(legacyData.data(), currentStr, (int)size);
+    });
+    double currentDecode = benchmark::run("decode hexcodec", count, [&](size_t i) {
+      sink += current::parseBinary(currentData.data(), currentStr, (int)size);
+    });
+    benchmark::speedup(legacyDecode, currentDecode);
+
+    if (sink == 0)
+      return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,378 @@
+/**
+ * Copyright 2016-2017 MICRORISC s.r.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Benchmark.h"
+#include "JsonSerializer.h"
+#include "JsonUtils.h"
+#include "PrfThermometer.h"
+#include "PrfLeds.h"
+#include "PrfIo.h"
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <vector>
+
+// Requests per second of JsonSerializer:
+// the replaced pipeline, copied below, parsed the whole text to DOM once in parseCategory() and once more
+// in parseRequest() and read members of the DOM to strings in the constructor of the peripheral class,
+// BaseService uses single pass JsonSerializer::parse() now, it also validates requests against schemas
+// which the replaced pipeline did not do, so the numbers include the cost of validation
+
+namespace legacy {
+  /// the replaced PrfCommonJson parsing
+  class PrfCommonJson
+  {
+  protected:
+    PrfCommonJson()
+    {
+      m_doc.SetObject();
+    }
+
+    void parseRequestJson(const rapidjson::Value& val, DpaTask& dpaTask)
+    {
+      jutils::assertIsObject("", val);
+
+      m_has_ctype = jutils::getMemberIfExistsAs<std::string>("ctype", val, m_ctype);
+      m_has_type = jutils::getMemberIfExistsAs<std::string>("type", val, m_type);
+      m_has_nadr = jutils::getMemberIfExistsAs<std::string>("nadr", val, m_nadr);
+      m_has_hwpid = jutils::getMemberIfExistsAs<std::string>("hwpid", val, m_hwpid);
+      m_has_timeout = jutils::getMemberIfExistsAs<int>("timeout", val, m_timeoutJ);
+      m_has_retries = jutils::getMemberIfExistsAs<int>("retries", val, m_retries);
+      m_has_msgid = jutils::getMemberIfExistsAs<std::string>("msgid", val, m_msgid);
+      m_has_request = jutils::getMemberIfExistsAs<std::string>("request", val, m_requestJ);
+      m_has_request_ts = jutils::getMemberIfExistsAs<std::string>("request_ts", val, m_request_ts);
+      m_has_response = jutils::getMemberIfExistsAs<std::string>("response", val, m_responseJ);
+      m_has_response_ts = jutils::getMemberIfExistsAs<std::string>("response_ts", val, m_response_ts);
+      m_has_confirmation = jutils::getMemberIfExistsAs<std::string>("confirmation", val, m_confirmationJ);
+      m_has_confirmation_ts = jutils::getMemberIfExistsAs<std::string>("confirmation_ts", val, m_confirmation_ts);
+      m_has_cmd = jutils::getMemberIfExistsAs<std::string>("cmd", val, m_cmdJ);
+      m_has_rcode = jutils::getMemberIfExistsAs<std::string>("rcode", val, m_rcodeJ);
+      m_has_dpaval = jutils::getMemberIfExistsAs<std::string>("dpaval", val, m_dpavalJ);
+
+      if (m_has_msgid) {
+        dpaTask.setClid(m_msgid);
+      }
+      if (m_has_nadr) {
+        uint16_t nadr;
+        parseHexaNum(nadr, m_nadr);
+        dpaTask.setAddress(nadr);
+      }
+      if (m_has_hwpid) {
+        uint16_t hwpid;
+        parseHexaNum(hwpid, m_hwpid);
+        dpaTask.setHwpid(hwpid);
+      }
+      if (m_has_cmd) {
+        dpaTask.parseCommand(m_cmdJ);
+      }
+      if (m_has_timeout && m_timeoutJ >= 0) {
+        dpaTask.setTimeout(m_timeoutJ);
+      }
+    }
+
+    int parseBinary(uint8_t* to, const std::string& from, int maxlen)
+    {
+      int retval = 0;
+      if (!from.empty()) {
+        std::string buf = from;
+        if (std::string::npos != buf.find_first_of('.')) {
+          std::replace(buf.begin(), buf.end(), '.', ' ');
+          m_dotNotation = true;
+        }
+        std::istringstream istr(buf);
+
+        int val;
+        while (retval < maxlen) {
+          if (!(istr >> std::hex >> val)) {
+            if (istr.eof()) break;
+            THROW_EX(std::logic_error, "Unexpected format: " << PAR(from));
+          }
+          to[retval++] = (uint8_t)val;
+        }
+      }
+      return retval;
+    }
+
+    template<typename T>
+    void parseHexaNum(T& to, const std::string& from)
+    {
+      int val = 0;
+      std::istringstream istr(from);
+      if (istr >> std::hex >> val) {
+        to = (T)val;
+      }
+      else {
+        THROW_EX(std::logic_error, "Unexpected format: " << PAR(from));
+      }
+    }
+
+    bool m_has_ctype = false;
+    bool m_has_type = false;
+    bool m_has_nadr = false;
+    bool m_has_hwpid = false;
+    bool m_has_timeout = false;
+    bool m_has_retries = false;
+    bool m_has_msgid = false;
+    bool m_has_request = false;
+    bool m_has_request_ts = false;
+    bool m_has_response = false;
+    bool m_has_response_ts = false;
+    bool m_has_confirmation = false;
+    bool m_has_confirmation_ts = false;
+    bool m_has_cmd = false;
+    bool m_has_rcode = false;
+    bool m_has_dpaval = false;
+
+    std::string m_ctype;
+    std::string m_type;
+    std::string m_nadr = "0";
+    std::string m_hwpid = "0xffff";
+    int m_timeoutJ = 0;
+    int m_retries = -1;
+    std::string m_msgid;
+    std::string m_requestJ;
+    std::string m_request_ts;
+    std::string m_responseJ;
+    std::string m_response_ts;
+    std::string m_confirmationJ;
+    std::string m_confirmation_ts;
+    std::string m_cmdJ;
+    std::string m_statusJ;
+    std::string m_rcodeJ;
+    std::string m_dpavalJ;
+
+    rapidjson::Document m_doc;
+    bool m_dotNotation = false;
+  };
+
+  class PrfRawJson : public DpaRaw, public PrfCommonJson
+  {
+  public:
+    explicit PrfRawJson(const rapidjson::Value& val)
+    {
+      parseRequestJson(val, *this);
+      if (!m_has_request) {
+        THROW_EX(std::logic_error, "Missing member: request");
+      }
+      int len = parseBinary(m_request.DpaPacket().Buffer, m_requestJ, MAX_DPA_BUFFER);
+      m_request.SetLength(len);
+    }
+  };
+
+  class PrfRawHdpJson : public DpaRaw, public PrfCommonJson
+  {
+  public:
+    explicit PrfRawHdpJson(const rapidjson::Value& val)
+    {
+      parseRequestJson(val, *this);
+
+      m_pnum = jutils::getMemberAs<std::string>("pnum", val);
+      m_pcmd = jutils::getMemberAs<std::string>("pcmd", val);
+      m_hwpid = jutils::getMemberAs<std::string>("hwpid", val);
+      m_data = jutils::getPossibleMemberAs<std::string>("rdata", val, m_data);
+
+      uint8_t pnum;
+      parseHexaNum(pnum, m_pnum);
+      m_request.DpaPacket().DpaRequestPacket_t.PNUM = pnum;
+      uint8_t pcmd;
+      parseHexaNum(pcmd, m_pcmd);
+      m_request.DpaPacket().DpaRequestPacket_t.PCMD = pcmd;
+      uint16_t hwpid;
+      parseHexaNum(hwpid, m_hwpid);
+      m_request.DpaPacket().DpaRequestPacket_t.HWPID = hwpid;
+
+      int len = parseBinary(m_request.DpaPacket().DpaRequestPacket_t.DpaMessage.Request.PData, m_data, DPA_MAX_DATA_LENGTH);
+      m_request.SetLength(sizeof(TDpaIFaceHeader) + len);
+    }
+
+  private:
+    std::string m_pnum;
+    std::string m_pcmd;
+    std::string m_data;
+  };
+
+  class PrfThermometerJson : public PrfThermometer, public PrfCommonJson
+  {
+  public:
+    explicit PrfThermometerJson(const rapidjson::Value& val)
+    {
+      parseRequestJson(val, *this);
+    }
+  };
+
+  template <typename L>
+  class PrfLedJson : public L, public PrfCommonJson
+  {
+  public:
+    explicit PrfLedJson(const rapidjson::Value& val)
+    {
+      parseRequestJson(val, *this);
+    }
+  };
+
+  class PrfIoJson : public PrfIo, public PrfCommonJson
+  {
+  public:
+    explicit PrfIoJson(const rapidjson::Value& val)
+    {
+      parseRequestJson(val, *this);
+
+      switch (getCmd()) {
+      case PrfIo::Cmd::DIRECTION:
+        m_port = parsePort(jutils::getMemberAs<std::string>("port", val));
+        m_bit = jutils::getMemberAs<int>("bit", val);
+        m_val = jutils::getMemberAs<bool>("inp", val);
+        directionCommand(m_port, m_bit, m_val);
+        break;
+      case PrfIo::Cmd::SET:
+        m_port = parsePort(jutils::getMemberAs<std::string>("port", val));
+        m_bit = jutils::getMemberAs<int>("bit", val);
+        m_val = jutils::getMemberAs<bool>("val", val);
+        setCommand(m_port, m_bit, m_val);
+        break;
+      case PrfIo::Cmd::GET:
+        m_port = parsePort(jutils::getMemberAs<std::string>("port", val));
+        m_bit = jutils::getMemberAs<int>("bit", val);
+        getCommand();
+        break;
+      default:
+        ;
+      }
+    }
+
+  private:
+    Port m_port;
+    uint8_t m_bit = 0;
+    bool m_val = false;
+  };
+
+  /// the replaced JsonSerializer::parseCategory() and parseRequest()
+  class JsonSerializer
+  {
+  public:
+    JsonSerializer()
+    {
+      registerClass<PrfRawJson>(DpaRaw::PRF_NAME);
+      registerClass<PrfRawHdpJson>(::PrfRawHdpJson::PRF_NAME);
+      registerClass<PrfThermometerJson>(PrfThermometer::PRF_NAME);
+      registerClass<PrfLedJson<PrfLedG>>(PrfLedG::PRF_NAME);
+      registerClass<PrfLedJson<PrfLedR>>(PrfLedR::PRF_NAME);
+      registerClass<PrfIoJson>(PrfIo::PRF_NAME);
+    }
+
+    std::string parseCategory(const std::string& request)
+    {
+      std::string ctype;
+      try {
+        rapidjson::Document doc;
+        jutils::parseString(request, doc);
+        jutils::assertIsObject("", doc);
+        ctype = jutils::getMemberAs<std::string>("ctype", doc);
+      }
+      catch (std::exception &e) {
+        m_lastError = e.what();
+      }
+      return ctype;
+    }
+
+    std::unique_ptr<DpaTask> parseRequest(const std::string& request)
+    {
+      std::unique_ptr<DpaTask> obj;
+      try {
+        rapidjson::Document doc;
+        jutils::parseString(request, doc);
+        jutils::assertIsObject("", doc);
+        std::string perif = jutils::getMemberAs<std::string>("type", doc);
+
+        auto iter = m_creators.find(perif);
+        if (iter == m_creators.end()) {
+          THROW_EX(std::logic_error, "Unregistered creator for: " << PAR(perif));
+        }
+        obj = iter->second(doc);
+      }
+      catch (std::exception &e) {
+        m_lastError = e.what();
+      }
+      return obj;
+    }
+
+    const std::string& getLastError() const { return m_lastError; }
+
+  private:
+    template<typename S>
+    void registerClass(const std::string& id)
+    {
+      m_creators[id] = [](rapidjson::Value& val) { return std::unique_ptr<DpaTask>(ant_new S(val)); };
+    }
+
+    std::map<std::string, std::function<std::unique_ptr<DpaTask>(rapidjson::Value&)>> m_creators;
+    std::string m_lastError;
+  };
+}
+
+namespace {
+  std::string request(const std::string& type, const std::string& members)
+  {
+    return "{\"ctype\":\"dpa\",\"type\":\"" + type + "\",\"msgid\":\"1\",\"timeout\":1000," + members + "}";
+  }
+}
+
+int main(int argc, char** argv)
+{
+  size_t count = benchmark::getCount(argc, argv, 200000);
+
+  //typical dpa requests
+  std::vector<std::string> requests = {
+    request(DpaRaw::PRF_NAME, "\"request\":\"01.00.06.03.ff.ff\",\"request_ts\":\"\",\"confirmation\":\"\","
+      "\"confirmation_ts\":\"\",\"response\":\"\",\"response_ts\":\"\""),
+    request(PrfRawHdpJson::PRF_NAME, "\"nadr\":\"1\",\"pnum\":\"06\",\"pcmd\":\"03\",\"hwpid\":\"ffff\",\"rdata\":\"\""),
+    request(PrfThermometer::PRF_NAME, "\"nadr\":\"1\",\"cmd\":\"READ\""),
+    request(PrfLedR::PRF_NAME, "\"nadr\":\"1\",\"cmd\":\"PULSE\""),
+    request(PrfIo::PRF_NAME, "\"nadr\":\"1\",\"cmd\":\"SET\",\"port\":\"PORTA\",\"bit\":1,\"val\":true"),
+  };
+
+  JsonSerializer serializer;
+  legacy::JsonSerializer legacySerializer;
+  for (const auto& req : requests) {
+    ParsedRequest parsed = serializer.parse(req);
+    std::unique_ptr<DpaTask> legacyTask = legacySerializer.parseRequest(req);
+    if (!parsed.m_dpaTask || !legacyTask
+      || parsed.m_dpaTask->getRequest().GetLength() != legacyTask->getRequest().GetLength()) {
+      std::cerr << "different results of: " << req << std::endl << parsed.m_error << std::endl
+        << legacySerializer.getLastError() << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  size_t parsedCount = 0;
+  std::cout << count << " requests" << std::endl;
+
+  double replaced = benchmark::run("replaced: category + request", count, [&](size_t i) {
+    const std::string& req = requests[i % requests.size()];
+    if (legacySerializer.parseCategory(req) == CAT_DPA_STR)
+      parsedCount += legacySerializer.parseRequest(req) ? 1 : 0;
+  });
+
+  double parsed = benchmark::run("parse with validation", count, [&](size_t i) {
+    ParsedRequest parsed = serializer.parse(requests[i % requests.size()]);
+    parsedCount += parsed.m_dpaTask ? 1 : 0;
+  });
+
+  benchmark::speedup(replaced, parsed);
+
+  return parsedCount == 2 * (count + 1) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,215 @@
+/**
+ * Copyright 2016-2017 MICRORISC s.r.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Benchmark.h"
+#include "SimpleSerializer.h"
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <vector>
+
+// Messages per second of SimpleSerializer:
+// single pass SimpleTokenizer against the replaced parsing by istringstream split to vector of strings,
+// erasing of option tokens and std::stoi of the rest
+
+namespace legacy {
+  std::vector<std::string> parseTokens(DpaTask& dpaTask, std::istream& istr)
+  {
+    std::istream_iterator<std::string> begin(istr);
+    std::istream_iterator<std::string> end;
+    std::vector<std::string> vstrings(begin, end);
+
+    std::size_t found;
+    auto it = vstrings.begin();
+    while (it != vstrings.end()) {
+      if (std::string::npos != (found = it->find("TIMEOUT"))) {
+        std::string timeoutStr = *it;
+        it = vstrings.erase(it);
+        found = timeoutStr.find_first_of('=');
+        if (std::string::npos != found && found < timeoutStr.size() - 1) {
+          dpaTask.setTimeout(std::stoi(timeoutStr.substr(++found, timeoutStr.size() - 1)));
+        }
+        else {
+          THROW_EX(std::logic_error, "Parse error: " << NAME_PAR(token, timeoutStr));
+        }
+      }
+      else if (std::string::npos != (found = it->find("CLID"))) {
+        std::string clientIdStr = *it;
+        it = vstrings.erase(it);
+        found = clientIdStr.find_first_of('=');
+        if (std::string::npos != found && found < clientIdStr.size() - 1) {
+          dpaTask.setClid(clientIdStr.substr(++found, clientIdStr.size() - 1));
+        }
+        else {
+          THROW_EX(std::logic_error, "Parse error: " << NAME_PAR(token, clientIdStr));
+        }
+      }
+      else {
+        std::string paramStr = *it;
+        if (paramStr == "timeout") {
+          it = vstrings.erase(it);
+          if (it != vstrings.end()) {
+            std::string nextParamStr = *it;
+            dpaTask.setTimeout(std::stoi(nextParamStr));
+            it = vstrings.erase(it);
+          }
+        }
+        else {
+          it++;
+        }
+      }
+    }
+
+    return vstrings;
+  }
+
+  void parseRequestSimple(DpaTask& dpaTask, std::vector<std::string>& tokens)
+  {
+    if (tokens.size() > 1) {
+      dpaTask.setAddress(std::stoi(tokens[0]));
+      dpaTask.parseCommand(tokens[1]);
+    }
+    else {
+      THROW_EX(std::logic_error, "Parse error: " << NAME_PAR(tokensNum, tokens.size()));
+    }
+  }
+
+  class PrfRawSimple : public DpaRaw
+  {
+  public:
+    explicit PrfRawSimple(std::istream& istr)
+    {
+      std::vector<std::string> vstrings = parseTokens(*this, istr);
+      //workaround to handle "."
+      if (vstrings.size() == 1) {
+        std::string dotbuf = vstrings[0];
+        vstrings.clear();
+        std::replace(dotbuf.begin(), dotbuf.end(), '.', ' ');
+        std::istringstream is(dotbuf);
+        vstrings = parseTokens(*this, is);
+      }
+
+      int i = 0;
+      int sz = (int)vstrings.size();
+      while (i < MAX_DPA_BUFFER && i < sz) {
+        m_request.DpaPacket().Buffer[i] = (uint8_t)std::stoi(vstrings[i], nullptr, 16);
+        i++;
+      }
+      m_request.SetLength(i);
+    }
+  };
+
+  class PrfThermometerSimple : public PrfThermometer
+  {
+  public:
+    explicit PrfThermometerSimple(std::istream& istr)
+    {
+      std::vector<std::string> v = parseTokens(*this, istr);
+      parseRequestSimple(*this, v);
+    }
+  };
+
+  /// the replaced SimpleSerializer::parseCategory() and parseRequest()
+  class SimpleSerializer
+  {
+  public:
+    SimpleSerializer()
+    {
+      m_creators[PrfThermometer::PRF_NAME] = [](std::istream& istr) {
+        return std::unique_ptr<DpaTask>(ant_new PrfThermometerSimple(istr));
+      };
+      m_creators[DpaRaw::PRF_NAME] = [](std::istream& istr) {
+        return std::unique_ptr<DpaTask>(ant_new PrfRawSimple(istr));
+      };
+    }
+
+    std::string parseCategory(const std::string& request)
+    {
+      std::istringstream istr(request);
+      std::string category;
+      istr >> category;
+      return category == CAT_CONF_STR ? CAT_CONF_STR : CAT_DPA_STR;
+    }
+
+    std::unique_ptr<DpaTask> parseRequest(const std::string& request)
+    {
+      std::unique_ptr<DpaTask> obj;
+      try {
+        std::istringstream istr(request);
+        std::string perif;
+        istr >> perif;
+        auto iter = m_creators.find(perif);
+        if (iter == m_creators.end()) {
+          THROW_EX(std::logic_error, "Unregistered creator for: " << PAR(perif));
+        }
+        obj = iter->second(istr);
+      }
+      catch (std::exception &e) {
+        m_lastError = e.what();
+      }
+      return obj;
+    }
+
+  private:
+    std::map<std::string, std::function<std::unique_ptr<DpaTask>(std::istream&)>> m_creators;
+    std::string m_lastError;
+  };
+}
+
+int main(int argc, char** argv)
+{
+  size_t count = benchmark::getCount(argc, argv, 400000);
+
+  //raw and thermometer messages with options
+  std::vector<std::string> messages = {
+    DpaRaw::PRF_NAME + " 01.00.06.03.ff.ff",
+    DpaRaw::PRF_NAME + " 01 00 06 03 ff ff timeout 1000",
+    DpaRaw::PRF_NAME + " 01.00.07.03.ff.ff TIMEOUT=1000 CLID=client",
+    PrfThermometer::PRF_NAME + " 1 READ",
+    PrfThermometer::PRF_NAME + " 3 READ TIMEOUT=2000",
+  };
+
+  SimpleSerializer serializer;
+  legacy::SimpleSerializer legacySerializer;
+  for (const auto& msg : messages) {
+    ParsedRequest parsed = serializer.parse(msg);
+    std::unique_ptr<DpaTask> legacyTask = legacySerializer.parseRequest(msg);
+    if (!parsed.m_dpaTask || !legacyTask || parsed.m_dpaTask->getTimeout() != legacyTask->getTimeout()
+      || parsed.m_dpaTask->getRequest().GetLength() != legacyTask->getRequest().GetLength()) {
+      std::cerr << "different results of: " << msg << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  size_t parsedCount = 0;
+  std::cout << count << " messages" << std::endl;
+
+  double legacy = benchmark::run("istringstream", count, [&](size_t i) {
+    const std::string& msg = messages[i % messages.size()];
+    if (legacySerializer.parseCategory(msg) == CAT_DPA_STR)
+      parsedCount += legacySerializer.parseRequest(msg) ? 1 : 0;
+  });
+
+  double tokenizer = benchmark::run("tokenizer", count, [&](size_t i) {
+    ParsedRequest parsed = serializer.parse(messages[i % messages.size()]);
+    parsedCount += parsed.m_dpaTask ? 1 : 0;
+  });
+
+  benchmark::speedup(legacy, tokenizer);
+
+  return parsedCount == 2 * (count + 1) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
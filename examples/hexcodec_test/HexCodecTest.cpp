@@ -0,0 +1,168 @@
+/**
+ * Copyright 2016-2017 MICRORISC s.r.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "HexCodec.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstdio>
+
+// Round trip test of hexcodec, the build selects the tested code path:
+// HEXCODEC_SCALAR, SSSE3 (-mssse3) or NEON (HEXCODEC_NEON_ENABLED on ARM)
+
+namespace {
+  int failures = 0;
+
+  void check(bool cond, const std::string& what)
+  {
+    if (!cond) {
+      if (failures < 20)
+        std::cerr << "FAILED: " << what << std::endl;
+      failures++;
+    }
+  }
+
+  /// reference encoding independent of the codec
+  std::string reference(const std::vector<uint8_t>& data, char separator)
+  {
+    std::string str;
+    char buf[4];
+    for (size_t i = 0; i < data.size(); i++) {
+      snprintf(buf, sizeof(buf), "%02x", data[i]);
+      if (i > 0)
+        str += separator;
+      str += buf;
+    }
+    return str;
+  }
+
+  std::string encode(const std::vector<uint8_t>& data, char separator)
+  {
+    std::string str(hexcodec::encodedSize(data.size()), '\0');
+    size_t len = hexcodec::encode(&str[0], data.data(), data.size(), separator);
+    str.resize(len);
+    return str;
+  }
+
+  int decode(std::vector<uint8_t>& data, size_t maxlen, const std::string& str)
+  {
+    data.assign(maxlen, 0);
+    int len = hexcodec::decode(data.data(), maxlen, str.data(), str.size());
+    if (len >= 0)
+      data.resize(len);
+    return len;
+  }
+
+  /// all lengths over vector block boundaries with both separators
+  void testRoundTrip()
+  {
+    for (size_t len = 0; len <= 100; len++) {
+      for (int pattern = 0; pattern < 64; pattern++) {
+        std::vector<uint8_t> data(len);
+        for (size_t i = 0; i < len; i++)
+          data[i] = (uint8_t)(pattern == 0 ? i * 7 : rand());
+
+        const char separators[] = { '.', ' ' };
+        for (char separator : separators) {
+          std::string name = "len " + std::to_string(len) + " separator '" + separator + "'";
+          std::string str = encode(data, separator);
+          check(str == reference(data, separator), "encode " + name);
+
+          std::vector<uint8_t> decoded;
+          check(decode(decoded, len + 1, str) == (int)len && decoded == data, "decode " + name);
+        }
+      }
+    }
+  }
+
+  /// every byte value in every position of a vector block
+  void testAllBytes()
+  {
+    std::vector<uint8_t> data(256 + 15);
+    for (size_t shift = 0; shift < 16; shift++) {
+      for (size_t i = 0; i < data.size(); i++)
+        data[i] = (uint8_t)(i + shift);
+      std::string str = encode(data, '.');
+      check(str == reference(data, '.'), "encode all bytes " + std::to_string(shift));
+
+      std::vector<uint8_t> decoded;
+      check(decode(decoded, data.size(), str) == (int)data.size() && decoded == data,
+        "decode all bytes " + std::to_string(shift));
+
+      //upper case digits are accepted too
+      for (auto& c : str)
+        c = (char)toupper(c);
+      check(decode(decoded, data.size(), str) == (int)data.size() && decoded == data,
+        "decode upper case " + std::to_string(shift));
+    }
+  }
+
+  /// non canonical forms and errors inside and after vector blocks
+  void testNonCanonical()
+  {
+    std::vector<uint8_t> data(40);
+    for (size_t i = 0; i < data.size(); i++)
+      data[i] = (uint8_t)(0xa0 + i);
+    std::string canonical = encode(data, '.');
+    std::vector<uint8_t> decoded;
+
+    for (size_t pos = 0; pos < canonical.size(); pos++) {
+      std::string str = canonical;
+      str[pos] = 'g';
+      check(decode(decoded, data.size(), str) == -1, "invalid digit at " + std::to_string(pos));
+    }
+
+    //mixed separators are accepted
+    std::string str = canonical;
+    str[2] = ' ';
+    str[50] = ' ';
+    check(decode(decoded, data.size(), str) == (int)data.size() && decoded == data, "mixed separators");
+
+    check(decode(decoded, 4, "0x1 0xA2  3.04") == 4 && decoded == std::vector<uint8_t>({ 0x01, 0xa2, 0x03, 0x04 }),
+      "prefixes and one digit bytes");
+    check(decode(decoded, 4, " 01.02 ") == 2, "leading and trailing separators");
+    check(decode(decoded, 4, "123") == -1, "three digits");
+    check(decode(decoded, 4, "ffffffffffffffffffffffff") == -1, "long digit run");
+    check(decode(decoded, 4, "01 0x7fffffffffffffff") == -1, "long prefixed digit run");
+    check(decode(decoded, 4, "") == 0, "empty");
+
+    //the rest of input is ignored if output is full
+    check(decode(decoded, 17, canonical) == 17 && std::equal(decoded.begin(), decoded.end(), data.begin()), "truncated");
+  }
+}
+
+int main()
+{
+#if defined(HEXCODEC_SSSE3)
+  std::cout << "hexcodec path: SSSE3" << std::endl;
+#elif defined(HEXCODEC_NEON)
+  std::cout << "hexcodec path: NEON" << std::endl;
+#else
+  std::cout << "hexcodec path: scalar" << std::endl;
+#endif
+
+  testRoundTrip();
+  testAllBytes();
+  testNonCanonical();
+
+  if (failures > 0) {
+    std::cerr << failures << " checks failed" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cout << "all checks passed" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -81,7 +81,7 @@ void ServiceExample::setDaemon(IDaemon* daemon)
 void ServiceExample::setSerializer(ISerializer* serializer)
 {
   m_serializer = serializer;
-  m_messaging->registerMessageHandler([this](const ustring& msg) {
+  m_messaging->registerMessageHandler([this](MessageSpan& msg) {
     this->handleMsgFromMessaging(msg);
   });
 }
@@ -134,13 +134,13 @@ void ServiceExample::handleTaskFromScheduler(const std::string& task)
   }
 }
 
-void ServiceExample::handleMsgFromMessaging(const ustring& msg)
+void ServiceExample::handleMsgFromMessaging(MessageSpan& msg)
 {
   TRC_DBG("==================================" << std::endl <<
     "Received from Messaging: " << std::endl << FORM_HEX(msg.data(), msg.size()));
 
   //get input message
-  std::string msgs((const char*)msg.data(), msg.size());
+  std::string msgs(msg.chars(), msg.size());
   //TODO
 }
 
@@ -106,7 +106,7 @@ public:
   void stop() override;
 
 private:
-  void handleMsgFromMessaging(const ustring& msg);
+  void handleMsgFromMessaging(MessageSpan& msg);
   void handleTaskFromScheduler(const std::string& task);
 
   void processFrcFromScheduler(const std::string& task);
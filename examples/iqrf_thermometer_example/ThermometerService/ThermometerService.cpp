@@ -99,7 +99,7 @@ void ThermometerService::start()
   TRC_ENTER("");
 
   // register handler method for msgs comming from messaging component
-  m_messaging->registerMessageHandler([this](const ustring& msg) {
+  m_messaging->registerMessageHandler([this](MessageSpan& msg) {
     this->handleMsgFromMessaging(msg);
   });
 
@@ -141,14 +141,14 @@ void ThermometerService::handleTaskFromScheduler(const std::string& task)
   }
 }
 
-void ThermometerService::handleMsgFromMessaging(const IMessaging::ustring& msg)
+void ThermometerService::handleMsgFromMessaging(MessageSpan& msg)
 {
   using namespace rapidjson;
   TRC_DBG("==================================" << std::endl <<
     "Received from Messaging: " << std::endl << FORM_HEX(msg.data(), msg.size()));
 
   //get input message
-  std::string smsg((const char*)msg.data(), msg.size());
+  std::string smsg(msg.chars(), msg.size());
   std::string m_lastError = "OK"; //initiated result
   int readPeriod = 0;
   
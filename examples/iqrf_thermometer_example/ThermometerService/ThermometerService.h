@@ -49,7 +49,7 @@ public:
   void stop() override;
 
 private:
-  void handleMsgFromMessaging(const IMessaging::ustring& msg);
+  void handleMsgFromMessaging(MessageSpan& msg);
   void handleTaskFromScheduler(const std::string& task);
   void processThermometersRead();
   void scheduleReading();